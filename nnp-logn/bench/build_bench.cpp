@@ -0,0 +1,157 @@
+// A benchmark of sampled tree construction (see annBuildSample).
+// For each splitting rule it builds a kd-tree over the same random points,
+// once with exact splits and once with splits estimated from samples, and
+// prints the build times and the times taken by the same exact nearest
+// neighbor searches in the two trees.  Since the searches are exact, both
+// trees must return the same distances, which is checked.
+//
+// After compiling it can be run as follows.
+//
+// build_bench [-d dim] [-n points] [-q queries] [-nn k] [-s size] [-c clusters] [-t threads]
+//
+// where:
+//
+//		dim			dimension of the space (default = 128)
+//		points		number of data points (default = 200000)
+//		queries		number of query points (default = 100)
+//		k			number of nearest neighbors per query (default = 1)
+//		size		sample size of the sampled builds (default = 100)
+//		clusters	number of clusters of points, 0 for uniform points (default = 20)
+//		threads		number of threads used to build the trees (default = 1)
+//
+// The points are gathered around random centres, each cluster spreading
+// along a few random directions, so that the trees are useful in high
+// dimensions.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+
+using namespace std;
+
+// Fills pa with n random points of dimension dim, in the given number of
+// clusters (or uniform in the unit cube if clusters is 0)
+void generatePoints(ANNpointArray pa, int n, int dim, int clusters, mt19937 & random)
+{
+	const int spans = 4;				// directions of spread of each cluster
+	uniform_real_distribution<double> uniform(0, 1);
+	normal_distribution<double> normal(0, 1);
+	vector<double> centres(clusters * dim), axes(clusters * spans * dim);
+
+	for (size_t i = 0; i < centres.size(); i++)
+		centres[i] = uniform(random);
+
+	for (size_t i = 0; i < axes.size(); i++)
+		axes[i] = normal(random) * 0.05;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (clusters == 0)
+		{
+			for (int d = 0; d < dim; d++)
+				pa[i][d] = uniform(random);
+
+			continue;
+		}
+
+		int c = random() % clusters;
+
+		for (int d = 0; d < dim; d++)
+			pa[i][d] = centres[c * dim + d] + normal(random) * 0.002;
+
+		for (int s = 0; s < spans; s++)
+		{
+			double w = normal(random);
+			const double * axis = &axes[(c * spans + s) * dim];
+
+			for (int d = 0; d < dim; d++)
+				pa[i][d] += w * axis[d];
+		}
+	}
+}
+
+double secondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+	int dim = 128, n = 200000, m = 100, k = 1, size = 100, clusters = 20, threads = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "-d")) dim = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-n")) n = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-q")) m = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-nn")) k = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-s")) size = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-c")) clusters = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "-t")) threads = atoi(argv[i + 1]);
+		else
+		{
+			cerr << "Unrecognized option " << argv[i] << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	static const char * names[] = {"kd", "midpt", "fair", "sl_midpt", "sl_fair"};
+	static const ANNsplitRule rules[] = {ANN_KD_STD, ANN_KD_MIDPT, ANN_KD_FAIR, ANN_KD_SL_MIDPT, ANN_KD_SL_FAIR};
+
+	mt19937 random(12345);
+	ANNpointArray data = annAllocPts(n, dim);
+	ANNpointArray queries = annAllocPts(m, dim);
+
+	generatePoints(data, n, dim, clusters, random);
+	generatePoints(queries, m, dim, clusters, random);
+
+	vector<ANNidx> idx(k);
+	vector<ANNdist> dists[2];
+
+	annBuildThreads(threads);
+
+	cout << n << " points, dimension " << dim << ", " << m << " queries, sample size " << size << "\n\n";
+	cout << "rule      build exact  build sampled  speedup  search exact  search sampled\n";
+
+	for (int r = 0; r < 5; r++)
+	{
+		double build[2], search[2];
+
+		for (int s = 0; s < 2; s++)
+		{
+			annBuildSample(s == 0 ? 0 : size);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			ANNkd_tree tree(data, n, dim, 1, rules[r]);
+			build[s] = secondsSince(start);
+
+			dists[s].resize(m * k);
+			start = chrono::steady_clock::now();
+
+			for (int q = 0; q < m; q++)
+				tree.annkSearch(queries[q], k, &idx[0], &dists[s][q * k]);
+
+			search[s] = secondsSince(start);
+		}
+
+		cout << left << setw(10) << names[r] << setw(13) << build[0] << setw(15) << build[1]
+			<< setw(9) << build[0] / build[1] << setw(14) << search[0] << search[1];
+
+		if (dists[0] != dists[1])
+			cout << "  (distances differ!)";
+
+		cout << "\n";
+	}
+
+	annDeallocPts(data);
+	annDeallocPts(queries);
+	annClose();
+
+	return EXIT_SUCCESS;
+}
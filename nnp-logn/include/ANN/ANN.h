@@ -30,6 +30,26 @@
 //		Added fixed-radius k-NN searching
 //	Revision 1.1.2  01/27/10
 //		Fixed minor compilation bugs for new versions of gcc
+//	Revision 1.2
+//		Searches no longer use global state (safe to run concurrently)
+//		Added annkSearchBatch to ANNpointSet
+//		Added ANNkd_flat_tree
+//		Added binary snapshots of flattened trees
+//		Added annLeafCoords (leaf coordinate blocks)
+//		Added annSimdLevel (vector leaf scans)
+//		Added annBuildThreads (parallel tree construction)
+//		Added ANN_FLOAT_COORDS and ANN_NAMESPACE (single precision build)
+//		Added annLeafCodes (quantized leaf codes)
+//		Searches reuse per-thread workspaces (annFreeSearchSpace)
+//		Added a blocked annkSearchBatch to ANNbruteForce
+//		Added annAllKnn (dual-tree all nearest neighbors)
+//		Added annKnnJoin (dual-tree kNN join of two trees)
+//		Added annkClosestPairs (dual-tree k closest pairs)
+//		Added ANNwindow (sliding windows of point streams)
+//		Added annBuildSample (splits estimated from samples)
+//		Added annBuildPresort (presorted kd-tree construction)
+//		Added ANNkd_forest (dynamic point sets)
+//		Added annRangeSearch and annRangeCount (orthogonal range queries)
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
@@ -123,6 +143,32 @@
 #define ANNcopyright	"David M. Mount and Sunil Arya"
 #define ANNlatestRev	"Jan 27, 2010"
 
+//----------------------------------------------------------------------
+//	Namespace
+//		By default ANN is declared in the global namespace.  If the
+//		preprocessor symbol ANN_NAMESPACE is defined when compiling,
+//		everything (except for the preprocessor macros) is declared in
+//		the namespace of that name instead, for example with the option:
+//		-DANN_NAMESPACE=ANNf
+//
+//		This makes it possible to link two builds of the library with
+//		different coordinate types (see ANN_FLOAT_COORDS below) into
+//		the same program.  The sources of each build are compiled with
+//		their own options (and into their own object files or library).
+//		A given source file of the application sees only one of them,
+//		namely the one given by the options it is compiled with.
+//----------------------------------------------------------------------
+
+#ifdef ANN_NAMESPACE
+	#define ANN_BEGIN_NAMESPACE		namespace ANN_NAMESPACE {
+	#define ANN_END_NAMESPACE		}
+#else
+	#define ANN_BEGIN_NAMESPACE
+	#define ANN_END_NAMESPACE
+#endif
+
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	ANNbool
 //	This is a simple boolean type. Although ANSI C++ is supposed
@@ -153,10 +199,24 @@ enum ANNbool {ANNfalse = 0, ANNtrue = 1}; // ANN boolean type (non ANSI C++)
 //
 //		It is the user's responsibility to make sure that overflow does
 //		not occur in distance calculation.
+//
+//		By default both are double.  If the preprocessor symbol
+//		ANN_FLOAT_COORDS is defined when compiling, both are float
+//		instead.  This halves the space taken by the points and the
+//		leaf coordinate blocks (see annLeafCoords), and the vector leaf
+//		scans (see annSimdLevel) handle twice as many coordinates per
+//		instruction.  The library must be compiled with the same
+//		setting as the application.  Distances are accumulated in
+//		float, so they have about 7 significant digits.
 //----------------------------------------------------------------------
 
-typedef double	ANNcoord;				// coordinate data type
-typedef double	ANNdist;				// distance data type
+#ifdef ANN_FLOAT_COORDS
+	typedef float	ANNcoord;			// coordinate data type
+	typedef float	ANNdist;			// distance data type
+#else
+	typedef double	ANNcoord;			// coordinate data type
+	typedef double	ANNdist;			// distance data type
+#endif
 
 //----------------------------------------------------------------------
 //	ANNidx
@@ -196,7 +256,11 @@ const ANNidx	ANN_NULL_IDX = -1;		// a NULL point index
 //		short	SHRT_MAX		0x7fff
 //----------------------------------------------------------------------
 
-const ANNdist	ANN_DIST_INF = ANN_DBL_MAX;
+#ifdef ANN_FLOAT_COORDS
+	const ANNdist	ANN_DIST_INF = FLT_MAX;
+#else
+	const ANNdist	ANN_DIST_INF = ANN_DBL_MAX;
+#endif
 
 //----------------------------------------------------------------------
 //	Significant digits for tree dumps:
@@ -216,7 +280,9 @@ const ANNdist	ANN_DIST_INF = ANN_DBL_MAX;
 //		short	 doesn't matter 5
 //----------------------------------------------------------------------
 
-#ifdef DBL_DIG							// number of sig. bits in ANNcoord
+#if defined(ANN_FLOAT_COORDS)			// number of sig. bits in ANNcoord
+	const int	 ANNcoordPrec	= FLT_DIG;
+#elif defined(DBL_DIG)
 	const int	 ANNcoordPrec	= DBL_DIG;
 #else
 	const int	 ANNcoordPrec	= 15;	// default precision
@@ -337,6 +403,7 @@ const ANNbool	ANN_ALLOW_SELF_MATCH	= ANNtrue;
 #define ANN_ROOT(x)			sqrt(x)
 #define ANN_SUM(x,y)		((x) + (y))
 #define ANN_DIFF(x,y)		((y) - (x))
+#define ANN_NORM_L2						// (enables vector leaf scans)
 
 //----------------------------------------------------------------------
 //	Use the following for the L_1 (Manhattan) norm
@@ -483,6 +550,17 @@ DLL_API ANNpoint annCopyPt(
 //		outside a ball of radius r/(1+epsilon), where r is the given
 //		(unsquared) radius bound.
 //
+//		The search algorithm, annkSearchBatch, answers m kNN queries in
+//		one call.  The queries are given as an array of m points, and
+//		the results are written to two caller-owned arrays of m*k
+//		elements each, the k results of query i being stored starting
+//		at position i*k.  The queries are divided among the given
+//		number of threads (0 means one per hardware thread, and 1
+//		means the calling thread alone).  The threads are taken from a
+//		process-wide pool, which is shut down by annClose().  The
+//		results are the same as those of calling annkSearch for each
+//		query in turn.
+//
 //		The generic object from which all the search structures are
 //		dervied is given below.  It is a virtual object, and is useless
 //		by itself.
@@ -509,6 +587,15 @@ public:
 		double			eps=0.0			// error bound
 		) = 0;							// pure virtual (defined elsewhere)
 
+	virtual void annkSearchBatch(		// approx kNN search for many queries
+		ANNpointArray	q,				// query points
+		int				m,				// number of query points
+		int				k,				// number of near neighbors per query
+		ANNidxArray		nn_idx,			// m*k near neighbor indices (modified)
+		ANNdistArray	dd,				// m*k dists to near neighbors (modified)
+		double			eps=0.0,		// error bound
+		int				threads=0);		// number of threads (0 = all)
+
 	virtual int theDim() = 0;			// return dimension of space
 	virtual int nPoints() = 0;			// return number of points
 										// return pointer to points
@@ -528,6 +615,12 @@ public:
 //		WARNING: This data structure is very slow, and should not be
 //		used unless the number of points is very small.
 //
+//		annkSearchBatch is much faster than searching the queries one
+//		at a time: it compares blocks of queries with cache-sized
+//		tiles of points, using the vector leaf scans (see
+//		annSimdLevel), in parallel.  Its results are exactly those of
+//		annkSearch.
+//
 //		Internal information:
 //		---------------------
 //		This data structure bascially consists of the array of points
@@ -562,6 +655,15 @@ public:
 		ANNdistArray	dd = NULL,		// dist to near neighbors (modified)
 		double			eps=0.0);		// error bound
 
+	void annkSearchBatch(				// blocked kNN search for many queries
+		ANNpointArray	q,				// query points
+		int				m,				// number of query points
+		int				k,				// number of near neighbors per query
+		ANNidxArray		nn_idx,			// m*k near neighbor indices (modified)
+		ANNdistArray	dd,				// m*k dists to near neighbors (modified)
+		double			eps=0.0,		// error bound
+		int				threads=0);		// number of threads (0 = all)
+
 	int theDim()						// return dimension of space
 		{ return dim; }
 
@@ -639,6 +741,24 @@ const int ANN_N_SHRINK_RULES	= 4;	// number of shrink rules
 //				fine, but priority search is safer for worst-case
 //				performance.
 //
+//		There are also two orthogonal range queries, given an axis
+//		aligned box, either as its low and high corners or as an
+//		ANNorthRect (see ANNx.h).  The box is closed, so a point lies
+//		in it if lo[d] <= p[d] <= hi[d] in every dimension d.
+//
+//			Range search (annRangeSearch()):
+//				Returns the number of points in the box, and stores
+//				the indices of the first k of them found (in no
+//				particular order) in idx, which must have room for
+//				k of them.  To get all of them, call annRangeCount()
+//				first.
+//			Range count (annRangeCount()):
+//				Returns the number of points in the box.  Each node
+//				of the tree stores the number of points below it, so
+//				a subtree whose cell lies in the box is counted
+//				without visiting its leaves.  Range search does the
+//				same once it has stored k indices.
+//
 //		Printing:
 //		---------
 //		There are two methods provided for printing the tree.  Print()
@@ -692,6 +812,19 @@ const int ANN_N_SHRINK_RULES	= 4;	// number of shrink rules
 //		bnd_box_hi				Bounding box high point
 //		splitRule				Splitting method used
 //
+//		Concurrency:
+//		------------
+//		The search procedures do not modify the tree or any global
+//		state (each call keeps its own search context, and its queues
+//		are in a workspace of the calling thread), so once a tree
+//		has been built, any number of threads may search it at the same
+//		time.  The exceptions are the performance counters, which are
+//		global and are only meaningful when searches are not concurrent
+//		(see ANNperf.h), and annMaxPtsVisit(), whose value is read at
+//		the start of each search and so should not be changed while
+//		searches are in progress.  Building, loading and deleting a tree
+//		are not safe to overlap with searches of the same tree.
+//
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
@@ -699,7 +832,9 @@ const int ANN_N_SHRINK_RULES	= 4;	// number of shrink rules
 // See src/kd_tree.h and src/kd_tree.cpp for definitions
 //----------------------------------------------------------------------
 class ANNkdStats;				// stats on kd-tree
+class ANNorthRect;				// axis-aligned rectangle
 class ANNkd_node;				// generic node in a kd-tree
+class ANNleaf_quant;			// quantizer of leaf codes
 typedef ANNkd_node*	ANNkd_ptr;	// pointer to a kd-tree node
 
 class DLL_API ANNkd_tree: public ANNpointSet {
@@ -712,6 +847,12 @@ protected:
 	ANNkd_ptr		root;				// root of kd-tree
 	ANNpoint		bnd_box_lo;			// bounding box low point
 	ANNpoint		bnd_box_hi;			// bounding box high point
+	ANNcoord		*leaf_coords;		// leaf coordinate blocks (or NULL)
+	ANNleaf_quant	*leaf_quant;		// quantized leaf codes (or NULL)
+
+	friend class ANNkd_flat_tree;		// flattened copies read the tree
+	friend class ANNjoin_tree;			// so do the dual-tree traversals
+	friend struct ANNforest_data;		// forests remove points from leaves
 
 	void SkeletonTree(					// construct skeleton tree
 		int				n,				// number of points
@@ -720,6 +861,9 @@ protected:
 		ANNpointArray pa = NULL,		// point array (optional)
 		ANNidxArray pi = NULL);			// point indices (optional)
 
+	void MakeLeafCoords();				// build leaf coordinate blocks
+	void MakeLeafCodes();				// build quantized leaf codes
+
 public:
 	ANNkd_tree(							// build skeleton tree
 		int				n = 0,			// number of points
@@ -760,6 +904,24 @@ public:
 		ANNdistArray	dd = NULL,		// dist to near neighbors (modified)
 		double			eps=0.0);		// error bound
 
+	int annRangeSearch(					// orthogonal range search
+		ANNpoint		lo,				// low corner of the box
+		ANNpoint		hi,				// high corner of the box
+		int				k = 0,			// number of indices to return
+		ANNidxArray		idx = NULL);	// indices of points (modified)
+
+	int annRangeSearch(					// orthogonal range search
+		const ANNorthRect &box,			// the box
+		int				k = 0,			// number of indices to return
+		ANNidxArray		idx = NULL);	// indices of points (modified)
+
+	int annRangeCount(					// orthogonal range count
+		ANNpoint		lo,				// low corner of the box
+		ANNpoint		hi);			// high corner of the box
+
+	int annRangeCount(					// orthogonal range count
+		const ANNorthRect &box);		// the box
+
 	int theDim()						// return dimension of space
 		{ return dim; }
 
@@ -814,17 +976,510 @@ public:
 		std::istream&	in);			// input stream for dump file
 };
 
+//----------------------------------------------------------------------
+//	Flattened kd-tree
+//		A flattened tree is a compact, read-only copy of a kd-tree or
+//		bd-tree, made for fast searching.  In the ordinary tree every
+//		node is allocated separately, and the search visits the nodes
+//		through virtual calls.  In the flattened tree all the nodes
+//		are stored in a single array in depth-first order, children
+//		are referred to by their (32-bit) indices in that array, and
+//		the points of each leaf are a contiguous range of one point
+//		index array.  The searches are iterative, and make no virtual
+//		calls.
+//
+//		A flattened tree is built from an existing tree.  It is
+//		independent of the original, which may be deleted, but like
+//		the original, it does not copy the points, which must remain
+//		unchanged while it is in use.
+//
+//		The searches visit the same nodes and points in the same order
+//		as the searches of the original tree, and so they return the
+//		same results (including the way ties are broken).
+//
+//		If the original tree has leaf coordinate blocks (see
+//		annLeafCoords() below), so does the flattened tree.
+//
+//		Save() writes a flattened tree, with its points, to a binary
+//		snapshot file.  The snapshot constructor maps such a file into
+//		memory (read-only) and searches it in place: nothing is read
+//		or parsed when it is loaded, so loading is nearly instant, and
+//		processes that load the same file share one copy of it.  The
+//		file must not be changed while it is in use.  Snapshots are
+//		only portable between machines with the same byte order
+//		(little-endian) and data types.
+//----------------------------------------------------------------------
+
+struct ANNflat_node;					// node of a flattened tree
+struct ANNflat_map;						// a mapped snapshot file
+class ANNorthHalfSpace;					// bounding halfspace (see ANNx.h)
+
+class DLL_API ANNkd_flat_tree: public ANNpointSet {
+protected:
+	int				dim;				// dimension of space
+	int				n_pts;				// number of points in tree
+	int				n_nodes;			// number of nodes
+	int				n_bnds;				// number of bounding halfspaces
+	int				max_depth;			// depth of tree
+	ANNpointArray	pts;				// the points
+	ANNidxArray		pidx;				// point indices, in leaf order
+	ANNflat_node	*nodes;				// the nodes, in preorder
+	ANNorthHalfSpace *bnds;				// halfspaces of shrinking nodes
+	ANNpoint		bnd_box_lo;			// bounding box low point
+	ANNpoint		bnd_box_hi;			// bounding box high point
+	ANNcoord		*leaf_coords;		// leaf coordinate blocks (or NULL)
+	ANNflat_map		*mapping;			// snapshot mapping (or NULL)
+
+public:
+	ANNkd_flat_tree(					// build from kd- or bd-tree
+		ANNkd_tree&		tree);			// the tree to flatten
+
+	ANNkd_flat_tree(					// load a snapshot
+		const char		*file);			// snapshot file name
+
+	~ANNkd_flat_tree();					// tree destructor
+
+	void Save(							// write a snapshot
+		const char		*file);			// snapshot file name
+
+	void annkSearch(					// approx k near neighbor search
+		ANNpoint		q,				// query point
+		int				k,				// number of near neighbors to return
+		ANNidxArray		nn_idx,			// nearest neighbor array (modified)
+		ANNdistArray	dd,				// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	void annkPriSearch( 				// priority k near neighbor search
+		ANNpoint		q,				// query point
+		int				k,				// number of near neighbors to return
+		ANNidxArray		nn_idx,			// nearest neighbor array (modified)
+		ANNdistArray	dd,				// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	int annkFRSearch(					// approx fixed-radius kNN search
+		ANNpoint		q,				// the query point
+		ANNdist			sqRad,			// squared radius of query ball
+		int				k,				// number of neighbors to return
+		ANNidxArray		nn_idx = NULL,	// nearest neighbor array (modified)
+		ANNdistArray	dd = NULL,		// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	int theDim()						// return dimension of space
+		{ return dim; }
+
+	int nPoints()						// return number of points
+		{ return n_pts; }
+
+	ANNpointArray thePoints()			// return pointer to points
+		{  return pts;  }
+
+	int nNodes()						// return number of nodes
+		{ return n_nodes; }
+};
+
+//----------------------------------------------------------------------
+//	kNN joins
+//		annKnnJoin finds, for every point of one kd- or bd-tree (the
+//		query tree), its k nearest neighbors among the points of
+//		another (the reference tree).  Rather than searching the
+//		reference tree from the root once for each query point, it
+//		traverses the two trees together, discarding pairs of nodes
+//		whose boxes are too far apart for one to hold neighbors of the
+//		other's points.  For low-dimensional data this is several
+//		times faster than searching for each point.  The error bound
+//		eps has the same meaning as in annkSearch; with eps = 0 the
+//		distances are the same as those returned by annkSearch (among
+//		points at equal distances, different ones may be returned).
+//		The work is divided among the given number of threads, as in
+//		annkSearchBatch.
+//
+//		The results are delivered in chunks, as the query tree is
+//		traversed, to the results() member of an ANNjoinSink supplied
+//		by the caller, so that they need not all be held in memory.
+//		Each call passes m query points, by their indices in the query
+//		tree's point array (q_idx), and their m*k results, the k
+//		results of q_idx[i] being stored starting at position i*k.
+//		The arrays belong to the join, and are only valid during the
+//		call.  Every query point appears in exactly one chunk.  The
+//		chunks come in no particular order, possibly from different
+//		threads, but never more than one call at a time.
+//
+//		The query points may also be given as an array, from which a
+//		query tree is built.  Alternatively the results may be
+//		written to two caller-owned arrays of n*k elements each,
+//		where n is the number of query points, the k results of query
+//		point i being stored starting at position i*k.
+//
+//		annAllKnn finds the k nearest neighbors of every point of a
+//		tree among the points of the same tree (as for a
+//		k-nearest-neighbor graph).  This is the join of the tree with
+//		itself.  If ANN_ALLOW_SELF_MATCH is ANNtrue (the default),
+//		each point is its own nearest neighbor, at distance 0.
+//----------------------------------------------------------------------
+
+class DLL_API ANNjoinSink {				// receives results of a kNN join
+public:
+	virtual ~ANNjoinSink() {}			// virtual destructor
+	virtual void results(				// a chunk of results
+		int				m,				// number of query points
+		ANNidxArray		q_idx,			// the query points (indices)
+		ANNidxArray		nn_idx,			// m*k near neighbor indices
+		ANNdistArray	dd) = 0;		// m*k dists to near neighbors
+};
+
+DLL_API void annKnnJoin(				// kNN join of two trees
+	ANNkd_tree&		qa,					// tree of the query points
+	ANNkd_tree&		ra,					// tree of the reference points
+	int				k,					// number of near neighbors per point
+	ANNjoinSink&	sink,				// receives the results
+	double			eps=0.0,			// error bound
+	int				threads=0);			// number of threads (0 = all)
+
+DLL_API void annKnnJoin(				// kNN join of queries and a tree
+	ANNpointArray	q,					// the query points
+	int				m,					// number of query points
+	ANNkd_tree&		ra,					// tree of the reference points
+	int				k,					// number of near neighbors per point
+	ANNjoinSink&	sink,				// receives the results
+	double			eps=0.0,			// error bound
+	int				threads=0);			// number of threads (0 = all)
+
+DLL_API void annKnnJoin(				// kNN join of two trees
+	ANNkd_tree&		qa,					// tree of the query points
+	ANNkd_tree&		ra,					// tree of the reference points
+	int				k,					// number of near neighbors per point
+	ANNidxArray		nn_idx,				// n*k near neighbor indices (modified)
+	ANNdistArray	dd,					// n*k dists to near neighbors (modified)
+	double			eps=0.0,			// error bound
+	int				threads=0);			// number of threads (0 = all)
+
+DLL_API void annAllKnn(					// k nearest neighbors of all points
+	ANNkd_tree&		tree,				// the tree of the points
+	int				k,					// number of near neighbors per point
+	ANNidxArray		nn_idx,				// n*k near neighbor indices (modified)
+	ANNdistArray	dd,					// n*k dists to near neighbors (modified)
+	double			eps=0.0,			// error bound
+	int				threads=0);			// number of threads (0 = all)
+
+//----------------------------------------------------------------------
+//	Closest pairs
+//		annkClosestPairs finds the k closest pairs of points of a kd-
+//		or bd-tree (for example, to find near-duplicates).  Pair i is
+//		returned as the indices idx1[i] < idx2[i] of its points, and
+//		its squared distance dd[i], in order of increasing distance.
+//		Points at distance 0 (duplicates) count as pairs, but a point
+//		is never paired with itself.  Like annAllKnn, this traverses
+//		the tree against itself, so that pairs of nodes whose boxes
+//		are farther apart than the k-th closest pair found so far are
+//		discarded without looking at their points.  With eps > 0 the
+//		boxes are shrunk by the factor 1+eps, as in annkSearch, so the
+//		distances may exceed the true k smallest by this factor.  The
+//		work is divided among the given number of threads, as in
+//		annkSearchBatch.  k must not exceed the number of pairs,
+//		n*(n-1)/2.
+//----------------------------------------------------------------------
+
+DLL_API void annkClosestPairs(			// k closest pairs of points
+	ANNkd_tree&		tree,				// the tree of the points
+	int				k,					// number of pairs
+	ANNidxArray		idx1,				// k first points (modified)
+	ANNidxArray		idx2,				// k second points (modified)
+	ANNdistArray	dd,					// k squared distances (modified)
+	double			eps=0.0,			// error bound
+	int				threads=0);			// number of threads (0 = all)
+
+//----------------------------------------------------------------------
+//	Sliding windows
+//		An ANNwindow holds the most recent points of a stream, and
+//		answers nearest neighbor and closest pair queries over them,
+//		without rebuilding a tree for every new point.  Each point is
+//		inserted with an index (ANNidx) chosen by the caller, which
+//		is what the queries return, and a time.  The times must not
+//		decrease.  Points leave the window in the order they arrived:
+//		when there are more than max_pts of them (if max_pts > 0),
+//		when they are older than max_age (if max_age > 0, a point of
+//		time t leaving when a point of time later than t + max_age is
+//		inserted), or when expire() is called.  expire(t) removes the
+//		points whose times are less than t.
+//
+//		The points are kept in a forest of kd-trees, each holding the
+//		points that arrived in some interval of time (the logarithmic
+//		method of Bentley and Saxe), so that each point is copied into
+//		a new tree O(log n) times as the window fills, and when the
+//		oldest points leave, the oldest tree is replaced by smaller
+//		ones over its remaining points.  Insertions and removals take
+//		O(log^2 n) amortized time, a search searches O(log n) trees,
+//		and only the points in the window are stored.  The window
+//		keeps its own copies of the points.
+//
+//		closestPair() returns the indices of the two closest points
+//		in the window, the older one first, and their squared
+//		distance, or ANNfalse if there are fewer than two points.  It
+//		keeps, as a heap, the nearest neighbor of each point at the
+//		time it was found.  The neighbors of points that have arrived
+//		since the last call are found when it is called (so insertions
+//		cost nothing extra if it is never called), and a neighbor
+//		that has left the window is replaced when its pair reaches the
+//		top of the heap.
+//----------------------------------------------------------------------
+
+struct ANNwindow_data;					// the forest (see kd_window.cpp)
+
+class DLL_API ANNwindow {
+protected:
+	int				dim;				// dimension of space
+	int				max_pts;			// max points (or 0)
+	double			max_age;			// max age of points (or 0)
+	ANNwindow_data	*data;				// the forest
+
+public:
+	ANNwindow(							// constructor
+		int				dd,				// dimension
+		int				max_pts = 0,	// max points in window (0 = any)
+		double			max_age = 0.0);	// max age of points (0 = any)
+
+	~ANNwindow();						// destructor
+
+	void insert(						// add a point
+		ANNpoint		p,				// the point (copied)
+		ANNidx			idx,			// its index
+		double			time = 0.0);	// its time
+
+	void expire(						// remove old points
+		double			time);			// remove points before this time
+
+	void annkSearch(					// approx k near neighbor search
+		ANNpoint		q,				// query point
+		int				k,				// number of near neighbors to return
+		ANNidxArray		nn_idx,			// nearest neighbor array (modified)
+		ANNdistArray	dd,				// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	ANNbool closestPair(				// closest pair of points
+		ANNidx			&idx1,			// older point (returned)
+		ANNidx			&idx2,			// newer point (returned)
+		ANNdist			&dist);			// squared distance (returned)
+
+	int theDim()						// return dimension of space
+		{ return dim; }
+
+	int nPoints();						// return number of points
+
+	int nTrees();						// return number of trees
+};
+
+//----------------------------------------------------------------------
+//	Dynamic point sets
+//		An ANNkd_forest is a set of points that can be searched like
+//		a kd-tree, and to which points can be added and from which
+//		they can be removed at any time, without building a tree over
+//		all of them again.  Each point is inserted with an index
+//		(ANNidx) chosen by the caller, which is what the searches
+//		return and what remove() is given.  The indices must be
+//		distinct.  The second constructor starts with the points of
+//		pa, with indices 0 to n-1.  The forest keeps its own copies of
+//		the points.
+//
+//		The points are kept in a forest of kd-trees (built with the
+//		given bucket size and splitting rule), as in ANNwindow, so
+//		that each point is copied into a new tree O(log n) times as
+//		the forest grows.  A removed point is taken out of the leaf
+//		of its tree, and a tree is built again once half of its
+//		points have been removed.  Insertions take O(log^2 n) and
+//		removals O(log n) amortized time (apart from the time to
+//		build the trees), and a search searches O(log n) trees.  The
+//		results are those of a tree built over the points in the set
+//		(up to the order of points at equal distances, and the points
+//		chosen by approximate searches).
+//
+//		annkFRSearch() returns the number of points within the
+//		squared radius sqRad of q, and the k closest of them, as
+//		ANNkd_tree::annkFRSearch() does.
+//----------------------------------------------------------------------
+
+struct ANNforest_data;					// the forest (see kd_forest.cpp)
+
+class DLL_API ANNkd_forest {
+protected:
+	int				dim;				// dimension of space
+	int				bkt_size;			// bucket size of the trees
+	ANNsplitRule	split;				// splitting rule of the trees
+	ANNforest_data	*data;				// the forest
+
+public:
+	ANNkd_forest(						// constructor (empty)
+		int				dd,				// dimension
+		int				bs = 1,			// bucket size
+		ANNsplitRule	split = ANN_KD_SUGGEST);	// splitting rule
+
+	ANNkd_forest(						// constructor (from points)
+		ANNpointArray	pa,				// point array
+		int				n,				// number of points
+		int				dd,				// dimension
+		int				bs = 1,			// bucket size
+		ANNsplitRule	split = ANN_KD_SUGGEST);	// splitting rule
+
+	~ANNkd_forest();					// destructor
+
+	void insert(						// add a point
+		ANNpoint		p,				// the point (copied)
+		ANNidx			idx);			// its index
+
+	ANNbool remove(						// remove a point (false if absent)
+		ANNidx			idx);			// its index
+
+	void annkSearch(					// approx k near neighbor search
+		ANNpoint		q,				// query point
+		int				k,				// number of near neighbors to return
+		ANNidxArray		nn_idx,			// nearest neighbor array (modified)
+		ANNdistArray	dd,				// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	int annkFRSearch(					// approx fixed-radius kNN search
+		ANNpoint		q,				// query point
+		ANNdist			sqRad,			// squared radius
+		int				k = 0,			// number of near neighbors to return
+		ANNidxArray		nn_idx = NULL,	// nearest neighbor array (modified)
+		ANNdistArray	dd = NULL,		// dist to near neighbors (modified)
+		double			eps=0.0);		// error bound
+
+	int theDim()						// return dimension of space
+		{ return dim; }
+
+	int nPoints();						// return number of points
+
+	int nTrees();						// return number of trees
+};
+
 //----------------------------------------------------------------------
 //	Other functions
 //	annMaxPtsVisit		Sets a limit on the maximum number of points
 //						to visit in the search.
+//	annLeafCoords		If set, trees built (or loaded) afterwards
+//						keep a copy of the coordinates of the points
+//						of each leaf, stored contiguously in tree
+//						order and in structure-of-arrays layout (all
+//						the first coordinates of the leaf, then all
+//						the second, and so on).  Leaf scans then read
+//						consecutive memory rather than one scattered
+//						point per bucket entry.  This costs a second
+//						copy of the points.  Results are unchanged.
+//						The default is off.
+//	annLeafCodes		If set to ANN_CODES_INT8 or ANN_CODES_INT16,
+//						kd- and bd-trees built (or loaded) afterwards
+//						keep, for the points of each leaf, one- or
+//						two-byte codes of the cells of a grid over
+//						the bounding box of the tree (the grid has
+//						256 or 65536 cells per dimension).  Leaf
+//						scans first compute lower bounds on the
+//						distances from the codes, and only compute
+//						the true distance, from the point array, for
+//						points whose bound is small enough.  This is
+//						a pruning accelerator, not a compression:
+//						the point array must still be resident, and
+//						the codes add n*dim (or 2*n*dim) bytes on top
+//						of it, so no memory is saved.  (They are
+//						smaller than the leaf coordinate blocks of
+//						annLeafCoords, which they replace.)  Results
+//						are unchanged.  This takes precedence over
+//						annLeafCoords.  The default is ANN_CODES_NONE.
+//	annSimdLevel		Leaf coordinate blocks are scanned using
+//						vector instructions (SSE2, AVX2 or AVX-512),
+//						chosen when the library is loaded according
+//						to what the processor supports.  This limits
+//						the instructions used to those of the given
+//						level (ANN_SIMD_NONE for plain C++), and
+//						returns the level actually used.  Results are
+//						the same at every level.  This should not be
+//						called while searches are running.  Vector
+//						scans are only used with the Euclidean norm.
+//	annBuildThreads		Sets the number of threads used to build kd-
+//						and bd-trees (0, the default, means one per
+//						hardware thread, and 1 means no parallelism).
+//						Large subtrees are built in parallel, and
+//						near the root the points are scanned and
+//						partitioned in parallel.  The tree is exactly
+//						the one that a single thread would build.
+//	annBuildSample		If size > 0, kd- and bd-trees built afterwards
+//						estimate the spread of the points of each
+//						node with more than 4*size points, along each
+//						dimension, from a sample of size of them, and
+//						when the split rule cuts at the median, cut at
+//						the median of the sample instead.  Smaller
+//						nodes are split exactly as usual.  This makes
+//						the top levels of the tree, whose nodes are
+//						the largest, much cheaper to build in high
+//						dimensions, at the cost of slightly less even
+//						splits.  The sample is chosen by a fixed rule,
+//						so the tree is the same from one build to the
+//						next.  A size of about 100 is a good choice.
+//						The default is 0 (exact splits).
+//	annBuildPresort		If on, kd-trees of the kd and sliding midpoint
+//						rules (ANN_KD_STD, ANN_KD_SL_MIDPT and
+//						ANN_KD_SUGGEST) built afterwards are built
+//						from the points sorted once along each
+//						dimension, in O(dn log n) time however the
+//						points are ordered, duplicated or (for the
+//						sliding midpoint rule) however unbalanced the
+//						tree.  The sorted orders take d*n indices of
+//						extra memory during the build.  The tree is
+//						the one built otherwise, except that points
+//						with the same coordinate as a cutting value
+//						may be divided differently between its sides.
+//						Splits are exact (annBuildSample does not
+//						apply).  The default is off.
+//	annFreeSearchSpace	Each thread that searches keeps a workspace
+//						(the list of the k closest points, the queue
+//						of priority search, etc.) from one search to
+//						the next, so that searches do no heap
+//						allocation once it is large enough.  This
+//						frees the workspace of the calling thread,
+//						which is otherwise freed when the thread
+//						exits.  It must not be called during a
+//						search.
 //  annClose			Can be called when all use of ANN is finished.
-//						It clears up a minor memory leak.
+//						It clears up a minor memory leak, stops
+//						the threads used by annkSearchBatch, and
+//						frees the workspaces of all threads.  It
+//						must not be called during a search.
 //----------------------------------------------------------------------
 
 DLL_API void annMaxPtsVisit(	// max. pts to visit in search
 	int				maxPts);	// the limit
 
+DLL_API void annLeafCoords(		// keep leaf coordinate blocks?
+	ANNbool			on);		// on or off
+
+enum ANNleafCodes {				// quantized leaf codes
+		ANN_CODES_NONE	= 0,		// none
+		ANN_CODES_INT8	= 1,		// one byte per coordinate
+		ANN_CODES_INT16	= 2};		// two bytes per coordinate
+
+DLL_API void annLeafCodes(		// keep quantized leaf codes?
+	ANNleafCodes	type);		// type of codes
+
+enum ANNsimdLevel {				// vector instructions for leaf scans
+		ANN_SIMD_NONE	= 0,		// none (plain C++)
+		ANN_SIMD_SSE2	= 1,		// SSE2 (2 coordinates at a time)
+		ANN_SIMD_AVX2	= 2,		// AVX2 (4 at a time)
+		ANN_SIMD_AVX512	= 3};		// AVX-512 (8 at a time)
+
+DLL_API ANNsimdLevel annSimdLevel(	// limit vector instructions used
+	ANNsimdLevel	max_level);		// highest level to use
+
+DLL_API void annBuildThreads(	// threads used to build trees
+	int				n);			// number of threads (0 = all)
+
+DLL_API void annBuildSample(	// estimate splits from samples
+	int				size);		// sample size (0 = exact)
+
+DLL_API void annBuildPresort(	// build from presorted points?
+	ANNbool			on);		// on or off
+
+DLL_API void annFreeSearchSpace();	// free this thread's workspace
+
 DLL_API void annClose();		// called to end use of ANN
 
+ANN_END_NAMESPACE
+
 #endif
@@ -36,6 +36,8 @@
 
 #include <ANN/ANN.h>					// basic ANN includes
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 // kd-tree stats object
 //	This object is used for collecting information about a kd-tree
@@ -220,4 +222,6 @@ DLL_API void annUpdateStats();				// update stats with current counts
 
 DLL_API void annPrintStats(ANNbool validate); // print statistics for a run
 
+ANN_END_NAMESPACE
+
 #endif
@@ -39,6 +39,8 @@
 #include <iomanip>				// I/O manipulators
 #include <ANN/ANN.h>			// ANN includes
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Global constants and types
 //----------------------------------------------------------------------
@@ -53,10 +55,52 @@ enum ANNerr {ANNwarn = 0, ANNabort = 1};
 //	number of points visited exceeds some threshold.  If the
 //	threshold is 0 (its default)  this means there is no limit
 //	and the algorithm applies its normal termination condition.
+//	The number of points visited so far is kept in the search
+//	context of each search (see ANNkd_search_ctx in kd_tree.h).
 //----------------------------------------------------------------------
 
 extern int		ANNmaxPtsVisited;	// maximum number of pts visited
-extern int		ANNptsVisited;		// number of pts visited in search
+
+//----------------------------------------------------------------------
+//	Leaf coordinate blocks
+//	If set, trees keep a structure-of-arrays copy of the points of
+//	each leaf (see kd_leaf_scan.h).  Read when a tree is built.
+//----------------------------------------------------------------------
+
+extern ANNbool	ANNuseLeafCoords;	// build leaf coordinate blocks?
+
+//----------------------------------------------------------------------
+//	Quantized leaf codes
+//	If not ANN_CODES_NONE, trees keep codes of the points of each
+//	leaf instead (see kd_leaf_quant.h).  Read when a tree is built.
+//----------------------------------------------------------------------
+
+extern ANNleafCodes ANNuseLeafCodes;	// build quantized leaf codes?
+
+//----------------------------------------------------------------------
+//	Parallel construction
+//	Number of threads used by the tree constructors (0 means one
+//	per hardware thread).  See kd_par_build.h.
+//----------------------------------------------------------------------
+
+extern int		ANNbuildThreads;	// threads used to build trees
+
+//----------------------------------------------------------------------
+//	Sampled construction
+//	Size of the samples from which the spreads and medians of large
+//	nodes are estimated (0 means they are computed exactly).  See
+//	kd_util.cpp.
+//----------------------------------------------------------------------
+
+extern int		ANNbuildSample;		// size of build samples
+
+//----------------------------------------------------------------------
+//	Presorted construction
+//	Whether kd-trees of the kd and sliding midpoint rules are built
+//	from presorted points.  See kd_presort.cpp.
+//----------------------------------------------------------------------
+
+extern ANNbool	ANNbuildPresort;	// build from presorted points?
 
 //----------------------------------------------------------------------
 //	Global function declarations
@@ -166,4 +210,6 @@ public:
 								// array of halfspaces
 typedef ANNorthHalfSpace *ANNorthHSArray;
 
+ANN_END_NAMESPACE
+
 #endif
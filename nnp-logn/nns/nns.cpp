@@ -3,12 +3,13 @@
 // the query and data point. The program allocates storage for data points, one query 
 // point, and results, consisting of the nearest neighbor indices and the distances. 
 // The program inputs the data points and builds a kd-tree search structure for these
-// points. Then it reads query points, and for each computes k approximate nearest 
-// neighbors with error bound, and outputs the results.
+// points. Then it reads the query points, computes k approximate nearest neighbors 
+// with error bound for all of them in one batch (spread over several threads), and 
+// outputs the results.
 //
 // After compiling it can be run as follows.
 // 
-// nns [-d dim] [-max m] [-nn k] [-e eps] [-df data] [-qf query] [-rf result]
+// nns [-d dim] [-max m] [-nn k] [-e eps] [-t threads] [-df data] [-qf query] [-rf result]
 //
 // where:
 //
@@ -16,6 +17,7 @@
 //		m		maximum number of data points (default = 10000)
 //		k		number of nearest neighbors per query (default 1)
 //		eps		the error bound (default = 0.0)
+//		threads	number of search threads (default = 0, one per core)
 //		data	name of file containing data points
 //		query	name of file containing query points
 //		result	name of file containing the results
@@ -38,6 +40,8 @@ int main(int argc, char **argv)
 	int					num_points = 0;			// Actual number of data points
 	ANNpointArray		data_points;			// Data points
 	ANNpoint			query_point;			// Query point
+	vector<ANNpoint>	query_points;			// Query points
+	int					num_queries;			// Number of query points
 	ANNidxArray			near_neighbor_idx;		// Near neighbor indices
 	ANNdistArray		near_neighbor_distances;// Near neighbor distances
 	ANNkd_tree *		kd_tree_adt;			// ADT search structure
@@ -47,18 +51,9 @@ int main(int argc, char **argv)
 	// Read command-line arguments
 	UI.getArgs(argc, argv);						
 
-	// Allocate query point
-	query_point = annAllocPt(UI.dimension);
-
 	// Allocate data points
 	data_points = annAllocPts(UI.max_points, UI.dimension);
 
-	// Allocate near neighbor indices
-	near_neighbor_idx = new ANNidx[UI.k];
-
-	// Allocate near neighbor distances
-	near_neighbor_distances = new ANNdist[UI.k];														
-
 	// Echo data points
 	cout << "Data Points: \n";
 
@@ -88,23 +83,43 @@ int main(int argc, char **argv)
 		*(UI.results_out) << "\n\nQuery points: \n";
 
 	// Read query points
+	query_point = annAllocPt(UI.dimension);
+
 	while (UI.readPoint(*(UI.query_in), query_point)) 
+	{
+		query_points.push_back(query_point);
+		query_point = annAllocPt(UI.dimension);
+	}
+
+	annDeallocPt(query_point);
+
+	num_queries = (int) query_points.size();
+
+	// Allocate near neighbor indices and distances (k per query point)
+	near_neighbor_idx = new ANNidx[num_queries * UI.k];
+	near_neighbor_distances = new ANNdist[num_queries * UI.k];
+
+	// Perform the search for all query points at once
+	// Params: query points, number of query points, number of near neighbors, nearest neighbors (returned), 
+	// distances (returned), error bound, number of threads
+	if (num_queries > 0)
+	{
+		kd_tree_adt->annkSearchBatch(&query_points[0], num_queries, UI.k, near_neighbor_idx, near_neighbor_distances, UI.eps, UI.threads);
+	}
+
+	for (int i = 0; i < num_queries; i++)
 	{		
-		UI.printPoint(cout, query_point, UI.dimension);
+		UI.printPoint(cout, query_points[i], UI.dimension);
 
 		if (UI.results_out != NULL)
 		{
-			UI.printPoint(*(UI.results_out), query_point, UI.dimension);
+			UI.printPoint(*(UI.results_out), query_points[i], UI.dimension);
 		}
 
-		// Perform the search
-		// Params: query point, number of near neighbors, nearest neighbors (returned), distance (returned), error bound
-		kd_tree_adt->annkSearch(query_point, UI.k, near_neighbor_idx, near_neighbor_distances, UI.eps);
-
-		UI.printSummary(cout, &near_neighbor_idx, &near_neighbor_distances);
+		UI.printSummary(cout, near_neighbor_idx + i * UI.k, near_neighbor_distances + i * UI.k);
 
 		if (UI.results_out != NULL)
-			UI.printSummary(*(UI.results_out), &near_neighbor_idx, &near_neighbor_distances);
+			UI.printSummary(*(UI.results_out), near_neighbor_idx + i * UI.k, near_neighbor_distances + i * UI.k);
 	}
 
 	// Perform house cleaning tasks
@@ -112,6 +127,11 @@ int main(int argc, char **argv)
     delete [] near_neighbor_idx;							
     delete [] near_neighbor_distances;
 
+	for (int i = 0; i < num_queries; i++)
+	{
+		annDeallocPt(query_points[i]);
+	}
+
 	annClose();
 
 	cin.get();
@@ -1,8 +1,8 @@
 
 #include "ui.h"	
 
-UserInterface::UserInterface( int k_d, int d, double e, int m_p, iostream * d_i, iostream * q_i,  iostream * r_o ) : 
-	k(k_d), dimension(d), eps(e), max_points(m_p), data_in(d_i), query_in(q_i), results_out(r_o) { }
+UserInterface::UserInterface( int k_d, int d, double e, int m_p, iostream * d_i, iostream * q_i,  iostream * r_o, int t ) : 
+	k(k_d), dimension(d), eps(e), max_points(m_p), threads(t), data_in(d_i), query_in(q_i), results_out(r_o) { }
 
 UserInterface::~UserInterface() 
 { 
@@ -40,17 +40,17 @@ void UserInterface::printPoint(ostream & out, ANNpoint p, int num_points)
 }
 
 // Print summary
-void UserInterface::printSummary(ostream & out, ANNidxArray near_neighbor_idx[], ANNdistArray near_neighbor_distances[])			
+void UserInterface::printSummary(ostream & out, ANNidxArray near_neighbor_idx, ANNdistArray near_neighbor_distances)			
 {
 	out << "\n\nNN:\tIndex\tDistance\n";
 
 	for (int i = 0; i < k; i++) 
 	{	
 		// Unsquare the computed distance
-		// *near_neighbor_distances[i] = sqrt(*near_neighbor_distances[i]);
+		// near_neighbor_distances[i] = sqrt(near_neighbor_distances[i]);
 
 		// Unsquare the computed distance and print out the summary
-		out << i << "\t" << *near_neighbor_idx[i] << "\t" << sqrt(*near_neighbor_distances[i]) << "\n";
+		out << i << "\t" << near_neighbor_idx[i] << "\t" << sqrt(near_neighbor_distances[i]) << "\n";
 	}
 }
 
@@ -66,12 +66,13 @@ void UserInterface::getArgs(int argc, char **argv)
 	{			
 		// Alert the user and advise about proper usage of the program
 		cerr << "Usage:\n\n" 
-			<< "  nns [-d dim] [-max m] [-nn k] [-e eps] [-df data] [-qf query] [-rf result]\n\n"
+			<< "  nns [-d dim] [-max m] [-nn k] [-e eps] [-t threads] [-df data] [-qf query] [-rf result]\n\n"
 			<< "  where:\n\n"
 			<< "    dim		dimension of the space (default = 2)\n"
 			<< "    m		maximum number of data points (default = 10000)\n"
 			<< "    k		number of nearest neighbors per query (default 1)\n"
 			<< "    eps		the error bound (default = 0.0)\n"
+			<< "    threads	number of search threads (default = 0, one per core)\n"
 			<< "    data	name of file containing data points\n"
 			<< "    query	name of file containing query points\n"
 			<< "    result	name of file containing the results\n\n"
@@ -112,6 +113,11 @@ void UserInterface::getArgs(int argc, char **argv)
 			// Get the error bound
 			sscanf(argv[++i], "%lf", &eps);			
 		}
+		else if (!strcmp(argv[i], "-t"))
+		{		
+			// Get the number of search threads
+			threads = atoi(argv[++i]);					
+		}
 		else if (!strcmp(argv[i], "-df"))		
 		{		
 			// Get the data points file	
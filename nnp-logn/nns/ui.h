@@ -6,6 +6,7 @@
 #include <string>		// string manipulation
 #include <iostream>		// console I/O
 #include <fstream>		// file I/O
+#include <vector>		// query point list
 #include <math.h>		// math functions
 #include <ctime>		// seeding srand
 #include <ANN/ANN.h>	// ANN declarations
@@ -23,7 +24,7 @@ class UserInterface
 	public:
 
 		UserInterface( int k = 1, int dimension = 2, double eps = 0, int max_points = 10000, 
-			iostream * data_in = NULL, iostream * query_in = NULL,  iostream * results_out = NULL );
+			iostream * data_in = NULL, iostream * query_in = NULL,  iostream * results_out = NULL, int threads = 0 );
 
 		~UserInterface();
 
@@ -37,13 +38,14 @@ class UserInterface
 		void printPoint(ostream & out, ANNpoint p, int num_points);
 
 		// Print summary
-		void printSummary(ostream & out, ANNidxArray near_neighbor_idx[], ANNdistArray near_neighbor_distances[]);
+		void printSummary(ostream & out, ANNidxArray near_neighbor_idx, ANNdistArray near_neighbor_distances);
 
 		// Global parameters that are set in getArgs()
 		int				k;				// Number of nearest neighbors
 		int				dimension;		// Dimension
 		double			eps;			// Error bound
 		int				max_points;		// Maximum number of data points
+		int				threads;		// Number of search threads (0 = all cores)
 		iostream *		data_in;		// Input for data points
 		iostream *		query_in;		// Input for query points
 		iostream *		results_out;	// Output for results
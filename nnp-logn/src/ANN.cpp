@@ -24,6 +24,12 @@
 //		Added performance counting to annDist()
 //	Revision 1.1.2  01/27/10
 //		Fixed minor compilation bugs for new versions of gcc
+//	Revision 1.2
+//		Added annLeafCoords()
+//		Added annBuildThreads()
+//		Added annLeafCodes()
+//		Added annBuildSample()
+//		Added annBuildPresort()
 //----------------------------------------------------------------------
 
 #include <cstdlib>						// C standard lib defs
@@ -32,6 +38,8 @@
 
 using namespace std;					// make std:: accessible
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Point methods
 //----------------------------------------------------------------------
@@ -188,7 +196,48 @@ void annError(const char* msg, ANNerr level)
 //----------------------------------------------------------------------
 
 int	ANNmaxPtsVisited = 0;	// maximum number of pts visited
-int	ANNptsVisited;			// number of pts visited in search
+
+//----------------------------------------------------------------------
+//	Leaf coordinate blocks
+//		If this is set, the tree constructors store a copy of the
+//		coordinates of the points of each leaf in a contiguous block
+//		(see kd_leaf_scan.h).
+//----------------------------------------------------------------------
+
+ANNbool	ANNuseLeafCoords = ANNfalse;	// build leaf coordinate blocks?
+
+//----------------------------------------------------------------------
+//	Quantized leaf codes
+//		If this is not ANN_CODES_NONE, the tree constructors store
+//		codes of the points of each leaf instead (see kd_leaf_quant.h).
+//----------------------------------------------------------------------
+
+ANNleafCodes ANNuseLeafCodes = ANN_CODES_NONE;	// build leaf codes?
+
+//----------------------------------------------------------------------
+//	Parallel construction
+//		Number of threads used by the tree constructors.  Zero means
+//		one per hardware thread.
+//----------------------------------------------------------------------
+
+int		ANNbuildThreads = 0;			// threads used to build trees
+
+//----------------------------------------------------------------------
+//	Sampled construction
+//		Size of the samples from which the tree constructors estimate
+//		the spreads and medians of large nodes.  Zero means they are
+//		computed exactly.
+//----------------------------------------------------------------------
+
+int		ANNbuildSample = 0;				// size of build samples
+
+//----------------------------------------------------------------------
+//	Presorted construction
+//		Whether the kd-tree constructor builds trees of the kd and
+//		sliding midpoint rules from presorted points.
+//----------------------------------------------------------------------
+
+ANNbool	ANNbuildPresort = ANNfalse;		// build from presorted points?
 
 //----------------------------------------------------------------------
 //	Global function declarations
@@ -199,3 +248,35 @@ void annMaxPtsVisit(			// set limit on max. pts to visit in search
 {
 	ANNmaxPtsVisited = maxPts;
 }
+
+void annLeafCoords(				// keep leaf coordinate blocks?
+	ANNbool				on)				// on or off
+{
+	ANNuseLeafCoords = on;
+}
+
+void annLeafCodes(				// keep quantized leaf codes?
+	ANNleafCodes		type)			// type of codes
+{
+	ANNuseLeafCodes = type;
+}
+
+void annBuildThreads(			// threads used to build trees
+	int					n)				// number of threads
+{
+	ANNbuildThreads = (n < 0 ? 0 : n);
+}
+
+void annBuildSample(			// estimate splits from samples
+	int					size)			// sample size
+{
+	ANNbuildSample = (size < 0 ? 0 : size);
+}
+
+void annBuildPresort(			// build from presorted points?
+	ANNbool				on)				// on or off
+{
+	ANNbuildPresort = on;
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------
+// File:			batch_search.cpp
+// Programmer:		NNP contributors
+// Description:		Batched k-nearest neighbor search
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include <ANN/ANNx.h>					// all ANN includes
+#include "thread_pool.h"				// thread pool
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	annkSearchBatch - k nearest neighbors of many query points
+//		The generic version simply calls annkSearch for each query.
+//		Since searches keep no global state, the queries are divided
+//		among the threads of a pool with annParallelFor.  The range
+//		is cut into pieces of a few queries each, which is enough
+//		to let idle threads steal work when some queries are much
+//		more expensive than others, while keeping the per-task
+//		overhead small compared to the searches themselves.
+//----------------------------------------------------------------------
+
+const int ANN_BATCH_PIECES	= 16;		// pieces per thread (about)
+const int ANN_BATCH_GRAIN	= 64;		// max queries per piece
+
+class ANNbatch_body : public ANNrange_body {
+	ANNpointSet		*ps;				// the search structure
+	ANNpointArray	q;					// the queries
+	int				k;					// number of near neighbors
+	ANNidxArray		nn_idx;				// near neighbor indices
+	ANNdistArray	dd;					// near neighbor distances
+	double			eps;				// error bound
+public:
+	ANNbatch_body(ANNpointSet *s, ANNpointArray qa, int kk,
+			ANNidxArray ia, ANNdistArray da, double e)
+		{ ps = s; q = qa; k = kk; nn_idx = ia; dd = da; eps = e; }
+
+	void run(int lo, int hi)
+	{
+		for (int i = lo; i < hi; i++) {
+			ps->annkSearch(q[i], k, nn_idx + (size_t) i*k, dd + (size_t) i*k, eps);
+		}
+	}
+};
+
+void ANNpointSet::annkSearchBatch(
+	ANNpointArray		q,				// query points
+	int					m,				// number of query points
+	int					k,				// number of near neighbors per query
+	ANNidxArray			nn_idx,			// m*k near neighbor indices (returned)
+	ANNdistArray		dd,				// m*k near neighbor dists (returned)
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	if (m <= 0) return;
+	if (k > nPoints()) {				// check here, not in the workers
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+
+	ANNbatch_body body(this, q, k, nn_idx, dd, eps);
+	if (threads == 1 || m == 1) {		// nothing to divide
+		body.run(0, m);
+		return;
+	}
+
+	ANNthread_pool *pool = annThreadPool(threads);
+	int grain = m / (pool->nThreads() * ANN_BATCH_PIECES);
+	if (grain > ANN_BATCH_GRAIN) grain = ANN_BATCH_GRAIN;
+	if (grain < 1) grain = 1;
+
+	annParallelFor(pool, 0, m, grain, body);
+}
+
+ANN_END_NAMESPACE
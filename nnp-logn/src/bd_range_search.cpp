@@ -0,0 +1,77 @@
+//----------------------------------------------------------------------
+// File:			bd_range_search.cpp
+// Programmer:		NNP contributors
+// Description:		Orthogonal range search for bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+// 
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+// 
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "bd_tree.h"					// bd-tree declarations
+#include "kd_range_search.h"			// kd range search declarations
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Orthogonal range search for bd-trees
+//		See the file kd_range_search.cpp for the search itself.  Here
+//		we include the extension for shrinking nodes.  The cell of the
+//		inner child is the node's cell cut by the bounding halfspaces.
+//		The cell of the outer child is not a box, so the node's whole
+//		cell is used for it, which is correct (if it lies in the query
+//		box, so do all the points of the outer child), but may visit
+//		the outer child when it need not.
+//----------------------------------------------------------------------
+
+void ANNbd_shrink::ann_range_search(ANNkd_range_ctx &ctx)
+{
+	if (ctx.n_out == 0 && ctx.n_found >= ctx.k) {
+		ctx.n_found += n_sub;			// count the whole subtree
+		return;
+	}
+
+	child[ANN_OUT]->ann_range_search(ctx);	// search outer child
+
+	ANNcoord *old = new ANNcoord[n_bnds];	// cell sides replaced
+	ANNbool meets = ANNtrue;			// inner cell meets the box?
+	int i;
+	for (i = 0; i < n_bnds; i++) {		// cut cell by the halfspaces
+		int cd = bnds[i].cd;
+		ANNcoord cv = bnds[i].cv;
+		if (bnds[i].sd > 0) {			// lower bound
+			old[i] = ctx.cell.lo[cd];
+			if (cv > old[i]) ctx.set_lo(cd, cv);
+			if (cv > ctx.hi[cd]) meets = ANNfalse;
+		}
+		else {							// upper bound
+			old[i] = ctx.cell.hi[cd];
+			if (cv < old[i]) ctx.set_hi(cd, cv);
+			if (cv < ctx.lo[cd]) meets = ANNfalse;
+		}
+	}
+	if (meets) {
+		child[ANN_IN]->ann_range_search(ctx);	// search inner child
+	}
+	for (i = n_bnds-1; i >= 0; i--) {	// restore the cell
+		if (bnds[i].sd > 0)
+			ctx.set_lo(bnds[i].cd, old[i]);
+		else
+			ctx.set_hi(bnds[i].cd, old[i]);
+	}
+	delete [] old;
+	ANN_SHR(1)							// one more shrinking node
+}
+
+ANN_END_NAMESPACE
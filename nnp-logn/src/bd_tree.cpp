@@ -24,14 +24,24 @@
 //		Fixed centroid shrink threshold condition to depend on the
 //			dimension.
 //		Moved dump routine to kd_dump.cpp.
+//	Revision 1.2
+//		Added leaf coordinate blocks (fill_coords()).
+//		Added quantized leaf codes (fill_codes()).
+//		Added fill_leaves().
+//		Added subtree point counts (fill_counts()).
+//		Large subtrees are built in parallel.
+//		Fixed simple shrink looping on identical points.
 //----------------------------------------------------------------------
 
 #include "bd_tree.h"					// bd-tree declarations
 #include "kd_util.h"					// kd-tree utilities
 #include "kd_split.h"					// kd-tree splitting rules
+#include "kd_par_build.h"				// parallel construction
 
 #include <ANN/ANNperf.h>				// performance evaluation
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Printing a bd-tree 
 //		These routines print a bd-tree.   See the analogous procedure
@@ -125,6 +135,7 @@ ANNbd_tree::ANNbd_tree(					// construct from point array
 	pts = pa;							// where the points are
 	if (n == 0) return;					// no points--no sweat
 
+	ANNbuild_scope scope(annBuildPoolFor(n));	// parallel if large
 	ANNorthRect bnd_box(dd);			// bounding box for points
 										// construct bounding rectangle
 	annEnclRect(pa, pidx, n, dd, bnd_box);
@@ -153,6 +164,49 @@ ANNbd_tree::ANNbd_tree(					// construct from point array
 	default:
 		annError("Illegal splitting method", ANNabort);
 	}
+	root->fill_counts();				// count points of subtrees
+
+	if (ANNuseLeafCodes != ANN_CODES_NONE)	// quantize points to the leaves
+		MakeLeafCodes();
+	else if (ANNuseLeafCoords)			// copy points to the leaves
+		MakeLeafCoords();
+}
+
+//----------------------------------------------------------------------
+//	Leaf coordinate blocks and codes, subtree counts
+//		See the analogous procedures in kd_tree.cpp.
+//----------------------------------------------------------------------
+
+void ANNbd_shrink::fill_coords(					// set leaf coord blocks
+	ANNpointArray		pa,						// the points
+	int					dim,					// dimension of space
+	ANNidxArray			pidx,					// tree's point indices
+	ANNcoord			*block)					// tree's coordinate array
+{
+	child[ANN_IN]->fill_coords(pa, dim, pidx, block);
+	child[ANN_OUT]->fill_coords(pa, dim, pidx, block);
+}
+
+void ANNbd_shrink::fill_codes(					// set leaf code blocks
+	ANNleaf_quant		&lq,					// the quantizer
+	ANNpointArray		pa,						// the points
+	ANNidxArray			pidx)					// tree's point indices
+{
+	child[ANN_IN]->fill_codes(lq, pa, pidx);
+	child[ANN_OUT]->fill_codes(lq, pa, pidx);
+}
+
+int ANNbd_shrink::fill_counts()					// set subtree counts
+{
+	n_sub = child[ANN_IN]->fill_counts() + child[ANN_OUT]->fill_counts();
+	return n_sub;
+}
+
+void ANNbd_shrink::fill_leaves(					// set leaves of points
+	ANNkd_leaf			**leaf_of)				// leaves (modified)
+{
+	child[ANN_IN]->fill_leaves(leaf_of);
+	child[ANN_OUT]->fill_leaves(leaf_of);
 }
 
 //----------------------------------------------------------------------
@@ -173,7 +227,9 @@ enum ANNdecomp {SPLIT, SHRINK};			// decomposition methods
 //		shrinking the longest box size will decrease, and if we use
 //		the standard bounding box, we may decide to shrink twice in
 //		a row.  Since the tight box is fixed, we cannot shrink twice
-//		consecutively.)
+//		consecutively.)  A side is never shrunk if its gap is zero,
+//		as otherwise a box of identical points (whose longest side is
+//		zero) would be shrunk to itself over and over.
 //----------------------------------------------------------------------
 const float BD_GAP_THRESH = 0.5;		// gap threshold (must be < 1)
 const int   BD_CT_THRESH  = 2;			// min number of shrink sides
@@ -203,13 +259,13 @@ ANNdecomp trySimpleShrink(				// try a simple shrink
 												// gap between boxes
 		ANNcoord gap_hi = bnd_box.hi[i] - inner_box.hi[i];
 												// big enough gap to shrink?
-		if (gap_hi < max_length*BD_GAP_THRESH)
+		if (gap_hi < max_length*BD_GAP_THRESH || gap_hi <= 0)
 			inner_box.hi[i] = bnd_box.hi[i];	// no - expand
 		else shrink_ct++;						// yes - shrink this side
 
 												// repeat for high side
 		ANNcoord gap_lo = inner_box.lo[i] - bnd_box.lo[i];
-		if (gap_lo < max_length*BD_GAP_THRESH)
+		if (gap_lo < max_length*BD_GAP_THRESH || gap_lo <= 0)
 			inner_box.lo[i] = bnd_box.lo[i];	// no - expand
 		else shrink_ct++;						// yes - shrink this side
 	}
@@ -330,8 +386,37 @@ ANNdecomp selectDecomp(			// select decomposition method
 //		appropriate shrinking bounds, and create a shrinking node.
 //		Finally the points are subdivided, and the procedure is
 //		invoked recursively on the two subsets to form the children.
+//
+//		As in rkd_tree(), when building with a thread pool and both
+//		children have many points, the first (low or inner) child is
+//		built by a task of the pool.
 //----------------------------------------------------------------------
 
+class ANNbd_subtree_task : public ANNtask {	// build a subtree
+	ANNkd_ptr			&root;			// where to put it
+	ANNpointArray		pa;				// point array
+	ANNidxArray			pidx;			// point indices
+	int					n;				// number of points
+	int					dim;			// dimension of space
+	int					bsp;			// bucket space
+	ANNorthRect			bnd_box;		// bounding box (a copy)
+	ANNkd_splitter		splitter;		// splitting routine
+	ANNshrinkRule		shrink;			// shrinking rule
+	ANNthread_pool		*pool;			// the pool
+public:
+	ANNbd_subtree_task(ANNkd_ptr &r, ANNpointArray a, ANNidxArray pi,
+			int nn, int dd, int bs, const ANNorthRect &bb,
+			ANNkd_splitter sp, ANNshrinkRule sh, ANNthread_pool *pl)
+		: root(r), pa(a), pidx(pi), n(nn), dim(dd), bsp(bs),
+		  bnd_box(dd, bb), splitter(sp), shrink(sh), pool(pl) {}
+
+	void run()
+		{
+			ANNbuild_scope scope(pool);
+			root = rbd_tree(pa, pidx, n, dim, bsp, bnd_box, splitter, shrink);
+		}
+};
+
 ANNkd_ptr rbd_tree(				// recursive construction of bd-tree
 	ANNpointArray		pa,				// point array
 	ANNidxArray			pidx,			// point indices to store in subtree
@@ -369,18 +454,36 @@ ANNkd_ptr rbd_tree(				// recursive construction of bd-tree
 
 		ANNcoord lv = bnd_box.lo[cd];	// save bounds for cutting dimension
 		ANNcoord hv = bnd_box.hi[cd];
-
-		bnd_box.hi[cd] = cv;			// modify bounds for left subtree
-		ANNkd_ptr lo = rbd_tree(		// build left subtree
-				pa, pidx, n_lo,			// ...from pidx[0..n_lo-1]
-				dim, bsp, bnd_box, splitter, shrink);
-		bnd_box.hi[cd] = hv;			// restore bounds
-
-		bnd_box.lo[cd] = cv;			// modify bounds for right subtree
-		ANNkd_ptr hi = rbd_tree(		// build right subtree
-				pa, pidx + n_lo, n-n_lo,// ...from pidx[n_lo..n-1]
-				dim, bsp, bnd_box, splitter, shrink);
-		bnd_box.lo[cd] = lv;			// restore bounds
+		ANNkd_ptr lo, hi;				// low and high children
+
+		ANNthread_pool *pool = annBuildPool();
+		if (pool != NULL && n_lo >= ANN_PAR_SUBTREE &&
+				n-n_lo >= ANN_PAR_SUBTREE) {
+			ANNtask_group group;		// build left subtree in parallel
+			bnd_box.hi[cd] = cv;
+			pool->spawn(group, new ANNbd_subtree_task(lo, pa, pidx, n_lo,
+					dim, bsp, bnd_box, splitter, shrink, pool));
+			bnd_box.hi[cd] = hv;
+
+			bnd_box.lo[cd] = cv;		// build right subtree here
+			hi = rbd_tree(pa, pidx + n_lo, n-n_lo,
+					dim, bsp, bnd_box, splitter, shrink);
+			bnd_box.lo[cd] = lv;
+			pool->wait(group);			// wait for left subtree
+		}
+		else {
+			bnd_box.hi[cd] = cv;		// modify bounds for left subtree
+			lo = rbd_tree(				// build left subtree
+					pa, pidx, n_lo,		// ...from pidx[0..n_lo-1]
+					dim, bsp, bnd_box, splitter, shrink);
+			bnd_box.hi[cd] = hv;		// restore bounds
+
+			bnd_box.lo[cd] = cv;		// modify bounds for right subtree
+			hi = rbd_tree(				// build right subtree
+					pa, pidx + n_lo, n-n_lo,// ...from pidx[n_lo..n-1]
+					dim, bsp, bnd_box, splitter, shrink);
+			bnd_box.lo[cd] = lv;		// restore bounds
+		}
 										// create the splitting node
 		return new ANNkd_split(cd, cv, lv, hv, lo, hi);
 	}
@@ -396,10 +499,26 @@ ANNkd_ptr rbd_tree(				// recursive construction of bd-tree
 				inner_box,				// inner box
 				n_in);					// number of points inside (returned)
 
-		ANNkd_ptr in = rbd_tree(		// build inner subtree pidx[0..n_in-1]
-				pa, pidx, n_in, dim, bsp, inner_box, splitter, shrink);
-		ANNkd_ptr out = rbd_tree(		// build outer subtree pidx[n_in..n]
-				pa, pidx+n_in, n - n_in, dim, bsp, bnd_box, splitter, shrink);
+		ANNkd_ptr in, out;				// inner and outer children
+
+		ANNthread_pool *pool = annBuildPool();
+		if (pool != NULL && n_in >= ANN_PAR_SUBTREE &&
+				n-n_in >= ANN_PAR_SUBTREE) {
+			ANNtask_group group;		// build inner subtree in parallel
+			pool->spawn(group, new ANNbd_subtree_task(in, pa, pidx, n_in,
+					dim, bsp, inner_box, splitter, shrink, pool));
+			out = rbd_tree(				// build outer subtree here
+					pa, pidx+n_in, n - n_in, dim, bsp, bnd_box,
+					splitter, shrink);
+			pool->wait(group);			// wait for inner subtree
+		}
+		else {
+			in = rbd_tree(				// build inner subtree pidx[0..n_in-1]
+					pa, pidx, n_in, dim, bsp, inner_box, splitter, shrink);
+			out = rbd_tree(				// build outer subtree pidx[n_in..n]
+					pa, pidx+n_in, n - n_in, dim, bsp, bnd_box,
+					splitter, shrink);
+		}
 
 		ANNorthHSArray bnds = NULL;		// bounds (alloc in Box2Bnds and
 										// ...freed in bd_shrink destroyer)
@@ -415,3 +534,5 @@ ANNkd_ptr rbd_tree(				// recursive construction of bd-tree
 		return new ANNbd_shrink(n_bnds, bnds, in, out);
 	}
 } 
+
+ANN_END_NAMESPACE
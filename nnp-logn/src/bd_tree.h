@@ -22,6 +22,13 @@
 //		Initial release
 //	Revision 1.0  04/01/05
 //		Changed IN, OUT to ANN_IN, ANN_OUT
+//	Revision 1.2
+//		Search routines take an ANNkd_search_ctx.
+//		Added flatten() (see kd_flat.h).
+//		Added fill_coords() (see kd_leaf_scan.h).
+//		Added fill_codes() (see kd_leaf_quant.h).
+//		Added fill_leaves() (see kd_forest.cpp).
+//		Added subtree point counts and range search (see kd_range_search.h).
 //----------------------------------------------------------------------
 
 #ifndef ANN_bd_tree_H
@@ -30,6 +37,8 @@
 #include <ANN/ANNx.h>					// all ANN includes
 #include "kd_tree.h"					// kd-tree includes
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	bd-tree shrinking node.
 //		The main addition in the bd-tree is the shrinking node, which
@@ -61,6 +70,7 @@
 class ANNbd_shrink : public ANNkd_node	// splitting node of a kd-tree
 {
 	int					n_bnds;			// number of bounding halfspaces
+	int					n_sub;			// no. points in subtree
 	ANNorthHSArray		bnds;			// list of bounding halfspaces
 	ANNkd_ptr			child[2];		// in and out children
 public:
@@ -70,6 +80,7 @@ public:
 		ANNkd_ptr ic=NULL, ANNkd_ptr oc=NULL)	// children
 		{
 			n_bnds			= nb;				// cutting dimension
+			n_sub			= 0;				// not counted yet
 			bnds			= bds;				// assign bounds
 			child[ANN_IN]	= ic;				// set children
 			child[ANN_OUT]	= oc;
@@ -91,10 +102,29 @@ public:
 				ANNorthRect &bnd_box);			// bounding box
 	virtual void print(int level, ostream &out);// print node
 	virtual void dump(ostream &out);			// dump node
+												// append to flat tree
+	virtual void flatten(ANNflat_build &fb);
+												// set leaf coord blocks
+	virtual void fill_coords(ANNpointArray pa, int dim,
+				ANNidxArray pidx, ANNcoord *block);
+												// set leaf code blocks
+	virtual void fill_codes(ANNleaf_quant &lq, ANNpointArray pa,
+				ANNidxArray pidx);
+												// set leaves of points
+	virtual void fill_leaves(ANNkd_leaf **leaf_of);
+												// set subtree counts
+	virtual int fill_counts();
 
-	virtual void ann_search(ANNdist);			// standard search
-	virtual void ann_pri_search(ANNdist);		// priority search
-	virtual void ann_FR_search(ANNdist); 		// fixed-radius search
+												// standard search
+	virtual void ann_search(ANNdist, ANNkd_search_ctx&);
+												// priority search
+	virtual void ann_pri_search(ANNdist, ANNkd_search_ctx&);
+												// fixed-radius search
+	virtual void ann_FR_search(ANNdist, ANNkd_search_ctx&);
+												// orthogonal range search
+	virtual void ann_range_search(ANNkd_range_ctx&);
 };
 
+ANN_END_NAMESPACE
+
 #endif
@@ -22,10 +22,18 @@
 //		Initial release
 //	Revision 1.1  05/03/05
 //		Added fixed-radius kNN search
+//	Revision 1.2
+//		Queues are borrowed from the thread's search workspace
+//		Added a blocked annkSearchBatch
 //----------------------------------------------------------------------
 
 #include <ANN/ANNx.h>					// all ANN includes
 #include "pr_queue_k.h"					// k element priority queue
+#include "search_space.h"				// search workspaces
+#include "kd_leaf_scan.h"				// coordinate blocks and kernels
+#include "thread_pool.h"				// thread pool
+
+ANN_BEGIN_NAMESPACE
 
 //----------------------------------------------------------------------
 //		Brute-force search simply stores a pointer to the list of
@@ -58,7 +66,8 @@ void ANNbruteForce::annkSearch(			// approx k near neighbor search
 	ANNdistArray		dd,				// dist to near neighbors (returned)
 	double				eps)			// error bound (ignored)
 {
-	ANNmink mk(k);						// construct a k-limited priority queue
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &mk = ws->mink(k);			// k-limited priority queue
 	int i;
 
 	if (k > n_pts) {					// too many near neighbors?
@@ -85,7 +94,8 @@ int ANNbruteForce::annkFRSearch(		// approx fixed-radius kNN search
 	ANNdistArray		dd,				// dist to near neighbors (returned)
 	double				eps)			// error bound
 {
-	ANNmink mk(k);						// construct a k-limited priority queue
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &mk = ws->mink(k);			// k-limited priority queue
 	int i;
 	int pts_in_range = 0;				// number of points in query range
 										// run every point through queue
@@ -107,3 +117,105 @@ int ANNbruteForce::annkFRSearch(		// approx fixed-radius kNN search
 
 	return pts_in_range;
 }
+
+//----------------------------------------------------------------------
+//	annkSearchBatch - blocked brute-force search for many queries
+//		Searching the queries one at a time streams the whole point
+//		array through the cache once per query.  Instead, the queries
+//		are taken in blocks of ANN_BRUTE_QUERIES, and the points in
+//		tiles of about ANN_BRUTE_TILE bytes, which stay in cache while
+//		every query of the block is compared with them.  Each tile is
+//		copied into a coordinate block (see kd_leaf_scan.h), and the
+//		queries are run against it by annScanLeafCoords, which uses
+//		the vector distance kernels and gives up on runs of points
+//		that are all farther than the k-th closest point so far.  The
+//		k closest points of each query of the block are kept in its
+//		own small list, which stays in the L1 cache.
+//
+//		The distances are summed in the same order as by annDist, and
+//		the points are offered to each list in index order, so the
+//		results are exactly those of annkSearch.  The query blocks are
+//		divided among the threads of a pool.
+//----------------------------------------------------------------------
+
+const int ANN_BRUTE_QUERIES	= 32;		// queries per block
+const int ANN_BRUTE_TILE	= 1 << 16;	// bytes of coordinates per tile
+
+class ANNbrute_body : public ANNrange_body {
+	ANNpointArray	pts;				// the points
+	int				n_pts;				// number of points
+	int				dim;				// dimension
+	ANNpointArray	q;					// the queries
+	int				k;					// number of near neighbors
+	ANNidxArray		nn_idx;				// near neighbor indices
+	ANNdistArray	dd;					// near neighbor distances
+public:
+	ANNbrute_body(ANNpointArray pa, int n, int dd_, ANNpointArray qa,
+			int kk, ANNidxArray ia, ANNdistArray da)
+		{ pts = pa; n_pts = n; dim = dd_; q = qa; k = kk; nn_idx = ia; dd = da; }
+
+	void run(int lo, int hi);			// search queries [lo, hi)
+};
+
+void ANNbrute_body::run(int lo, int hi)
+{
+										// points per tile
+	int tile = ANN_BRUTE_TILE / (dim * (int) sizeof(ANNcoord));
+	tile -= tile % ANN_SCAN_RUN;		// a whole number of runs
+	if (tile < ANN_SCAN_RUN) tile = ANN_SCAN_RUN;
+	if (tile > n_pts) tile = n_pts;
+
+	ANNcoord *block = new ANNcoord[(size_t) tile * dim];
+	ANNidxArray idx = new ANNidx[tile];	// indices of tile's points
+	ANNmink *mk = new ANNmink[ANN_BRUTE_QUERIES];
+
+	for (int q0 = lo; q0 < hi; q0 += ANN_BRUTE_QUERIES) {
+		int nq = (hi - q0 < ANN_BRUTE_QUERIES ? hi - q0 : ANN_BRUTE_QUERIES);
+		int i, j;
+		for (j = 0; j < nq; j++) mk[j].reset(k);
+
+		for (int i0 = 0; i0 < n_pts; i0 += tile) {
+			int nt = (n_pts - i0 < tile ? n_pts - i0 : tile);
+			for (i = 0; i < nt; i++) idx[i] = i0 + i;
+			annFillLeafCoords(block, pts, idx, nt, dim);
+			for (j = 0; j < nq; j++) {	// run the queries over the tile
+				annScanLeafCoords(block, idx, nt, dim, q[q0 + j], mk[j]);
+			}
+		}
+		for (j = 0; j < nq; j++) {		// extract the k closest points
+			ANNidxArray ia = nn_idx + (size_t) (q0 + j)*k;
+			ANNdistArray da = dd + (size_t) (q0 + j)*k;
+			for (i = 0; i < k; i++) {
+				da[i] = mk[j].ith_smallestkey(i);
+				ia[i] = mk[j].ith_smallest_info(i);
+			}
+		}
+	}
+	delete [] mk;
+	delete [] idx;
+	delete [] block;
+}
+
+void ANNbruteForce::annkSearchBatch(
+	ANNpointArray		q,				// query points
+	int					m,				// number of query points
+	int					k,				// number of near neighbors per query
+	ANNidxArray			nn_idx,			// m*k near neighbor indices (returned)
+	ANNdistArray		dd,				// m*k near neighbor dists (returned)
+	double				/*eps*/,		// error bound (ignored)
+	int					threads)		// number of threads (0 = all)
+{
+	if (m <= 0) return;
+	if (k > n_pts) {					// too many near neighbors?
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+
+	ANNbrute_body body(pts, n_pts, dim, q, k, nn_idx, dd);
+	if (threads == 1 || m <= ANN_BRUTE_QUERIES) {	// nothing to divide
+		body.run(0, m);
+		return;
+	}
+	annParallelFor(annThreadPool(threads), 0, m, ANN_BRUTE_QUERIES, body);
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,508 @@
+//----------------------------------------------------------------------
+// File:			kd_all_knn.cpp
+// Programmer:		NNP contributors
+// Description:		Dual-tree kNN joins for kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//		Added joins of two trees (annKnnJoin), with streamed results
+//----------------------------------------------------------------------
+
+#include <mutex>						// serializes the sink
+
+#include "kd_join.h"					// join trees
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "pr_queue_k.h"					// k-element priority queue
+#include "thread_pool.h"				// thread pool
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	annKnnJoin - k nearest neighbors in one tree of each point of another
+//	annAllKnn - k nearest neighbors of every point of a tree
+//		Rather than searching the reference tree once for each query
+//		point, this traverses the query tree against the reference
+//		tree (a dual-tree traversal), visiting pairs of nodes: a query
+//		node, whose points are searched for, and a reference node,
+//		whose points are candidates.  A pair is discarded as soon as
+//		the distance between the boxes of the two nodes exceeds the
+//		bound of the query node, which is the largest of the current
+//		k-th smallest distances of its points.  So one box comparison
+//		stands for the comparisons of every point of the query node
+//		with the reference node, and the work done to find the
+//		neighbors of one point is shared with its neighbors in the
+//		tree.  annAllKnn is the join of a tree with itself.
+//
+//		The traversal uses copies of the trees (join trees, see
+//		kd_join.h), in which every node has the smallest box enclosing
+//		its points and its bound, and each subtree of at most
+//		ANN_ALL_KNN_LEAF points is a single leaf.
+//
+//		Each query point keeps its k closest points so far in its own
+//		ANNmink.  When a pair of leaves is reached, each query point
+//		is compared with the points of the reference leaf, unless its
+//		own k-th smallest distance rules the leaf out.  The points of
+//		each reference leaf are copied into a coordinate block, so
+//		that this is done by the vector leaf scans.  Otherwise the
+//		larger of the two nodes is split (the query node, if they are
+//		the same size).  The children of a reference node are visited
+//		closer first, and a query node's bound is recomputed from
+//		those of its children after they have been visited.
+//
+//		As in the standard search, the boxes are shrunk by the factor
+//		1+eps, so that with eps > 0 each point may be given
+//		approximate neighbors.  With eps = 0 the distances returned
+//		are exactly those of annkSearch, although among points at
+//		equal distances different ones may be returned.
+//
+//		The query tree is cut into subtrees (chunks) of at most
+//		ANN_JOIN_CHUNK points, and smaller still when there are
+//		several threads, so that there are about ANN_ALL_KNN_TASKS
+//		chunks per thread.  Each chunk is traversed against the whole
+//		reference tree by a task of the thread pool, with ANNmink's
+//		for its own points only, and its results are handed to the
+//		sink as soon as it is done.  So the results need never all be
+//		held in memory at once.  The chunks have disjoint points, so
+//		the tasks share nothing but the (read-only) reference tree.
+//----------------------------------------------------------------------
+
+const int ANN_ALL_KNN_TASKS = 8;		// tasks per thread
+const int ANN_JOIN_CHUNK	= 1 << 16;	// max points of a chunk
+
+//----------------------------------------------------------------------
+//	Join tree construction
+//		The tree is flattened, and its nodes copied in postorder (the
+//		children before the parent).  The points of a subtree are a
+//		contiguous range of pidx, and so are its nodes, which are
+//		replaced by a single leaf if it has few enough points.  Only
+//		reference trees need leaf coordinate blocks.
+//----------------------------------------------------------------------
+
+ANNjoin_tree::ANNjoin_tree(
+	ANNkd_tree			&tree,			// the tree
+	ANNbool				with_coords,	// make leaf coordinate blocks?
+	int					leaf)			// max points of a leaf
+{
+	dim = tree.dim;
+	n_pts = tree.n_pts;
+	max_leaf = leaf;
+	pts = tree.pts;
+	root = -1;
+
+	ANNflat_build fb;
+	if (tree.root == NULL) return;		// (skeleton trees have no nodes)
+	tree.root->flatten(fb);
+	pidx.swap(fb.pidx);
+	nodes.reserve(fb.nodes.size());
+	lo.reserve(fb.nodes.size() * dim);
+	hi.reserve(fb.nodes.size() * dim);
+	root = build(fb.nodes, 0);
+
+	if (with_coords) {
+		coords.resize((size_t) n_pts * dim);
+		for (size_t j = 0; j < nodes.size(); j++) {
+			const ANNjoin_node &nd = nodes[j];
+			if (nd.child[0] < 0) {
+				annFillLeafCoords(&coords[(size_t) nd.first * dim], pts,
+						&pidx[nd.first], nd.n, dim);
+			}
+		}
+	}
+}
+
+int ANNjoin_tree::build(
+	const std::vector<ANNflat_node> &fn,	// flat nodes
+	int					i)				// root of subtree
+{
+	const ANNflat_node &f = fn[i];
+	ANNjoin_node nd;
+	int d;
+
+	if (f.cut_dim == ANN_FLAT_LEAF) {	// leaf
+		if (f.n == 0) return -1;		// drop empty leaves
+		nd.first = f.off;
+		nd.n = f.n;
+		nd.child[0] = nd.child[1] = -1;
+		nd.bound = ANN_DIST_INF;
+		int j = (int) nodes.size();
+		nodes.push_back(nd);
+		ANNpoint p = pts[pidx[f.off]];
+		for (d = 0; d < dim; d++) {		// box of the points
+			lo.push_back(p[d]);
+			hi.push_back(p[d]);
+		}
+		for (int m = 1; m < f.n; m++) {
+			p = pts[pidx[f.off + m]];
+			for (d = 0; d < dim; d++) {
+				if (p[d] < lo[j*dim + d]) lo[j*dim + d] = p[d];
+				if (p[d] > hi[j*dim + d]) hi[j*dim + d] = p[d];
+			}
+		}
+		return j;
+	}
+										// splitting or shrinking node
+	int start = (int) nodes.size();		// first node of subtree
+	int c0 = build(fn, i+1);
+	int c1 = build(fn, f.far);
+	if (c0 < 0) return c1;				// only one nonempty child
+	if (c1 < 0) return c0;
+
+	nd.first = nodes[c0].first < nodes[c1].first ?
+					nodes[c0].first : nodes[c1].first;
+	nd.n = nodes[c0].n + nodes[c1].n;
+	nd.child[0] = c0;
+	nd.child[1] = c1;
+	nd.bound = ANN_DIST_INF;
+	for (d = 0; d < dim; d++) {			// union of the children's boxes
+		ANNcoord l0 = lo[c0*dim + d], l1 = lo[c1*dim + d];
+		ANNcoord h0 = hi[c0*dim + d], h1 = hi[c1*dim + d];
+		lo.push_back(l0 < l1 ? l0 : l1);
+		hi.push_back(h0 > h1 ? h0 : h1);
+	}
+	if (nd.n <= max_leaf) {				// small enough for a leaf
+		for (d = 0; d < dim; d++) {		// move box over the subtree's
+			lo[start*dim + d] = lo[lo.size() - dim + d];
+			hi[start*dim + d] = hi[hi.size() - dim + d];
+		}
+		nodes.resize(start);
+		lo.resize((start+1) * dim);
+		hi.resize((start+1) * dim);
+		nd.child[0] = nd.child[1] = -1;
+	}
+	int j = (int) nodes.size();
+	nodes.push_back(nd);
+	return j;
+}
+
+void ANNjoin_tree::subtrees(int q, int max_n, std::vector<int> &out)
+{
+	if (nodes[q].child[0] < 0 || nodes[q].n <= max_n) {
+		out.push_back(q);
+	}
+	else {
+		subtrees(nodes[q].child[0], max_n, out);
+		subtrees(nodes[q].child[1], max_n, out);
+	}
+}
+
+//----------------------------------------------------------------------
+//	ANNknn_join - a dual-tree traversal
+//		The query tree and the reference tree may be the same object
+//		(annAllKnn).  The traversal only changes the bounds of the
+//		query nodes, which the reference side never reads.  The
+//		ANNmink of the query point at position i of the query tree's
+//		pidx is mk[i - off], where off is the first position of the
+//		chunk being traversed.
+//----------------------------------------------------------------------
+
+class ANNknn_join {
+public:
+	ANNjoin_tree		&qt;			// query tree
+	const ANNjoin_tree	&rt;			// reference tree
+	int					dim;			// dimension of space
+	int					k;				// number of near neighbors
+	double				max_err;		// max tolerable squared error
+	ANNjoinSink			&sink;			// receives the results
+	std::mutex			sink_lock;		// one sink call at a time
+
+	ANNknn_join(ANNjoin_tree &q, const ANNjoin_tree &r, int kk,
+			double eps, ANNjoinSink &s)
+		: qt(q), rt(r), sink(s)
+		{ dim = q.dim; k = kk; max_err = ANN_POW(1.0 + eps); }
+
+	ANNdist box_dist(int q, int r);		// distance between boxes
+	ANNdist point_dist(ANNpoint p, int r);	// distance to box
+	void base(int q, int r, ANNmink *mk, int off);	// compare two leaves
+	void join(int q, int r, ANNmink *mk, int off);	// traverse a pair
+	void chunk(int q);					// traverse a chunk, send results
+};
+
+//----------------------------------------------------------------------
+//	Box distances
+//----------------------------------------------------------------------
+
+ANNdist ANNknn_join::box_dist(int q, int r)	// distance between boxes
+{
+	const ANNcoord *la = &qt.lo[q*dim], *ha = &qt.hi[q*dim];
+	const ANNcoord *lb = &rt.lo[r*dim], *hb = &rt.hi[r*dim];
+	ANNdist dist = 0;
+	for (int d = 0; d < dim; d++) {
+		ANNcoord t;
+		if (lb[d] > ha[d])		t = lb[d] - ha[d];	// r above q
+		else if (la[d] > hb[d])	t = la[d] - hb[d];	// r below q
+		else continue;								// overlap
+		dist = ANN_SUM(dist, ANN_POW(t));
+	}
+	ANN_FLOP(3*dim)						// increment floating ops
+	return dist;
+}
+
+ANNdist ANNknn_join::point_dist(ANNpoint p, int r)	// distance to box
+{
+	const ANNcoord *lb = &rt.lo[r*dim], *hb = &rt.hi[r*dim];
+	ANNdist dist = 0;
+	for (int d = 0; d < dim; d++) {
+		ANNcoord t;
+		if (p[d] < lb[d])		t = lb[d] - p[d];
+		else if (p[d] > hb[d])	t = p[d] - hb[d];
+		else continue;
+		dist = ANN_SUM(dist, ANN_POW(t));
+	}
+	ANN_FLOP(3*dim)						// increment floating ops
+	return dist;
+}
+
+//----------------------------------------------------------------------
+//	base - compare the points of two leaves
+//		Each point of the query leaf whose k-th smallest distance does
+//		not rule out the reference leaf scans the leaf's coordinate
+//		block (see kd_leaf_scan.h), and then the query leaf's bound is
+//		updated.
+//----------------------------------------------------------------------
+
+void ANNknn_join::base(int q, int r, ANNmink *mk, int off)
+{
+	const ANNjoin_node &qn = qt.nodes[q];
+	const ANNjoin_node &rn = rt.nodes[r];
+	ANNidxArray bkt = (ANNidxArray) &rt.pidx[rn.first];
+	const ANNcoord *block = &rt.coords[(size_t) rn.first * dim];
+	ANNdist bound = 0;					// new bound of query leaf
+
+	for (int i = qn.first; i < qn.first + qn.n; i++) {
+		ANNpoint qq = qt.pts[qt.pidx[i]];
+		ANNmink &pmk = mk[i - off];
+		ANNdist min_dist = pmk.maxkey();	// k-th smallest distance so far
+
+		if (point_dist(qq, r) * max_err < min_dist) {
+			annScanLeafCoords(block, bkt, rn.n, dim, qq, pmk);
+			min_dist = pmk.maxkey();
+			ANN_PTS(rn.n)				// increment points visited
+		}
+		if (min_dist > bound) bound = min_dist;
+	}
+	ANN_LEAF(1)							// one more leaf node visited
+	qt.nodes[q].bound = bound;
+}
+
+//----------------------------------------------------------------------
+//	join - traverse a pair of nodes
+//----------------------------------------------------------------------
+
+void ANNknn_join::join(int q, int r, ANNmink *mk, int off)
+{
+	if (box_dist(q, r) * max_err >= qt.nodes[q].bound) {
+		return;							// nothing close enough
+	}
+	const ANNjoin_node &qn = qt.nodes[q];
+	const ANNjoin_node &rn = rt.nodes[r];
+
+	if (qn.child[0] < 0 && rn.child[0] < 0) {	// two leaves
+		base(q, r, mk, off);
+	}
+	else if (qn.child[0] < 0 || (rn.child[0] >= 0 && rn.n > qn.n)) {
+		int r0 = rn.child[0], r1 = rn.child[1];	// split reference node
+		ANNdist d0 = box_dist(q, r0);
+		ANNdist d1 = box_dist(q, r1);
+		if (d1 < d0) { int t = r0; r0 = r1; r1 = t; }
+		join(q, r0, mk, off);			// closer child first
+		join(q, r1, mk, off);
+	}
+	else {								// split query node
+		int q0 = qn.child[0], q1 = qn.child[1];
+		join(q0, r, mk, off);
+		join(q1, r, mk, off);
+		ANNdist b0 = qt.nodes[q0].bound, b1 = qt.nodes[q1].bound;
+		qt.nodes[q].bound = (b0 > b1 ? b0 : b1);
+	}
+	ANN_SPL(1)							// one more splitting node visited
+}
+
+//----------------------------------------------------------------------
+//	chunk - traverse a query subtree and send its results
+//----------------------------------------------------------------------
+
+void ANNknn_join::chunk(int q)
+{
+	int m = qt.nodes[q].n;				// points in the chunk
+	int off = qt.nodes[q].first;
+	ANNmink *mk = new ANNmink[m];
+	int i, j;
+	for (i = 0; i < m; i++) mk[i].reset(k);
+
+	join(q, rt.root, mk, off);
+
+	ANNidxArray q_idx = new ANNidx[m];
+	ANNidxArray nn_idx = new ANNidx[(size_t) m*k];
+	ANNdistArray dd = new ANNdist[(size_t) m*k];
+	for (i = 0; i < m; i++) {			// extract the k closest points
+		q_idx[i] = qt.pidx[off + i];
+		for (j = 0; j < k; j++) {
+			dd[(size_t) i*k + j] = mk[i].ith_smallestkey(j);
+			nn_idx[(size_t) i*k + j] = mk[i].ith_smallest_info(j);
+		}
+	}
+	delete [] mk;
+	{
+		std::lock_guard<std::mutex> lk(sink_lock);
+		sink.results(m, q_idx, nn_idx, dd);
+	}
+	delete [] q_idx;
+	delete [] nn_idx;
+	delete [] dd;
+}
+
+class ANNknn_join_body : public ANNrange_body {
+	ANNknn_join			&kj;			// the traversal
+	const std::vector<int> &sub;		// the chunks
+public:
+	ANNknn_join_body(ANNknn_join &j, const std::vector<int> &s)
+		: kj(j), sub(s) {}
+
+	void run(int lo, int hi)			// traverse chunks [lo, hi)
+		{
+			for (int i = lo; i < hi; i++) kj.chunk(sub[i]);
+		}
+};
+
+//----------------------------------------------------------------------
+//	annJoinTrees - join two join trees
+//		The chunks are divided among the threads (if there is more
+//		than one), or else traversed in order by the calling thread.
+//----------------------------------------------------------------------
+
+static void annJoinTrees(
+	ANNjoin_tree		&qt,			// query tree
+	const ANNjoin_tree	&rt,			// reference tree
+	int					k,				// number of near neighbors
+	ANNjoinSink			&sink,			// receives the results
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	if (qt.dim != rt.dim) {
+		annError("Joined trees differ in dimension", ANNabort);
+	}
+	if (qt.root < 0) return;			// no queries
+	if (k > rt.n_pts || rt.root < 0) {	// too many near neighbors?
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+
+	ANNknn_join kj(qt, rt, k, eps, sink);
+	ANNthread_pool *pool = (threads == 1 ? NULL : annThreadPool(threads));
+	int n_thr = (pool == NULL ? 1 : pool->nThreads());
+
+	int max_n = ANN_JOIN_CHUNK;			// cut the query tree into chunks
+	if (n_thr > 1 && qt.n_pts / (ANN_ALL_KNN_TASKS * n_thr) < max_n) {
+		max_n = qt.n_pts / (ANN_ALL_KNN_TASKS * n_thr);
+	}
+	std::vector<int> sub;
+	qt.subtrees(qt.root, max_n, sub);
+
+	ANNknn_join_body body(kj, sub);
+	if (n_thr == 1) {
+		body.run(0, (int) sub.size());
+	}
+	else {
+		annParallelFor(pool, 0, (int) sub.size(), 1, body);
+	}
+}
+
+//----------------------------------------------------------------------
+//	ANNjoin_arrays - a sink that stores the results in two arrays
+//----------------------------------------------------------------------
+
+class ANNjoin_arrays : public ANNjoinSink {
+	int					k;				// number of near neighbors
+	ANNidxArray			nn_idx;			// near neighbor indices
+	ANNdistArray		dd;				// near neighbor distances
+public:
+	ANNjoin_arrays(int kk, ANNidxArray ia, ANNdistArray da)
+		{ k = kk; nn_idx = ia; dd = da; }
+
+	void results(int m, ANNidxArray q_idx, ANNidxArray ia, ANNdistArray da)
+		{
+			for (int i = 0; i < m; i++) {
+				size_t to = (size_t) q_idx[i] * k;
+				for (int j = 0; j < k; j++) {
+					nn_idx[to + j] = ia[(size_t) i*k + j];
+					dd[to + j] = da[(size_t) i*k + j];
+				}
+			}
+		}
+};
+
+//----------------------------------------------------------------------
+//	The entry points
+//----------------------------------------------------------------------
+
+void annKnnJoin(
+	ANNkd_tree			&qa,			// tree of the query points
+	ANNkd_tree			&ra,			// tree of the reference points
+	int					k,				// number of near neighbors
+	ANNjoinSink			&sink,			// receives the results
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	if (&qa == &ra) {					// self-join: one join tree
+		ANNjoin_tree jt(qa, ANNtrue);
+		annJoinTrees(jt, jt, k, sink, eps, threads);
+	}
+	else {
+		ANNjoin_tree qt(qa, ANNfalse);
+		ANNjoin_tree rt(ra, ANNtrue);
+		annJoinTrees(qt, rt, k, sink, eps, threads);
+	}
+}
+
+void annKnnJoin(
+	ANNpointArray		q,				// the query points
+	int					m,				// number of query points
+	ANNkd_tree			&ra,			// tree of the reference points
+	int					k,				// number of near neighbors
+	ANNjoinSink			&sink,			// receives the results
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	if (m <= 0) return;
+	ANNkd_tree qa(q, m, ra.theDim());	// organize the queries
+	annKnnJoin(qa, ra, k, sink, eps, threads);
+}
+
+void annKnnJoin(
+	ANNkd_tree			&qa,			// tree of the query points
+	ANNkd_tree			&ra,			// tree of the reference points
+	int					k,				// number of near neighbors
+	ANNidxArray			nn_idx,			// n*k near neighbor indices (returned)
+	ANNdistArray		dd,				// n*k near neighbor dists (returned)
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	ANNjoin_arrays sink(k, nn_idx, dd);
+	annKnnJoin(qa, ra, k, sink, eps, threads);
+}
+
+void annAllKnn(
+	ANNkd_tree			&tree,			// the tree of the points
+	int					k,				// number of near neighbors
+	ANNidxArray			nn_idx,			// n*k near neighbor indices (returned)
+	ANNdistArray		dd,				// n*k near neighbor dists (returned)
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	annKnnJoin(tree, tree, k, nn_idx, dd, eps, threads);
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,337 @@
+//----------------------------------------------------------------------
+// File:			kd_close_pairs.cpp
+// Programmer:		NNP contributors
+// Description:		k closest pairs of points of a kd- or bd-tree
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include <algorithm>					// heap operations
+#include <atomic>						// shared bound
+#include <mutex>						// serializes the merges
+
+#include "kd_join.h"					// join trees
+#include "thread_pool.h"				// thread pool
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	annkClosestPairs - k closest pairs of points of a tree
+//		This is a dual-tree traversal of a join tree (see kd_join.h)
+//		against itself.  It visits pairs of nodes, and each pair of
+//		points is reached through exactly one pair of nodes: a node
+//		is paired with itself, which leads to the pairs of its
+//		children (each child with itself, and the two children with
+//		each other), and two different nodes are paired as long as
+//		the boxes of their points are closer than the k-th smallest
+//		distance of the pairs found so far.  Of two different nodes,
+//		the larger is split (the first, if they are the same size),
+//		and the children are visited closer first.  Pairs of leaves
+//		compare all their pairs of points.
+//
+//		As in the standard search, the boxes are shrunk by the factor
+//		1+eps, so with eps > 0 the distances returned may exceed the
+//		true k smallest ones by this factor.  Points at distance 0
+//		(duplicates) count as pairs.
+//
+//		With several threads, the tree is cut into subtrees (chunks),
+//		about ANN_CLOSE_PAIRS_TASKS per thread, and each pair of chunks
+//		(including each chunk with itself) is a task of the thread
+//		pool, the closest ones first.  Each task keeps the closest
+//		pairs it finds in its own set, and merges them into the
+//		result when it is done.  The tasks prune with the smallest
+//		of their own k-th distance and the k-th distance of the
+//		result so far, which they share.
+//----------------------------------------------------------------------
+
+const int ANN_CLOSE_PAIRS_LEAF = 16;	// max points of a leaf
+const int ANN_CLOSE_PAIRS_TASKS = 8;	// chunks per thread
+
+struct ANNpair {						// a pair of points
+	ANNdist				dist;			// squared distance
+	ANNidx				i, j;			// the points
+
+	bool operator<(const ANNpair &p) const	// order by distance
+		{ return dist < p.dist; }
+};
+
+//----------------------------------------------------------------------
+//	ANNpair_set - the k closest pairs so far
+//		The pairs are kept in a max-heap by distance, so that the
+//		farthest one is replaced first.
+//----------------------------------------------------------------------
+
+class ANNpair_set {
+public:
+	int					k;				// number of pairs wanted
+	std::vector<ANNpair> heap;			// the pairs (a max-heap)
+
+	ANNpair_set(int kk)					// constructor
+		{ k = kk; heap.reserve(k); }
+
+	ANNdist maxkey() const				// k-th smallest distance
+		{ return (int) heap.size() < k ? ANN_DIST_INF : heap[0].dist; }
+
+	void insert(ANNdist d, ANNidx i, ANNidx j)	// add a pair
+		{
+			ANNpair p;
+			p.dist = d;
+			p.i = (i < j ? i : j);
+			p.j = (i < j ? j : i);
+			if ((int) heap.size() == k) {	// full: drop the farthest
+				if (!(d < heap[0].dist)) return;
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = p;
+			}
+			else {
+				heap.push_back(p);
+			}
+			std::push_heap(heap.begin(), heap.end());
+		}
+};
+
+//----------------------------------------------------------------------
+//	ANNclose_pairs - the traversal
+//----------------------------------------------------------------------
+
+class ANNclose_pairs {
+public:
+	const ANNjoin_tree	&jt;			// the join tree
+	int					dim;			// dimension of space
+	double				max_err;		// max tolerable squared error
+	ANNpair_set			result;			// the closest pairs
+	std::atomic<ANNdist> shared;		// k-th distance of result
+	std::mutex			result_lock;	// one merge at a time
+
+	ANNclose_pairs(const ANNjoin_tree &t, int k, double eps)
+		: jt(t), result(k), shared(ANN_DIST_INF)
+		{ dim = t.dim; max_err = ANN_POW(1.0 + eps); }
+
+	ANNdist bound(const ANNpair_set &ps)	// pruning distance
+		{
+			ANNdist b = ps.maxkey(), s = shared.load();
+			return (b < s ? b : s);
+		}
+
+	ANNdist box_dist(int a, int b);		// distance between boxes
+	void compare(int i, int j, ANNpair_set &ps);	// compare two points
+	void base(int a, int b, ANNpair_set &ps);	// compare two leaves
+	void join(int a, int b, ANNpair_set &ps);	// traverse a pair
+	void merge(const ANNpair_set &ps);	// add pairs to the result
+};
+
+ANNdist ANNclose_pairs::box_dist(int a, int b)	// distance between boxes
+{
+	const ANNcoord *la = &jt.lo[a*dim], *ha = &jt.hi[a*dim];
+	const ANNcoord *lb = &jt.lo[b*dim], *hb = &jt.hi[b*dim];
+	ANNdist dist = 0;
+	for (int d = 0; d < dim; d++) {
+		ANNcoord t;
+		if (lb[d] > ha[d])		t = lb[d] - ha[d];	// b above a
+		else if (la[d] > hb[d])	t = la[d] - hb[d];	// b below a
+		else continue;								// overlap
+		dist = ANN_SUM(dist, ANN_POW(t));
+	}
+	ANN_FLOP(3*dim)						// increment floating ops
+	return dist;
+}
+
+//----------------------------------------------------------------------
+//	compare - compare the points at positions i and j of pidx
+//	base - compare the points of two leaves (or of one leaf)
+//----------------------------------------------------------------------
+
+void ANNclose_pairs::compare(int i, int j, ANNpair_set &ps)
+{
+	ANNpoint p = jt.pts[jt.pidx[i]];
+	ANNpoint q = jt.pts[jt.pidx[j]];
+	ANNdist min_dist = bound(ps);		// k-th smallest distance so far
+	ANNdist dist = 0;
+	int d;
+	for (d = 0; d < dim; d++) {
+		ANN_COORD(1)					// one more coordinate hit
+		ANN_FLOP(4)						// increment floating ops
+
+		ANNcoord t = p[d] - q[d];
+										// exceeds k-th smallest?
+		if ((dist = ANN_SUM(dist, ANN_POW(t))) >= min_dist) {
+			return;
+		}
+	}
+	ps.insert(dist, jt.pidx[i], jt.pidx[j]);
+}
+
+void ANNclose_pairs::base(int a, int b, ANNpair_set &ps)
+{
+	const ANNjoin_node &na = jt.nodes[a];
+	const ANNjoin_node &nb = jt.nodes[b];
+	int i, j;
+
+	if (a == b) {						// pairs within one leaf
+		for (i = na.first; i < na.first + na.n; i++) {
+			for (j = i + 1; j < na.first + na.n; j++) compare(i, j, ps);
+		}
+	}
+	else {								// pairs across two leaves
+		for (i = na.first; i < na.first + na.n; i++) {
+			for (j = nb.first; j < nb.first + nb.n; j++) compare(i, j, ps);
+		}
+	}
+	ANN_PTS(na.n)						// increment points visited
+	ANN_LEAF(1)							// one more leaf node visited
+}
+
+//----------------------------------------------------------------------
+//	join - traverse a pair of nodes
+//----------------------------------------------------------------------
+
+void ANNclose_pairs::join(int a, int b, ANNpair_set &ps)
+{
+	const ANNjoin_node &na = jt.nodes[a];
+	const ANNjoin_node &nb = jt.nodes[b];
+
+	if (a == b) {						// a node with itself
+		if (na.child[0] < 0) {
+			base(a, a, ps);
+		}
+		else {
+			join(na.child[0], na.child[0], ps);
+			join(na.child[1], na.child[1], ps);
+			join(na.child[0], na.child[1], ps);
+		}
+		return;
+	}
+	if (box_dist(a, b) * max_err >= bound(ps)) {
+		return;							// nothing close enough
+	}
+	if (na.child[0] < 0 && nb.child[0] < 0) {	// two leaves
+		base(a, b, ps);
+		return;
+	}
+	int s = a, o = b;					// split s, keep o
+	if (na.child[0] < 0 || (nb.child[0] >= 0 && nb.n > na.n)) {
+		s = b; o = a;
+	}
+	int s0 = jt.nodes[s].child[0], s1 = jt.nodes[s].child[1];
+	ANNdist d0 = box_dist(s0, o);
+	ANNdist d1 = box_dist(s1, o);
+	if (d1 < d0) { int t = s0; s0 = s1; s1 = t; }
+	join(s0, o, ps);					// closer child first
+	join(s1, o, ps);
+	ANN_SPL(1)							// one more splitting node visited
+}
+
+//----------------------------------------------------------------------
+//	merge - add the pairs of a task to the result
+//----------------------------------------------------------------------
+
+void ANNclose_pairs::merge(const ANNpair_set &ps)
+{
+	std::lock_guard<std::mutex> lk(result_lock);
+	for (size_t i = 0; i < ps.heap.size(); i++) {
+		const ANNpair &p = ps.heap[i];
+		result.insert(p.dist, p.i, p.j);
+	}
+	shared.store(result.maxkey());
+}
+
+struct ANNchunk_pair {					// a pair of chunks
+	ANNdist				dist;			// distance between their boxes
+	int					a, b;			// the chunks
+
+	bool operator<(const ANNchunk_pair &p) const	// order by distance
+		{ return dist < p.dist; }
+};
+
+class ANNclose_pairs_body : public ANNrange_body {
+	ANNclose_pairs		&cp;			// the traversal
+	const std::vector<ANNchunk_pair> &tasks;	// the pairs of chunks
+public:
+	ANNclose_pairs_body(ANNclose_pairs &c, const std::vector<ANNchunk_pair> &t)
+		: cp(c), tasks(t) {}
+
+	void run(int lo, int hi)			// traverse pairs [lo, hi)
+		{
+			for (int i = lo; i < hi; i++) {
+				const ANNchunk_pair &t = tasks[i];
+				if (t.dist * cp.max_err >= cp.shared.load()) continue;
+				ANNpair_set ps(cp.result.k);
+				cp.join(t.a, t.b, ps);
+				cp.merge(ps);
+			}
+		}
+};
+
+//----------------------------------------------------------------------
+//	The entry point
+//----------------------------------------------------------------------
+
+void annkClosestPairs(
+	ANNkd_tree			&tree,			// the tree of the points
+	int					k,				// number of pairs
+	ANNidxArray			idx1,			// k first points (returned)
+	ANNidxArray			idx2,			// k second points (returned)
+	ANNdistArray		dd,				// k squared distances (returned)
+	double				eps,			// error bound
+	int					threads)		// number of threads (0 = all)
+{
+	double n = tree.nPoints();
+	if (k <= 0) return;
+	if (k > n * (n - 1) / 2) {			// too many pairs?
+		annError("Requesting more pairs than there are", ANNabort);
+	}
+
+	ANNjoin_tree jt(tree, ANNfalse, ANN_CLOSE_PAIRS_LEAF);
+	ANNclose_pairs cp(jt, k, eps);
+	ANNthread_pool *pool = (threads == 1 ? NULL : annThreadPool(threads));
+	int n_thr = (pool == NULL ? 1 : pool->nThreads());
+
+	std::vector<int> sub;				// cut the tree into chunks
+	int max_n = jt.n_pts / (ANN_CLOSE_PAIRS_TASKS * n_thr);
+	if (n_thr == 1 || max_n < jt.max_leaf) max_n = jt.n_pts;
+	jt.subtrees(jt.root, max_n, sub);
+
+	std::vector<ANNchunk_pair> tasks;	// all pairs of chunks
+	for (size_t a = 0; a < sub.size(); a++) {
+		for (size_t b = a; b < sub.size(); b++) {
+			ANNchunk_pair t;
+			t.a = sub[a];
+			t.b = sub[b];
+			t.dist = (a == b ? 0 : cp.box_dist(t.a, t.b));
+			tasks.push_back(t);
+		}
+	}
+	std::stable_sort(tasks.begin(), tasks.end());
+
+	ANNclose_pairs_body body(cp, tasks);
+	if (n_thr == 1) {
+		body.run(0, (int) tasks.size());
+	}
+	else {
+		annParallelFor(pool, 0, (int) tasks.size(), 1, body);
+	}
+
+	std::sort_heap(cp.result.heap.begin(), cp.result.heap.end());
+	for (int i = 0; i < k; i++) {
+		idx1[i] = cp.result.heap[i].i;
+		idx2[i] = cp.result.heap[i].j;
+		dd[i] = cp.result.heap[i].dist;
+	}
+}
+
+ANN_END_NAMESPACE
@@ -23,6 +23,10 @@
 //	Revision 1.0  04/01/05
 //		Moved dump out of kd_tree.cc into this file.
 //		Added kd-tree load constructor.
+//	Revision 1.2
+//		Load constructors build leaf coordinate blocks if requested.
+//		Load constructors build quantized leaf codes if requested.
+//		Load constructors set the subtree counts (fill_counts()).
 //----------------------------------------------------------------------
 // This file contains routines for dumping kd-trees and bd-trees and
 // reloading them. (It is an abuse of policy to include both kd- and
@@ -36,6 +40,8 @@
 
 using namespace std;					// make std:: available
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //		Constants
 //----------------------------------------------------------------------
@@ -210,6 +216,13 @@ ANNkd_tree::ANNkd_tree(					// build from dump file
 	bnd_box_hi = the_bnd_box_hi;
 
 	root = the_root;							// set the root
+	if (root != NULL)							// count points of subtrees
+		root->fill_counts();
+
+	if (ANNuseLeafCodes != ANN_CODES_NONE)		// quantize points to the leaves
+		MakeLeafCodes();
+	else if (ANNuseLeafCoords)					// copy points to the leaves
+		MakeLeafCoords();
 }
 
 ANNbd_tree::ANNbd_tree(					// build bd-tree from dump file
@@ -238,6 +251,13 @@ ANNbd_tree::ANNbd_tree(					// build bd-tree from dump file
 	bnd_box_hi = the_bnd_box_hi;
 
 	root = the_root;							// set the root
+	if (root != NULL)							// count points of subtrees
+		root->fill_counts();
+
+	if (ANNuseLeafCodes != ANN_CODES_NONE)		// quantize points to the leaves
+		MakeLeafCodes();
+	else if (ANNuseLeafCoords)					// copy points to the leaves
+		MakeLeafCoords();
 }
 
 //----------------------------------------------------------------------
@@ -442,3 +462,5 @@ static ANNkd_ptr annReadTree(
 		exit(0);								// to keep the compiler happy
 	}
 }
+
+ANN_END_NAMESPACE
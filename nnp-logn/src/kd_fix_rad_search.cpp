@@ -20,10 +20,17 @@
 // History:
 //	Revision 1.1  05/03/05
 //		Initial release
+//	Revision 1.2
+//		Search state passed in an ANNkd_search_ctx instead of globals
+//		Leaves with coordinate blocks are scanned by annScanLeafCoords
+//		Leaves with code blocks are scanned by annScanLeafCodes
+//		Queues are borrowed from the thread's search workspace
 //----------------------------------------------------------------------
 
 #include "kd_fix_rad_search.h"			// kd fixed-radius search decls
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Approximate fixed-radius k nearest neighbor search
 //		The squared radius is provided, and this procedure finds the
@@ -37,20 +44,11 @@
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
-//		To keep argument lists short, a number of global variables
-//		are maintained which are common to all the recursive calls.
-//		These are given below.
+//		The state which is common to all the recursive calls is kept
+//		in a search context (ANNkd_search_ctx), which is set up by
+//		annkFRSearch() and passed by reference to every call.
 //----------------------------------------------------------------------
 
-int				ANNkdFRDim;				// dimension of space
-ANNpoint		ANNkdFRQ;				// query point
-ANNdist			ANNkdFRSqRad;			// squared radius search bound
-double			ANNkdFRMaxErr;			// max tolerable squared error
-ANNpointArray	ANNkdFRPts;				// the points
-ANNmink*		ANNkdFRPointMK;			// set of k closest points
-int				ANNkdFRPtsVisited;		// total points visited
-int				ANNkdFRPtsInRange;		// number of points in the range
-
 //----------------------------------------------------------------------
 //	annkFRSearch - fixed radius search for k nearest neighbors
 //----------------------------------------------------------------------
@@ -63,29 +61,27 @@ int ANNkd_tree::annkFRSearch(
 	ANNdistArray		dd,				// the approximate nearest neighbor
 	double				eps)			// the error bound
 {
-	ANNkdFRDim = dim;					// copy arguments to static equivs
-	ANNkdFRQ = q;
-	ANNkdFRSqRad = sqRad;
-	ANNkdFRPts = pts;
-	ANNkdFRPtsVisited = 0;				// initialize count of points visited
-	ANNkdFRPtsInRange = 0;				// ...and points in the range
-
-	ANNkdFRMaxErr = ANN_POW(1.0 + eps);
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
+	ctx.sq_rad = sqRad;
 	ANN_FLOP(2)							// increment floating op count
 
-	ANNkdFRPointMK = new ANNmink(k);	// create set for closest k points
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	if (leaf_quant != NULL)				// quantize the query point
+		ctx.set_quant(leaf_quant, ws->query_codes(dim));
+	ctx.point_mk = &point_mk;
 										// search starting at the root
-	root->ann_FR_search(annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim));
+	root->ann_FR_search(annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim), ctx);
 
 	for (int i = 0; i < k; i++) {		// extract the k-th closest points
 		if (dd != NULL)
-			dd[i] = ANNkdFRPointMK->ith_smallestkey(i);
+			dd[i] = point_mk.ith_smallestkey(i);
 		if (nn_idx != NULL)
-			nn_idx[i] = ANNkdFRPointMK->ith_smallest_info(i);
+			nn_idx[i] = point_mk.ith_smallest_info(i);
 	}
 
-	delete ANNkdFRPointMK;				// deallocate closest point set
-	return ANNkdFRPtsInRange;			// return final point count
+	return ctx.pts_in_range;			// return final point count
 }
 
 //----------------------------------------------------------------------
@@ -97,18 +93,18 @@ int ANNkd_tree::annkFRSearch(
 //		code structure for the sake of uniformity.
 //----------------------------------------------------------------------
 
-void ANNkd_split::ann_FR_search(ANNdist box_dist)
+void ANNkd_split::ann_FR_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 										// check dist calc term condition
-	if (ANNmaxPtsVisited != 0 && ANNkdFRPtsVisited > ANNmaxPtsVisited) return;
+	if (ctx.visit_limit()) return;
 
 										// distance to cutting plane
-	ANNcoord cut_diff = ANNkdFRQ[cut_dim] - cut_val;
+	ANNcoord cut_diff = ctx.q[cut_dim] - cut_val;
 
 	if (cut_diff < 0) {					// left of cutting plane
-		child[ANN_LO]->ann_FR_search(box_dist);// visit closer child first
+		child[ANN_LO]->ann_FR_search(box_dist, ctx);// visit closer child first
 
-		ANNcoord box_diff = cd_bnds[ANN_LO] - ANNkdFRQ[cut_dim];
+		ANNcoord box_diff = cd_bnds[ANN_LO] - ctx.q[cut_dim];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -116,14 +112,14 @@ void ANNkd_split::ann_FR_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 										// visit further child if in range
-		if (box_dist * ANNkdFRMaxErr <= ANNkdFRSqRad)
-			child[ANN_HI]->ann_FR_search(box_dist);
+		if (box_dist * ctx.max_err <= ctx.sq_rad)
+			child[ANN_HI]->ann_FR_search(box_dist, ctx);
 
 	}
 	else {								// right of cutting plane
-		child[ANN_HI]->ann_FR_search(box_dist);// visit closer child first
+		child[ANN_HI]->ann_FR_search(box_dist, ctx);// visit closer child first
 
-		ANNcoord box_diff = ANNkdFRQ[cut_dim] - cd_bnds[ANN_HI];
+		ANNcoord box_diff = ctx.q[cut_dim] - cd_bnds[ANN_HI];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -131,8 +127,8 @@ void ANNkd_split::ann_FR_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 										// visit further child if close enough
-		if (box_dist * ANNkdFRMaxErr <= ANNkdFRSqRad)
-			child[ANN_LO]->ann_FR_search(box_dist);
+		if (box_dist * ctx.max_err <= ctx.sq_rad)
+			child[ANN_LO]->ann_FR_search(box_dist, ctx);
 
 	}
 	ANN_FLOP(13)						// increment floating ops
@@ -145,7 +141,7 @@ void ANNkd_split::ann_FR_search(ANNdist box_dist)
 //		some fine tuning to replace indexing by pointer operations.
 //----------------------------------------------------------------------
 
-void ANNkd_leaf::ann_FR_search(ANNdist box_dist)
+void ANNkd_leaf::ann_FR_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 	register ANNdist dist;				// distance to data point
 	register ANNcoord* pp;				// data coordinate pointer
@@ -153,31 +149,57 @@ void ANNkd_leaf::ann_FR_search(ANNdist box_dist)
 	register ANNcoord t;
 	register int d;
 
+	if (codes != NULL) {				// scan the code block
+		ctx.pts_in_range += annScanLeafCodesFR(*ctx.quant, codes, bkt,
+				n_pts, ctx.pts, ctx.q, ctx.q_code, ctx.sq_rad, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+
+	if (coords != NULL) {				// scan the coordinate block
+		ctx.pts_in_range += annScanLeafCoordsFR(coords, bkt, n_pts,
+				ctx.dim, ctx.q, ctx.sq_rad, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+
+	ANNpointArray	pts = ctx.pts;		// the points
+	ANNpoint		q   = ctx.q;		// the query point
+	int				dim = ctx.dim;		// dimension of space
+	ANNdist			sq_rad = ctx.sq_rad;// squared radius search bound
+	ANNmink			*point_mk = ctx.point_mk;// set of k closest points
+
 	for (int i = 0; i < n_pts; i++) {	// check points in bucket
 
-		pp = ANNkdFRPts[bkt[i]];		// first coord of next data point
-		qq = ANNkdFRQ;					// first coord of query point
+		pp = pts[bkt[i]];				// first coord of next data point
+		qq = q;							// first coord of query point
 		dist = 0;
 
-		for(d = 0; d < ANNkdFRDim; d++) {
+		for(d = 0; d < dim; d++) {
 			ANN_COORD(1)				// one more coordinate hit
 			ANN_FLOP(5)					// increment floating ops
 
 			t = *(qq++) - *(pp++);		// compute length and adv coordinate
 										// exceeds dist to k-th smallest?
-			if( (dist = ANN_SUM(dist, ANN_POW(t))) > ANNkdFRSqRad) {
+			if( (dist = ANN_SUM(dist, ANN_POW(t))) > sq_rad) {
 				break;
 			}
 		}
 
-		if (d >= ANNkdFRDim &&					// among the k best?
+		if (d >= dim &&							// among the k best?
 		   (ANN_ALLOW_SELF_MATCH || dist!=0)) { // and no self-match problem
 												// add it to the list
-			ANNkdFRPointMK->insert(dist, bkt[i]);
-			ANNkdFRPtsInRange++;				// increment point count
+			point_mk->insert(dist, bkt[i]);
+			ctx.pts_in_range++;					// increment point count
 		}
 	}
 	ANN_LEAF(1)							// one more leaf node visited
 	ANN_PTS(n_pts)						// increment points visited
-	ANNkdFRPtsVisited += n_pts;			// increment number of points visited
+	ctx.pts_visited += n_pts;			// increment number of points visited
 }
+
+ANN_END_NAMESPACE
@@ -20,6 +20,8 @@
 // History:
 //	Revision 1.1  05/03/05
 //		Initial release
+//	Revision 1.2
+//		Removed search globals (see ANNkd_search_ctx in kd_tree.h)
 //----------------------------------------------------------------------
 
 #ifndef ANNkd_fix_rad_search_H
@@ -27,18 +29,11 @@
 
 #include "kd_tree.h"					// kd-tree declarations
 #include "kd_util.h"					// kd-tree utilities
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "kd_leaf_quant.h"				// quantized leaf codes
+#include "search_space.h"				// search workspaces
 #include "pr_queue_k.h"					// k-element priority queue
 
 #include <ANN/ANNperf.h>				// performance evaluation
 
-//----------------------------------------------------------------------
-//	Global variables
-//		These are active for the life of each call to
-//		annRangeSearch().  They are set to save the number of
-//		variables that need to be passed among the various search
-//		procedures.
-//----------------------------------------------------------------------
-
-extern ANNpoint			ANNkdFRQ;			// query point (static copy)
-
 #endif
@@ -0,0 +1,178 @@
+//----------------------------------------------------------------------
+// File:			kd_flat.cpp
+// Programmer:		NNP contributors
+// Description:		Construction of flattened kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "kd_flat.h"					// flattened tree declarations
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "bd_tree.h"					// bd-tree declarations
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	flatten - append a node and its subtree to a flat tree
+//		Each node adds itself before its children (preorder).  A node
+//		with two children adds its first child, then records the index
+//		at which its second child will be added, and then adds it.
+//----------------------------------------------------------------------
+
+void ANNkd_split::flatten(				// flatten a splitting node
+		ANNflat_build	&fb)			// the flat tree
+{
+	ANNflat_node nd;
+	nd.cut_dim			= cut_dim;
+	nd.n				= 0;
+	nd.far				= 0;			// filled in below
+	nd.off				= 0;
+	nd.cut_val			= cut_val;
+	nd.cd_bnds[ANN_LO]	= cd_bnds[ANN_LO];
+	nd.cd_bnds[ANN_HI]	= cd_bnds[ANN_HI];
+
+	int i = fb.add(nd);
+	fb.depth++;
+	child[ANN_LO]->flatten(fb);			// low child follows directly
+	fb.nodes[i].far = (int) fb.nodes.size();
+	child[ANN_HI]->flatten(fb);
+	fb.depth--;
+}
+
+void ANNkd_leaf::flatten(				// flatten a leaf node
+		ANNflat_build	&fb)			// the flat tree
+{
+	ANNflat_node nd;
+	nd.cut_dim			= ANN_FLAT_LEAF;
+	nd.n				= n_pts;
+	nd.far				= 0;
+	nd.off				= (int) fb.pidx.size();
+	nd.cut_val			= 0;
+	nd.cd_bnds[ANN_LO]	= 0;
+	nd.cd_bnds[ANN_HI]	= 0;
+
+	fb.add(nd);
+	for (int j = 0; j < n_pts; j++) {	// copy the bucket
+		fb.pidx.push_back(bkt[j]);
+	}
+}
+
+void ANNbd_shrink::flatten(				// flatten a shrinking node
+		ANNflat_build	&fb)			// the flat tree
+{
+	ANNflat_node nd;
+	nd.cut_dim			= ANN_FLAT_SHRINK;
+	nd.n				= n_bnds;
+	nd.far				= 0;			// filled in below
+	nd.off				= (int) fb.bnds.size();
+	nd.cut_val			= 0;
+	nd.cd_bnds[ANN_LO]	= 0;
+	nd.cd_bnds[ANN_HI]	= 0;
+
+	int i = fb.add(nd);
+	for (int j = 0; j < n_bnds; j++) {	// copy the bounds
+		fb.bnds.push_back(bnds[j]);
+	}
+	fb.depth++;
+	child[ANN_IN]->flatten(fb);			// inner child follows directly
+	fb.nodes[i].far = (int) fb.nodes.size();
+	child[ANN_OUT]->flatten(fb);
+	fb.depth--;
+}
+
+//----------------------------------------------------------------------
+//	Flattened tree constructor
+//		The tree is flattened into growable arrays, which are then
+//		copied into arrays of exactly the right size.  A skeleton
+//		tree (which has no nodes) becomes a single empty leaf.
+//
+//		If the tree has leaf coordinate blocks, so does the flattened
+//		tree.  The block of a leaf starts at position off*dim of its
+//		coordinate array, where off is the position of the leaf's
+//		first point in pidx.
+//----------------------------------------------------------------------
+
+ANNkd_flat_tree::ANNkd_flat_tree(		// build from kd- or bd-tree
+	ANNkd_tree			&tree)			// the tree to flatten
+{
+	dim = tree.dim;
+	n_pts = tree.n_pts;
+	pts = tree.pts;
+	if (tree.bnd_box_lo != NULL) {		// copy the bounding box
+		bnd_box_lo = annCopyPt(dim, tree.bnd_box_lo);
+		bnd_box_hi = annCopyPt(dim, tree.bnd_box_hi);
+	}
+	else {								// skeleton tree has none
+		bnd_box_lo = annAllocPt(dim);
+		bnd_box_hi = annAllocPt(dim);
+	}
+
+	ANNflat_build fb;
+	fb.nodes.reserve(2*(n_pts/(tree.bkt_size > 0 ? tree.bkt_size : 1)) + 1);
+	fb.pidx.reserve(n_pts);
+	if (tree.root != NULL) {			// flatten the tree
+		tree.root->flatten(fb);
+	}
+	else {								// skeleton tree: one empty leaf
+		KD_TRIVIAL->flatten(fb);
+	}
+
+	n_nodes = (int) fb.nodes.size();
+	n_bnds = (int) fb.bnds.size();
+	max_depth = fb.max_depth;
+
+	nodes = new ANNflat_node[n_nodes];
+	for (int i = 0; i < n_nodes; i++) nodes[i] = fb.nodes[i];
+
+	bnds = NULL;
+	if (n_bnds > 0) {
+		bnds = new ANNorthHalfSpace[n_bnds];
+		for (int i = 0; i < n_bnds; i++) bnds[i] = fb.bnds[i];
+	}
+
+	mapping = NULL;						// (not a snapshot)
+	pidx = new ANNidx[fb.pidx.size() > 0 ? fb.pidx.size() : 1];
+	for (size_t i = 0; i < fb.pidx.size(); i++) pidx[i] = fb.pidx[i];
+
+	leaf_coords = NULL;
+	if (tree.leaf_coords != NULL) {		// copy points to the leaves
+		leaf_coords = new ANNcoord[(size_t) n_pts * dim];
+		for (int i = 0; i < n_nodes; i++) {
+			ANNflat_node &nd = nodes[i];
+			if (nd.cut_dim == ANN_FLAT_LEAF && nd.n > 0) {
+				annFillLeafCoords(leaf_coords + (size_t) nd.off*dim,
+						pts, pidx + nd.off, nd.n, dim);
+			}
+		}
+	}
+}
+
+ANNkd_flat_tree::~ANNkd_flat_tree()		// tree destructor
+{
+	if (mapping != NULL) {				// loaded from a snapshot
+		delete [] pts;					// only pts was allocated
+		annUnmapFlat(mapping);
+		return;
+	}
+	if (nodes != NULL) delete [] nodes;
+	if (bnds != NULL) delete [] bnds;
+	if (pidx != NULL) delete [] pidx;
+	if (bnd_box_lo != NULL) annDeallocPt(bnd_box_lo);
+	if (bnd_box_hi != NULL) annDeallocPt(bnd_box_hi);
+	if (leaf_coords != NULL) delete [] leaf_coords;
+}
+
+ANN_END_NAMESPACE
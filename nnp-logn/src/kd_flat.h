@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------
+// File:			kd_flat.h
+// Programmer:		NNP contributors
+// Description:		Declarations for flattened kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_kd_flat_H
+#define ANN_kd_flat_H
+
+#include <vector>						// arrays used while flattening
+
+#include "kd_tree.h"					// kd-tree declarations
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Flattened node
+//		The nodes of a flattened tree are stored in one array in
+//		depth-first (preorder) order.  Since the first child of a node
+//		always follows it directly, only the index of the second child
+//		is stored.  The fields are used as follows:
+//
+//		Node type		cut_dim				n		far			off
+//		splitting		cutting dim (>= 0)	-		hi child	-
+//		leaf			ANN_FLAT_LEAF		n_pts	-			first point
+//		shrinking		ANN_FLAT_SHRINK		n_bnds	out child	first bound
+//
+//		The points of a leaf are pidx[off..off+n-1], where pidx is the
+//		point index array of the flattened tree, and the bounding
+//		halfspaces of a shrinking node are bnds[off..off+n-1].  The
+//		low child of a splitting node and the inner child of a
+//		shrinking node are the next node in the array.  The cut_val
+//		and cd_bnds fields are only used by splitting nodes.
+//----------------------------------------------------------------------
+
+enum {ANN_FLAT_LEAF = -1, ANN_FLAT_SHRINK = -2};	// node types
+
+struct ANNflat_node {					// node of a flattened tree
+	int					cut_dim;		// cutting dim or node type
+	int					n;				// no. of points or bounds
+	int					far;			// index of second child
+	int					off;			// offset of points or bounds
+	ANNcoord			cut_val;		// location of cutting plane
+	ANNcoord			cd_bnds[2];		// lower and upper bounds of
+										// rectangle along cut_dim
+};
+
+//----------------------------------------------------------------------
+//	Flattening
+//		A pointer-based tree is flattened by a preorder traversal, in
+//		which each node appends itself to the arrays of an
+//		ANNflat_build (see the flatten() members of the node classes).
+//----------------------------------------------------------------------
+
+class ANNflat_build {					// arrays of a tree being flattened
+public:
+	std::vector<ANNflat_node>		nodes;	// the nodes
+	std::vector<ANNorthHalfSpace>	bnds;	// bounding halfspaces
+	std::vector<ANNidx>				pidx;	// point indices
+	int								depth;	// depth of current node
+	int								max_depth;	// maximum depth seen
+
+	ANNflat_build() { depth = 0; max_depth = 0; }
+
+	int add(const ANNflat_node &nd)		// add a node, return its index
+		{
+			if (depth > max_depth) max_depth = depth;
+			nodes.push_back(nd);
+			return (int) nodes.size() - 1;
+		}
+};
+
+//----------------------------------------------------------------------
+//	Search stack
+//		The flattened searches are iterative.  When the search moves
+//		to the closer child of a node, the other child is pushed on a
+//		stack together with the distance to its cell, and it is
+//		visited (or discarded) when it is popped.  Since there is at
+//		most one entry for each ancestor of the current node, a stack
+//		of max_depth+1 entries is always enough.
+//
+//		Children of shrinking nodes are visited regardless of their
+//		distance, as in the recursive search, and are so marked.
+//----------------------------------------------------------------------
+
+struct ANNflat_frame {					// pending subtree
+	int					node;			// its root
+	ANNbool				always;			// visit regardless of distance?
+	ANNdist				box_dist;		// distance to its cell
+};
+
+const int ANN_FLAT_STACK = 64;			// stack size kept on the stack
+
+//----------------------------------------------------------------------
+//	Snapshots
+//		A tree loaded from a snapshot (see kd_flat_snap.cpp) points
+//		into the mapped file.  Its destructor releases the mapping
+//		through annUnmapFlat().
+//----------------------------------------------------------------------
+
+void annUnmapFlat(						// release a mapped tree
+	ANNflat_map			*mapping);		// its mapping
+
+ANN_END_NAMESPACE
+
+#endif
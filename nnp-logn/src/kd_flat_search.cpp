@@ -0,0 +1,521 @@
+//----------------------------------------------------------------------
+// File:			kd_flat_search.cpp
+// Programmer:		NNP contributors
+// Description:		Searching flattened kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//		Queues are borrowed from the thread's search workspace
+//----------------------------------------------------------------------
+
+#include "kd_flat.h"					// flattened tree declarations
+#include "kd_util.h"					// kd-tree utilities
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "pr_queue.h"					// priority queue declarations
+#include "pr_queue_k.h"					// k-element priority queue
+#include "search_space.h"				// search workspaces
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Searching flattened trees
+//		These are the searches of kd_search.cpp, kd_pr_search.cpp and
+//		kd_fix_rad_search.cpp (and their bd-tree extensions), rewritten
+//		as loops over the node array.  See those files for a
+//		description of the algorithms.
+//
+//		In the recursive standard search, after the closer child of a
+//		splitting node has been searched, the farther child is visited
+//		if its cell is still close enough.  Here the farther child is
+//		pushed on a stack (see kd_flat.h) along with the distance to
+//		its cell, and the test is made when it is popped, which is
+//		exactly when the recursive search would have made it.  Thus
+//		both searches visit the same leaves in the same order, and
+//		produce the same results.  Shrinking nodes visit both children
+//		unconditionally, and their children are pushed with the
+//		"always" flag set.
+//----------------------------------------------------------------------
+
+//----------------------------------------------------------------------
+//	annFlatLeafSearch - search the points of a leaf for k-NN
+//		This is the same as ANNkd_leaf::ann_search().  The leaf
+//		coordinate array is NULL if the tree has none.
+//----------------------------------------------------------------------
+
+static void annFlatLeafSearch(
+	const ANNflat_node	&nd,			// the leaf
+	ANNidxArray			pidx,			// point indices
+	ANNcoord			*leaf_coords,	// leaf coordinate array
+	ANNkd_search_ctx	&ctx)			// search context
+{
+	register ANNdist dist;				// distance to data point
+	register ANNcoord* pp;				// data coordinate pointer
+	register ANNcoord* qq;				// query coordinate pointer
+	register ANNdist min_dist;			// distance to k-th closest point
+	register ANNcoord t;
+	register int d;
+
+	if (leaf_coords != NULL) {			// scan the coordinate block
+		annScanLeafCoords(leaf_coords + (size_t) nd.off*ctx.dim,
+				pidx + nd.off, nd.n, ctx.dim, ctx.q, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(nd.n)					// increment points visited
+		ctx.pts_visited += nd.n;		// increment number of points visited
+		return;
+	}
+
+	ANNpointArray	pts = ctx.pts;		// the points
+	ANNpoint		q   = ctx.q;		// the query point
+	int				dim = ctx.dim;		// dimension of space
+	ANNmink			*point_mk = ctx.point_mk;// set of k closest points
+	ANNidxArray		bkt = pidx + nd.off;// the bucket
+
+	min_dist = point_mk->maxkey();		// k-th smallest distance so far
+
+	for (int i = 0; i < nd.n; i++) {	// check points in bucket
+
+		pp = pts[bkt[i]];				// first coord of next data point
+		qq = q;							// first coord of query point
+		dist = 0;
+
+		for(d = 0; d < dim; d++) {
+			ANN_COORD(1)				// one more coordinate hit
+			ANN_FLOP(4)					// increment floating ops
+
+			t = *(qq++) - *(pp++);		// compute length and adv coordinate
+										// exceeds dist to k-th smallest?
+			if( (dist = ANN_SUM(dist, ANN_POW(t))) > min_dist) {
+				break;
+			}
+		}
+
+		if (d >= dim &&							// among the k best?
+		   (ANN_ALLOW_SELF_MATCH || dist!=0)) { // and no self-match problem
+												// add it to the list
+			point_mk->insert(dist, bkt[i]);
+			min_dist = point_mk->maxkey();
+		}
+	}
+	ANN_LEAF(1)							// one more leaf node visited
+	ANN_PTS(nd.n)						// increment points visited
+	ctx.pts_visited += nd.n;			// increment number of points visited
+}
+
+//----------------------------------------------------------------------
+//	annFlatLeafFRSearch - search the points of a leaf within a radius
+//		This is the same as ANNkd_leaf::ann_FR_search().
+//----------------------------------------------------------------------
+
+static void annFlatLeafFRSearch(
+	const ANNflat_node	&nd,			// the leaf
+	ANNidxArray			pidx,			// point indices
+	ANNcoord			*leaf_coords,	// leaf coordinate array
+	ANNkd_search_ctx	&ctx)			// search context
+{
+	register ANNdist dist;				// distance to data point
+	register ANNcoord* pp;				// data coordinate pointer
+	register ANNcoord* qq;				// query coordinate pointer
+	register ANNcoord t;
+	register int d;
+
+	if (leaf_coords != NULL) {			// scan the coordinate block
+		ctx.pts_in_range += annScanLeafCoordsFR(
+				leaf_coords + (size_t) nd.off*ctx.dim, pidx + nd.off,
+				nd.n, ctx.dim, ctx.q, ctx.sq_rad, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(nd.n)					// increment points visited
+		ctx.pts_visited += nd.n;		// increment number of points visited
+		return;
+	}
+
+	ANNpointArray	pts = ctx.pts;		// the points
+	ANNpoint		q   = ctx.q;		// the query point
+	int				dim = ctx.dim;		// dimension of space
+	ANNdist			sq_rad = ctx.sq_rad;// squared radius search bound
+	ANNmink			*point_mk = ctx.point_mk;// set of k closest points
+	ANNidxArray		bkt = pidx + nd.off;// the bucket
+
+	for (int i = 0; i < nd.n; i++) {	// check points in bucket
+
+		pp = pts[bkt[i]];				// first coord of next data point
+		qq = q;							// first coord of query point
+		dist = 0;
+
+		for(d = 0; d < dim; d++) {
+			ANN_COORD(1)				// one more coordinate hit
+			ANN_FLOP(5)					// increment floating ops
+
+			t = *(qq++) - *(pp++);		// compute length and adv coordinate
+										// exceeds dist to k-th smallest?
+			if( (dist = ANN_SUM(dist, ANN_POW(t))) > sq_rad) {
+				break;
+			}
+		}
+
+		if (d >= dim &&							// among the k best?
+		   (ANN_ALLOW_SELF_MATCH || dist!=0)) { // and no self-match problem
+												// add it to the list
+			point_mk->insert(dist, bkt[i]);
+			ctx.pts_in_range++;					// increment point count
+		}
+	}
+	ANN_LEAF(1)							// one more leaf node visited
+	ANN_PTS(nd.n)						// increment points visited
+	ctx.pts_visited += nd.n;			// increment number of points visited
+}
+
+//----------------------------------------------------------------------
+//	annFlatInnerDist - distance from the query to the inner box of
+//		a shrinking node, given the distance to the outer box
+//----------------------------------------------------------------------
+
+static ANNdist annFlatInnerDist(
+	const ANNflat_node	&nd,			// the shrinking node
+	ANNorthHalfSpace	*bnds,			// bounding halfspaces
+	ANNpoint			q)				// query point
+{
+	ANNdist inner_dist = 0;						// distance to inner box
+	ANNorthHalfSpace *hs = bnds + nd.off;		// the node's halfspaces
+	for (int i = 0; i < nd.n; i++) {			// is query point in the box?
+		if (hs[i].out(q)) {						// outside this bounding side?
+												// add to inner distance
+			inner_dist = (ANNdist) ANN_SUM(inner_dist, hs[i].dist(q));
+		}
+	}
+	ANN_FLOP(3*nd.n)							// increment floating ops
+	ANN_SHR(1)									// one more shrinking node
+	return inner_dist;
+}
+
+//----------------------------------------------------------------------
+//	Search stack
+//		The stack is kept on the program stack unless the tree is
+//		unusually deep.
+//----------------------------------------------------------------------
+
+class ANNflat_stack {
+	ANNflat_frame	local[ANN_FLAT_STACK];	// small stacks live here
+	ANNflat_frame	*stk;				// the stack
+	int				top;				// number of entries
+public:
+	ANNflat_stack(int max_depth)		// constructor
+		{
+			stk = (max_depth < ANN_FLAT_STACK ? local
+						: new ANNflat_frame[max_depth+1]);
+			top = 0;
+		}
+	~ANNflat_stack()					// destructor
+		{ if (stk != local) delete [] stk; }
+
+	ANNbool empty()						// is stack empty?
+		{ return (ANNbool) (top == 0); }
+
+	void push(int node, ANNdist box_dist, ANNbool always)
+		{
+			stk[top].node = node;
+			stk[top].box_dist = box_dist;
+			stk[top].always = always;
+			top++;
+		}
+
+	ANNflat_frame pop()					// pop top entry
+		{ return stk[--top]; }
+};
+
+//----------------------------------------------------------------------
+//	annkSearch - search for the k nearest neighbors
+//----------------------------------------------------------------------
+
+void ANNkd_flat_tree::annkSearch(
+	ANNpoint			q,				// the query point
+	int					k,				// number of near neighbors to return
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// the approximate nearest neighbor
+	double				eps)			// the error bound
+{
+	if (k > n_pts) {					// too many near neighbors?
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
+	ANN_FLOP(2)							// increment floating op count
+
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	ctx.point_mk = &point_mk;
+
+	ANNflat_stack stk(max_depth);		// start at the root
+	stk.push(0, annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim), ANNtrue);
+
+	while (!stk.empty()) {
+		ANNflat_frame fr = stk.pop();
+		int i = fr.node;
+		ANNdist box_dist = fr.box_dist;
+										// skip if no longer close enough
+		if (!fr.always && !(box_dist * ctx.max_err < point_mk.maxkey()))
+			continue;
+
+		for (;;) {						// descend to a leaf
+			const ANNflat_node &nd = nodes[i];
+
+			if (nd.cut_dim >= 0) {		// splitting node
+										// check dist calc term condition
+				if (ctx.visit_limit()) break;
+										// distance to cutting plane
+				ANNcoord cut_diff = q[nd.cut_dim] - nd.cut_val;
+				ANNcoord box_diff;
+				int near, far;
+
+				if (cut_diff < 0) {		// left of cutting plane
+					box_diff = nd.cd_bnds[ANN_LO] - q[nd.cut_dim];
+					near = i+1;  far = nd.far;
+				}
+				else {					// right of cutting plane
+					box_diff = q[nd.cut_dim] - nd.cd_bnds[ANN_HI];
+					near = nd.far;  far = i+1;
+				}
+				if (box_diff < 0)		// within bounds - ignore
+					box_diff = 0;
+										// save further child for later
+				stk.push(far, (ANNdist) ANN_SUM(box_dist,
+						ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff))), ANNfalse);
+				ANN_FLOP(10)			// increment floating ops
+				ANN_SPL(1)				// one more splitting node visited
+				i = near;				// continue with closer child
+			}
+			else if (nd.cut_dim == ANN_FLAT_LEAF) {
+				annFlatLeafSearch(nd, pidx, leaf_coords, ctx);
+				break;
+			}
+			else {						// shrinking node
+										// check dist calc term condition
+				if (ctx.visit_limit()) break;
+
+				ANNdist inner_dist = annFlatInnerDist(nd, bnds, q);
+				if (inner_dist <= box_dist) {	// inner box is closer
+					stk.push(nd.far, box_dist, ANNtrue);
+					i = i+1;
+					box_dist = inner_dist;
+				}
+				else {					// outer box is closer
+					stk.push(i+1, inner_dist, ANNtrue);
+					i = nd.far;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < k; i++) {		// extract the k-th closest points
+		dd[i] = point_mk.ith_smallestkey(i);
+		nn_idx[i] = point_mk.ith_smallest_info(i);
+	}
+}
+
+//----------------------------------------------------------------------
+//	annkPriSearch - priority search for k nearest neighbors
+//		The priority queue holds node indices.  The descent from
+//		a node to a leaf needs no stack, since the farther children
+//		are placed in the queue.
+//----------------------------------------------------------------------
+
+void ANNkd_flat_tree::annkPriSearch(
+	ANNpoint			q,				// query point
+	int					k,				// number of near neighbors to return
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// dist to near neighbors (returned)
+	double				eps)			// error bound (ignored)
+{
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
+	ANN_FLOP(2)							// increment floating ops
+
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	ctx.point_mk = &point_mk;
+
+										// distance to root box
+	ANNdist box_dist = annBoxDistance(q,
+				bnd_box_lo, bnd_box_hi, dim);
+
+	ANNpr_queue &box_pq = ws->box_queue();	// queue for boxes
+	box_pq.insert(box_dist, 0);			// insert root in priority queue
+
+	while (box_pq.non_empty() && !ctx.visit_limit()) {
+		int i;							// next box from prior queue
+
+										// extract closest box from queue
+		box_pq.extr_min(box_dist, i);
+
+		ANN_FLOP(2)						// increment floating ops
+		if (box_dist*ctx.max_err >= point_mk.maxkey())
+			break;
+
+		for (;;) {						// search this subtree
+			const ANNflat_node &nd = nodes[i];
+
+			if (nd.cut_dim >= 0) {		// splitting node
+										// distance to cutting plane
+				ANNcoord cut_diff = q[nd.cut_dim] - nd.cut_val;
+				ANNcoord box_diff;
+				int near, far;
+
+				if (cut_diff < 0) {		// left of cutting plane
+					box_diff = nd.cd_bnds[ANN_LO] - q[nd.cut_dim];
+					near = i+1;  far = nd.far;
+				}
+				else {					// right of cutting plane
+					box_diff = q[nd.cut_dim] - nd.cd_bnds[ANN_HI];
+					near = nd.far;  far = i+1;
+				}
+				if (box_diff < 0)		// within bounds - ignore
+					box_diff = 0;
+										// distance to further box
+				ANNdist new_dist = (ANNdist) ANN_SUM(box_dist,
+						ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
+
+										// enqueue if not trivial
+				if (nodes[far].cut_dim != ANN_FLAT_LEAF || nodes[far].n != 0)
+					box_pq.insert(new_dist, far);
+				ANN_SPL(1)				// one more splitting node visited
+				ANN_FLOP(8)				// increment floating ops
+				i = near;				// continue with closer child
+			}
+			else if (nd.cut_dim == ANN_FLAT_LEAF) {
+				annFlatLeafSearch(nd, pidx, leaf_coords, ctx);
+				break;
+			}
+			else {						// shrinking node
+				ANNdist inner_dist = annFlatInnerDist(nd, bnds, q);
+				int in = i+1, out = nd.far;
+				if (inner_dist <= box_dist) {	// inner box is closer
+					if (nodes[out].cut_dim != ANN_FLAT_LEAF || nodes[out].n != 0)
+						box_pq.insert(box_dist, out);
+					i = in;
+					box_dist = inner_dist;
+				}
+				else {					// outer box is closer
+					if (nodes[in].cut_dim != ANN_FLAT_LEAF || nodes[in].n != 0)
+						box_pq.insert(inner_dist, in);
+					i = out;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < k; i++) {		// extract the k-th closest points
+		dd[i] = point_mk.ith_smallestkey(i);
+		nn_idx[i] = point_mk.ith_smallest_info(i);
+	}
+}
+
+//----------------------------------------------------------------------
+//	annkFRSearch - fixed radius search for k nearest neighbors
+//		Whether the farther child of a splitting node is visited does
+//		not depend on the points found, so the test is made before it
+//		is pushed.
+//----------------------------------------------------------------------
+
+int ANNkd_flat_tree::annkFRSearch(
+	ANNpoint			q,				// the query point
+	ANNdist				sqRad,			// squared radius search bound
+	int					k,				// number of near neighbors to return
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// the approximate nearest neighbor
+	double				eps)			// the error bound
+{
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
+	ctx.sq_rad = sqRad;
+	ANN_FLOP(2)							// increment floating op count
+
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	ctx.point_mk = &point_mk;
+
+	ANNflat_stack stk(max_depth);		// start at the root
+	stk.push(0, annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim), ANNtrue);
+
+	while (!stk.empty()) {
+		ANNflat_frame fr = stk.pop();
+		int i = fr.node;
+		ANNdist box_dist = fr.box_dist;
+
+		for (;;) {						// descend to a leaf
+			const ANNflat_node &nd = nodes[i];
+
+			if (nd.cut_dim >= 0) {		// splitting node
+										// check dist calc term condition
+				if (ctx.visit_limit()) break;
+										// distance to cutting plane
+				ANNcoord cut_diff = q[nd.cut_dim] - nd.cut_val;
+				ANNcoord box_diff;
+				int near, far;
+
+				if (cut_diff < 0) {		// left of cutting plane
+					box_diff = nd.cd_bnds[ANN_LO] - q[nd.cut_dim];
+					near = i+1;  far = nd.far;
+				}
+				else {					// right of cutting plane
+					box_diff = q[nd.cut_dim] - nd.cd_bnds[ANN_HI];
+					near = nd.far;  far = i+1;
+				}
+				if (box_diff < 0)		// within bounds - ignore
+					box_diff = 0;
+										// distance to further box
+				ANNdist far_dist = (ANNdist) ANN_SUM(box_dist,
+						ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
+
+										// visit further child if in range
+				if (far_dist * ctx.max_err <= ctx.sq_rad)
+					stk.push(far, far_dist, ANNtrue);
+				ANN_FLOP(13)			// increment floating ops
+				ANN_SPL(1)				// one more splitting node visited
+				i = near;				// continue with closer child
+			}
+			else if (nd.cut_dim == ANN_FLAT_LEAF) {
+				annFlatLeafFRSearch(nd, pidx, leaf_coords, ctx);
+				break;
+			}
+			else {						// shrinking node
+										// check dist calc term condition
+				if (ctx.visit_limit()) break;
+
+				ANNdist inner_dist = annFlatInnerDist(nd, bnds, q);
+				if (inner_dist <= box_dist) {	// inner box is closer
+					stk.push(nd.far, box_dist, ANNtrue);
+					i = i+1;
+					box_dist = inner_dist;
+				}
+				else {					// outer box is closer
+					stk.push(i+1, inner_dist, ANNtrue);
+					i = nd.far;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < k; i++) {		// extract the k-th closest points
+		if (dd != NULL)
+			dd[i] = point_mk.ith_smallestkey(i);
+		if (nn_idx != NULL)
+			nn_idx[i] = point_mk.ith_smallest_info(i);
+	}
+
+	return ctx.pts_in_range;			// return final point count
+}
+
+ANN_END_NAMESPACE
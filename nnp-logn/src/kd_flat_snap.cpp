@@ -0,0 +1,336 @@
+//----------------------------------------------------------------------
+// File:			kd_flat_snap.cpp
+// Programmer:		NNP contributors
+// Description:		Binary snapshots of flattened trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "kd_flat.h"					// flattened tree declarations
+
+#include <cstring>						// memcmp, memcpy
+#include <fstream>						// file output
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>				// file mapping
+#else
+	#include <fcntl.h>					// open
+	#include <unistd.h>					// close
+	#include <sys/mman.h>				// mmap
+	#include <sys/stat.h>				// fstat
+#endif
+
+using namespace std;					// make std:: available
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Snapshot format
+//		A snapshot is a header followed by sections, each of which
+//		starts at a multiple of ANN_SNAP_ALIGN bytes from the start of
+//		the file (the gaps are zero).  All numbers are little-endian.
+//		The sections are:
+//
+//			box			bnd_box_lo and bnd_box_hi (2*dim coordinates)
+//			nodes		the nodes (n_nodes ANNflat_nodes)
+//			bnds		the bounding halfspaces (n_bnds, may be empty)
+//			pidx		the point indices, in leaf order (n_pidx)
+//			pts			the points, in order of index (n_pts*dim)
+//			leaf		the leaf coordinate blocks (n_pidx*dim, present
+//						only if has_leaf is nonzero)
+//
+//		The offsets of the sections are determined by the counts in
+//		the header (see annSnapLayout).  Nodes and halfspaces are
+//		stored as they are in memory, so the header records their
+//		sizes, and those of the coordinate and index types, and a
+//		snapshot is only loaded if they all agree.  The version number
+//		is increased whenever the format changes.
+//----------------------------------------------------------------------
+
+const char		ANN_SNAP_MAGIC[8]	= {'A','N','N','S','N','A','P','\0'};
+const unsigned	ANN_SNAP_VERSION	= 1;		// format version
+const unsigned	ANN_SNAP_ORDER		= 0x01020304;	// byte order mark
+const int		ANN_SNAP_ALIGN		= 64;		// section alignment
+
+struct ANNsnap_header {					// snapshot header
+	char				magic[8];		// ANN_SNAP_MAGIC
+	unsigned			version;		// ANN_SNAP_VERSION
+	unsigned			order;			// ANN_SNAP_ORDER
+	unsigned			coord_size;		// sizeof(ANNcoord)
+	unsigned			idx_size;		// sizeof(ANNidx)
+	unsigned			node_size;		// sizeof(ANNflat_node)
+	unsigned			bnd_size;		// sizeof(ANNorthHalfSpace)
+	int					dim;			// dimension of space
+	int					n_pts;			// number of points
+	int					n_pidx;			// number of point indices
+	int					n_nodes;		// number of nodes
+	int					n_bnds;			// number of bounding halfspaces
+	int					max_depth;		// depth of tree
+	int					has_leaf;		// leaf coordinate blocks?
+	int					reserved;		// (zero)
+	long long			off_box;		// offset of box section
+	long long			off_nodes;		// offset of nodes section
+	long long			off_bnds;		// offset of bnds section
+	long long			off_pidx;		// offset of pidx section
+	long long			off_pts;		// offset of pts section
+	long long			off_leaf;		// offset of leaf section
+	long long			file_size;		// total size
+};
+
+static ANNbool annLittleEndian()		// is this machine little-endian?
+{
+	unsigned x = ANN_SNAP_ORDER;
+	return (ANNbool) (*(unsigned char*) &x == 0x04);
+}
+
+static long long annSnapAlign(			// round up to section boundary
+	long long			off)			// offset
+{
+	return (off + ANN_SNAP_ALIGN - 1) / ANN_SNAP_ALIGN * ANN_SNAP_ALIGN;
+}
+
+static void annSnapLayout(				// set offsets from counts
+	ANNsnap_header		&h)				// the header (modified)
+{
+	long long pt_size = (long long) h.dim * sizeof(ANNcoord);
+	h.off_box	= annSnapAlign(sizeof(h));
+	h.off_nodes	= annSnapAlign(h.off_box + 2*pt_size);
+	h.off_bnds	= annSnapAlign(h.off_nodes +
+						(long long) h.n_nodes * sizeof(ANNflat_node));
+	h.off_pidx	= annSnapAlign(h.off_bnds +
+						(long long) h.n_bnds * sizeof(ANNorthHalfSpace));
+	h.off_pts	= annSnapAlign(h.off_pidx +
+						(long long) h.n_pidx * sizeof(ANNidx));
+	h.off_leaf	= annSnapAlign(h.off_pts + h.n_pts * pt_size);
+	h.file_size	= h.off_leaf + (h.has_leaf ? h.n_pidx * pt_size : 0);
+}
+
+//----------------------------------------------------------------------
+//	File mapping
+//		The file is mapped read-only and shared, so processes that
+//		map the same snapshot share one copy of it in the page cache.
+//----------------------------------------------------------------------
+
+struct ANNflat_map {					// a mapped file
+	const char			*base;			// start of mapping
+	size_t				size;			// size of file
+#ifdef _WIN32
+	HANDLE				file;			// file handle
+	HANDLE				map;			// mapping handle
+#endif
+};
+
+static ANNflat_map *annMapFile(			// map a file
+	const char			*file)			// file name
+{
+	ANNflat_map *m = new ANNflat_map;
+#ifdef _WIN32
+	m->file = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m->file == INVALID_HANDLE_VALUE) {
+		annError("Cannot open snapshot file", ANNabort);
+	}
+	LARGE_INTEGER sz;
+	GetFileSizeEx(m->file, &sz);
+	m->size = (size_t) sz.QuadPart;
+	m->map = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m->map == NULL) {
+		annError("Cannot map snapshot file", ANNabort);
+	}
+	m->base = (const char*) MapViewOfFile(m->map, FILE_MAP_READ, 0, 0, 0);
+	if (m->base == NULL) {
+		annError("Cannot map snapshot file", ANNabort);
+	}
+#else
+	int fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		annError("Cannot open snapshot file", ANNabort);
+	}
+	struct stat st;
+	fstat(fd, &st);
+	m->size = (size_t) st.st_size;
+	void *p = mmap(NULL, m->size > 0 ? m->size : 1, PROT_READ, MAP_SHARED,
+			fd, 0);
+	close(fd);							// (the mapping stays)
+	if (p == MAP_FAILED) {
+		annError("Cannot map snapshot file", ANNabort);
+	}
+	m->base = (const char*) p;
+#endif
+	return m;
+}
+
+static void annUnmapFile(				// unmap a file
+	ANNflat_map			*m)				// the mapping
+{
+#ifdef _WIN32
+	UnmapViewOfFile(m->base);
+	CloseHandle(m->map);
+	CloseHandle(m->file);
+#else
+	munmap((void*) m->base, m->size > 0 ? m->size : 1);
+#endif
+	delete m;
+}
+
+//----------------------------------------------------------------------
+//	Save - write a snapshot
+//----------------------------------------------------------------------
+
+static void annSnapWrite(				// write a section
+	ofstream			&out,			// output file
+	long long			off,			// its offset
+	const void			*data,			// its contents
+	long long			size)			// its size
+{
+	static const char zeros[ANN_SNAP_ALIGN] = {0};
+	long long gap = off - (long long) out.tellp();
+	out.write(zeros, (streamsize) gap);	// pad to section boundary
+	if (size > 0) out.write((const char*) data, (streamsize) size);
+}
+
+void ANNkd_flat_tree::Save(				// write a snapshot
+	const char			*file)			// file name
+{
+	if (!annLittleEndian()) {
+		annError("Snapshots need a little-endian machine", ANNabort);
+	}
+	int n_pidx = 0;						// count the point indices
+	for (int i = 0; i < n_nodes; i++) {
+		if (nodes[i].cut_dim == ANN_FLAT_LEAF) n_pidx += nodes[i].n;
+	}
+
+	ANNsnap_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, ANN_SNAP_MAGIC, sizeof(h.magic));
+	h.version		= ANN_SNAP_VERSION;
+	h.order			= ANN_SNAP_ORDER;
+	h.coord_size	= sizeof(ANNcoord);
+	h.idx_size		= sizeof(ANNidx);
+	h.node_size		= sizeof(ANNflat_node);
+	h.bnd_size		= sizeof(ANNorthHalfSpace);
+	h.dim			= dim;
+	h.n_pts			= n_pts;
+	h.n_pidx		= n_pidx;
+	h.n_nodes		= n_nodes;
+	h.n_bnds		= n_bnds;
+	h.max_depth		= max_depth;
+	h.has_leaf		= (leaf_coords != NULL);
+
+	annSnapLayout(h);
+
+	long long pt_size = (long long) dim * sizeof(ANNcoord);
+
+	ofstream out(file, ios::out | ios::binary | ios::trunc);
+	if (!out) {
+		annError("Cannot create snapshot file", ANNabort);
+	}
+	annSnapWrite(out, 0, &h, sizeof(h));
+	annSnapWrite(out, h.off_box, bnd_box_lo, pt_size);
+	annSnapWrite(out, h.off_box + pt_size, bnd_box_hi, pt_size);
+	annSnapWrite(out, h.off_nodes, nodes, n_nodes * sizeof(ANNflat_node));
+	annSnapWrite(out, h.off_bnds, bnds, n_bnds * sizeof(ANNorthHalfSpace));
+	annSnapWrite(out, h.off_pidx, pidx, n_pidx * sizeof(ANNidx));
+	for (int i = 0; i < n_pts; i++) {	// points, one at a time
+		annSnapWrite(out, h.off_pts + i*pt_size, pts[i], pt_size);
+	}
+	if (h.has_leaf) {
+		annSnapWrite(out, h.off_leaf, leaf_coords, n_pidx * pt_size);
+	}
+	out.flush();
+	if (!out) {
+		annError("Error writing snapshot file", ANNabort);
+	}
+}
+
+//----------------------------------------------------------------------
+//	Snapshot constructor
+//		Maps the file and checks the header.  The arrays of the tree
+//		then point directly into the mapping, so nothing is read until
+//		a search touches it.  The only thing allocated is the array of
+//		point pointers (pts), which points to the rows of the points
+//		section.
+//----------------------------------------------------------------------
+
+ANNkd_flat_tree::ANNkd_flat_tree(		// load a snapshot
+	const char			*file)			// file name
+{
+	if (!annLittleEndian()) {
+		annError("Snapshots need a little-endian machine", ANNabort);
+	}
+	mapping = annMapFile(file);
+	const char *base = mapping->base;
+
+	ANNsnap_header h;
+	if (mapping->size < sizeof(h)) {
+		annError("Snapshot file is too short", ANNabort);
+	}
+	memcpy(&h, base, sizeof(h));
+	if (memcmp(h.magic, ANN_SNAP_MAGIC, sizeof(h.magic)) != 0 ||
+		h.order != ANN_SNAP_ORDER) {
+		annError("Not an ANN snapshot file", ANNabort);
+	}
+	if (h.version != ANN_SNAP_VERSION) {
+		annError("Unsupported snapshot version", ANNabort);
+	}
+	if (h.coord_size != sizeof(ANNcoord) || h.idx_size != sizeof(ANNidx) ||
+		h.node_size != sizeof(ANNflat_node) ||
+		h.bnd_size != sizeof(ANNorthHalfSpace)) {
+		annError("Snapshot was written with different data types", ANNabort);
+	}
+	ANNsnap_header lay = h;				// check the layout
+	annSnapLayout(lay);
+	if (h.dim < 1 || h.n_pts < 0 || h.n_pidx < 0 || h.n_nodes < 1 ||
+		h.n_bnds < 0 || memcmp(&lay, &h, sizeof(h)) != 0 ||
+		h.file_size != (long long) mapping->size) {
+		annError("Snapshot file is damaged", ANNabort);
+	}
+
+	dim			= h.dim;
+	n_pts		= h.n_pts;
+	n_nodes		= h.n_nodes;
+	n_bnds		= h.n_bnds;
+	max_depth	= h.max_depth;
+
+	bnd_box_lo	= (ANNpoint) (base + (size_t) h.off_box);
+	bnd_box_hi	= bnd_box_lo + dim;
+	nodes		= (ANNflat_node*) (base + (size_t) h.off_nodes);
+	bnds		= (n_bnds > 0 ?
+					(ANNorthHalfSpace*) (base + (size_t) h.off_bnds) : NULL);
+	pidx		= (ANNidxArray) (base + (size_t) h.off_pidx);
+	leaf_coords	= (h.has_leaf ?
+					(ANNcoord*) (base + (size_t) h.off_leaf) : NULL);
+
+	ANNcoord *rows = (ANNcoord*) (base + (size_t) h.off_pts);
+	pts = new ANNpoint[n_pts > 0 ? n_pts : 1];
+	for (int i = 0; i < n_pts; i++) {
+		pts[i] = rows + (size_t) i*dim;
+	}
+}
+
+//----------------------------------------------------------------------
+//	annUnmapFlat - release a mapped tree (called by the destructor)
+//----------------------------------------------------------------------
+
+void annUnmapFlat(						// release a mapped tree
+	ANNflat_map			*mapping)		// its mapping
+{
+	annUnmapFile(mapping);
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,477 @@
+//----------------------------------------------------------------------
+// File:			kd_forest.cpp
+// Programmer:		NNP contributors
+// Description:		Dynamic point sets (forests of kd-trees)
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include <algorithm>					// sort
+#include <unordered_map>				// blocks of the points
+#include <vector>						// blocks and results
+
+#include "kd_tree.h"					// kd-tree declarations
+#include "kd_leaf_quant.h"				// quantized leaf codes
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	The forest
+//		The points are divided into blocks, each with its own copy of
+//		its points and (unless it has fewer than ANN_FOREST_MIN_TREE
+//		points, which are simply scanned) a kd-tree over them.  A map
+//		gives the block of each point and its number in the block.
+//
+//		A new point becomes a block of its own, which is merged with
+//		the blocks that are no larger than the points merged so far,
+//		smallest first, so that the block sizes roughly follow the
+//		binary digits of the number of points, and each point is
+//		copied O(log n) times as the forest grows.
+//
+//		A point removed from a block without a tree is replaced by the
+//		block's last point.  A point removed from a block with a tree
+//		is taken out of the bucket of its leaf (found through the
+//		block's leaf_of, see ANNkd_leaf::remove()), so the tree no
+//		longer finds it, and once half of the points of the block have
+//		been removed, the block is built again from those remaining.
+//		Every point found by a search is thus still in the set, and
+//		searches need not check.  Merges and rebuilds copy only the
+//		points remaining.
+//----------------------------------------------------------------------
+
+const int ANN_FOREST_MIN_TREE = 64;		// min points of a block with a tree
+
+struct ANNforest_block {				// a block of points
+	int					n;				// number of points built over
+	int					live;			// number not removed
+	ANNpointArray		pts;			// the points
+	std::vector<ANNidx>	idx;			// indices of the points
+	std::vector<ANNbool> alive;			// which have not been removed
+	ANNkd_tree			*tree;			// tree of the points (or NULL)
+	std::vector<ANNkd_leaf*> leaf_of;	// leaf of each point (if a tree)
+};
+
+struct ANNforest_loc {					// where a point is
+	ANNforest_block		*b;				// its block
+	int					j;				// its number in the block
+};
+
+struct ANNforest_nn {					// a near neighbor
+	ANNdist				dist;			// squared distance
+	ANNidx				idx;			// its index
+};
+
+struct ANNforest_data {
+	int					dim;			// dimension of space
+	int					bsp;			// bucket size of the trees
+	ANNsplitRule		split;			// splitting rule of the trees
+	int					n_pts;			// number of points
+	std::vector<ANNforest_block*> blocks;	// the blocks
+	std::unordered_map<ANNidx, ANNforest_loc> where;	// where points are
+
+	ANNforest_block *new_block(			// make a block
+		const std::vector<ANNpoint> &src,	// the points to copy
+		const std::vector<ANNidx> &idx);	// their indices
+
+	void remove(						// remove a point
+		ANNforest_loc	loc);			// where it is
+
+	void search(						// k nearest neighbors
+		ANNpoint		q,				// query point
+		int				k,				// number of near neighbors
+		double			eps,			// error bound
+		std::vector<ANNforest_nn> &nn);	// the near neighbors (returned)
+};
+
+//----------------------------------------------------------------------
+//	Block utilities
+//		new_block allocates a block for copies of the given points,
+//		builds its tree and records where its points are.  The block
+//		is not added to the list of blocks.  live_points appends the
+//		points of a block that have not been removed to src and idx.
+//----------------------------------------------------------------------
+
+ANNforest_block *ANNforest_data::new_block(
+	const std::vector<ANNpoint> &src,	// the points to copy
+	const std::vector<ANNidx> &ix)		// their indices
+{
+	ANNforest_block *b = new ANNforest_block;
+	int n = (int) src.size();
+	b->n = b->live = n;
+	b->pts = annAllocPts(n, dim);
+	b->idx = ix;
+	b->alive.assign(n, ANNtrue);
+	for (int j = 0; j < n; j++) {
+		for (int d = 0; d < dim; d++) b->pts[j][d] = src[j][d];
+		ANNforest_loc loc;
+		loc.b = b;
+		loc.j = j;
+		where[ix[j]] = loc;
+	}
+	b->tree = NULL;
+	if (n >= ANN_FOREST_MIN_TREE) {		// build its tree
+		b->tree = new ANNkd_tree(b->pts, n, dim, bsp, split);
+		b->leaf_of.assign(n, (ANNkd_leaf*) NULL);
+		b->tree->root->fill_leaves(&b->leaf_of[0]);
+	}
+	return b;
+}
+
+static void delete_block(				// delete a block
+	ANNforest_block		*b)				// the block
+{
+	delete b->tree;
+	annDeallocPts(b->pts);
+	delete b;
+}
+
+static void live_points(				// points not removed
+	ANNforest_block		*b,				// the block
+	std::vector<ANNpoint> &src,			// points (appended)
+	std::vector<ANNidx>	&idx)			// indices (appended)
+{
+	for (int j = 0; j < b->n; j++) {
+		if (b->alive[j]) {
+			src.push_back(b->pts[j]);
+			idx.push_back(b->idx[j]);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	remove - remove a point, given where it is
+//		The point must already be out of the map.  A block left with
+//		no points is deleted, and one with a tree that has lost half
+//		of its points is built again.
+//----------------------------------------------------------------------
+
+void ANNforest_data::remove(ANNforest_loc loc)
+{
+	ANNforest_block *b = loc.b;
+	int j = loc.j;
+	if (b->tree == NULL) {				// move the last point here
+		int last = b->live - 1;
+		if (j != last) {
+			for (int d = 0; d < dim; d++) b->pts[j][d] = b->pts[last][d];
+			b->idx[j] = b->idx[last];
+			where[b->idx[j]].j = j;
+		}
+		b->alive[last] = ANNfalse;
+	}
+	else {								// take it out of its leaf
+		b->leaf_of[j]->remove(j, b->pts, dim, b->tree->leaf_quant);
+		b->alive[j] = ANNfalse;
+	}
+	b->live--;
+	n_pts--;
+
+	if (b->live > 0 && (b->tree == NULL || 2*b->live > b->n)) return;
+
+	std::vector<ANNforest_block*>::iterator it =
+			std::find(blocks.begin(), blocks.end(), b);
+	if (b->live > 0) {					// build it again
+		std::vector<ANNpoint> src;
+		std::vector<ANNidx> ix;
+		live_points(b, src, ix);
+		*it = new_block(src, ix);
+	}
+	else {
+		blocks.erase(it);
+	}
+	delete_block(b);
+}
+
+//----------------------------------------------------------------------
+//	search - k nearest neighbors of a point
+//		Each block is searched and the k closest results are kept,
+//		in order of increasing distance.  The largest block is
+//		searched first, and once k results have been found, the
+//		other trees are given a fixed-radius search, with the k-th
+//		distance so far as the radius, which visits far fewer nodes.
+//----------------------------------------------------------------------
+
+void ANNforest_data::search(
+	ANNpoint			q,				// query point
+	int					k,				// number of near neighbors
+	double				eps,			// error bound
+	std::vector<ANNforest_nn> &nn)		// the near neighbors (returned)
+{
+	nn.clear();
+	if (k <= 0) return;
+	std::vector<ANNidx> b_idx(k);		// results of one block
+	std::vector<ANNdist> b_dd(k);
+
+	int n_blocks = (int) blocks.size();
+	int big = 0;						// the largest block
+	for (int i = 1; i < n_blocks; i++) {
+		if (blocks[i]->live > blocks[big]->live) big = i;
+	}
+
+	for (int i = 0; i < n_blocks; i++) {
+		ANNforest_block *b = blocks[i == 0 ? big : (i == big ? 0 : i)];
+		int m = (k < b->live ? k : b->live);
+		if (b->tree != NULL) {			// search its tree
+			if ((int) nn.size() < k) {
+				b->tree->annkSearch(q, m, &b_idx[0], &b_dd[0], eps);
+			}
+			else {						// only closer than the k-th
+				int in = b->tree->annkFRSearch(q, nn.back().dist, m,
+						&b_idx[0], &b_dd[0], eps);
+				if (in < m) m = in;
+			}
+		}
+		else {							// scan its points
+			m = b->live;
+			if ((int) b_idx.size() < m) {
+				b_idx.resize(m);
+				b_dd.resize(m);
+			}
+			for (int j = 0; j < m; j++) {
+				b_idx[j] = j;
+				b_dd[j] = annDist(dim, q, b->pts[j]);
+			}
+		}
+		for (int j = 0; j < m; j++) {	// insert into the k closest
+			ANNforest_nn a;
+			a.dist = b_dd[j];
+			a.idx = b->idx[b_idx[j]];
+			if ((int) nn.size() == k && !(a.dist < nn.back().dist)) continue;
+			if ((int) nn.size() == k) nn.pop_back();
+			int pos = (int) nn.size();
+			nn.push_back(a);
+			while (pos > 0 && a.dist < nn[pos-1].dist) {
+				nn[pos] = nn[pos-1];
+				pos--;
+			}
+			nn[pos] = a;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	Constructors and destructor
+//		The second constructor makes a single block of the points of
+//		pa, with indices 0 to n-1.
+//----------------------------------------------------------------------
+
+ANNkd_forest::ANNkd_forest(
+	int					dd,				// dimension
+	int					bs,				// bucket size
+	ANNsplitRule		sp)				// splitting rule
+{
+	dim = dd;
+	bkt_size = bs;
+	split = sp;
+	data = new ANNforest_data;
+	data->dim = dd;
+	data->bsp = bs;
+	data->split = sp;
+	data->n_pts = 0;
+}
+
+ANNkd_forest::ANNkd_forest(
+	ANNpointArray		pa,				// point array
+	int					n,				// number of points
+	int					dd,				// dimension
+	int					bs,				// bucket size
+	ANNsplitRule		sp)				// splitting rule
+{
+	dim = dd;
+	bkt_size = bs;
+	split = sp;
+	data = new ANNforest_data;
+	data->dim = dd;
+	data->bsp = bs;
+	data->split = sp;
+	data->n_pts = n;
+	if (n == 0) return;
+
+	std::vector<ANNpoint> src(pa, pa + n);
+	std::vector<ANNidx> idx(n);
+	for (int i = 0; i < n; i++) idx[i] = i;
+	data->blocks.push_back(data->new_block(src, idx));
+}
+
+ANNkd_forest::~ANNkd_forest()
+{
+	for (size_t i = 0; i < data->blocks.size(); i++) {
+		delete_block(data->blocks[i]);
+	}
+	delete data;
+}
+
+int ANNkd_forest::nPoints()				// return number of points
+{
+	return data->n_pts;
+}
+
+int ANNkd_forest::nTrees()				// return number of trees
+{
+	int n = 0;
+	for (size_t i = 0; i < data->blocks.size(); i++) {
+		if (data->blocks[i]->tree != NULL) n++;
+	}
+	return n;
+}
+
+//----------------------------------------------------------------------
+//	insert - add a point
+//		The new point is merged with the blocks, smallest first, that
+//		are no larger than the points merged so far, into a new
+//		block.
+//----------------------------------------------------------------------
+
+static bool smaller_block(ANNforest_block *a, ANNforest_block *b)
+{
+	return a->live < b->live;
+}
+
+void ANNkd_forest::insert(
+	ANNpoint			p,				// the point (copied)
+	ANNidx				idx)			// its index
+{
+	if (data->where.count(idx) != 0) {
+		annError("Point index is already in the forest", ANNabort);
+	}
+	std::vector<ANNforest_block*> &bl = data->blocks;
+	std::sort(bl.begin(), bl.end(), smaller_block);
+
+	std::vector<ANNpoint> src(1, p);	// the points to merge
+	std::vector<ANNidx> ix(1, idx);
+	int m = 0;							// blocks to merge
+	while (m < (int) bl.size() && bl[m]->live <= (int) src.size()) {
+		live_points(bl[m++], src, ix);
+	}
+
+	ANNforest_block *b = data->new_block(src, ix);
+	for (int i = 0; i < m; i++) {
+		delete_block(bl[i]);
+	}
+	bl.erase(bl.begin(), bl.begin() + m);
+	bl.push_back(b);
+	data->n_pts++;
+}
+
+//----------------------------------------------------------------------
+//	remove - remove a point
+//----------------------------------------------------------------------
+
+ANNbool ANNkd_forest::remove(
+	ANNidx				idx)			// its index
+{
+	std::unordered_map<ANNidx, ANNforest_loc>::iterator it =
+			data->where.find(idx);
+	if (it == data->where.end()) return ANNfalse;
+	ANNforest_loc loc = it->second;
+	data->where.erase(it);
+	data->remove(loc);
+	return ANNtrue;
+}
+
+//----------------------------------------------------------------------
+//	Searches
+//		annkFRSearch() counts the points in range in every block (so
+//		it cannot narrow the radius), and keeps the k closest of them.
+//----------------------------------------------------------------------
+
+void ANNkd_forest::annkSearch(
+	ANNpoint			q,				// query point
+	int					k,				// number of near neighbors
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// the approximate nearest neighbor
+	double				eps)			// the error bound
+{
+	if (k > nPoints()) {
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+	std::vector<ANNforest_nn> nn;
+	data->search(q, k, eps, nn);
+	for (int i = 0; i < k; i++) {
+		nn_idx[i] = nn[i].idx;
+		dd[i] = nn[i].dist;
+	}
+}
+
+int ANNkd_forest::annkFRSearch(
+	ANNpoint			q,				// query point
+	ANNdist				sqRad,			// squared radius
+	int					k,				// number of near neighbors
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// the approximate nearest neighbor
+	double				eps)			// the error bound
+{
+	std::vector<ANNforest_nn> nn;		// the k closest in range
+	std::vector<ANNidx> b_idx(k);		// results of one block
+	std::vector<ANNdist> b_dd(k);
+	int in_range = 0;
+
+	for (size_t i = 0; i < data->blocks.size(); i++) {
+		ANNforest_block *b = data->blocks[i];
+		int m = 0;						// results of the block
+		if (b->tree != NULL) {			// search its tree
+			int kb = (k < b->live ? k : b->live);
+			int in = b->tree->annkFRSearch(q, sqRad, kb,
+					(kb > 0 ? &b_idx[0] : NULL), (kb > 0 ? &b_dd[0] : NULL), eps);
+			in_range += in;
+			m = (in < kb ? in : kb);
+		}
+		else {							// scan its points
+			for (int j = 0; j < b->live; j++) {
+				ANNdist dist = annDist(dim, q, b->pts[j]);
+				if (dist > sqRad) continue;
+				in_range++;
+				if (m < k) {
+					b_idx[m] = j;
+					b_dd[m++] = dist;
+				}
+				else if (k > 0) {		// replace the farthest
+					int f = 0;
+					for (int l = 1; l < k; l++) {
+						if (b_dd[l] > b_dd[f]) f = l;
+					}
+					if (dist < b_dd[f]) {
+						b_idx[f] = j;
+						b_dd[f] = dist;
+					}
+				}
+			}
+		}
+		for (int j = 0; j < m; j++) {	// insert into the k closest
+			ANNforest_nn a;
+			a.dist = b_dd[j];
+			a.idx = b->idx[b_idx[j]];
+			if ((int) nn.size() == k && !(a.dist < nn.back().dist)) continue;
+			if ((int) nn.size() == k) nn.pop_back();
+			int pos = (int) nn.size();
+			nn.push_back(a);
+			while (pos > 0 && a.dist < nn[pos-1].dist) {
+				nn[pos] = nn[pos-1];
+				pos--;
+			}
+			nn[pos] = a;
+		}
+	}
+
+	for (int i = 0; i < k; i++) {		// return the k closest
+		if (dd != NULL)
+			dd[i] = (i < (int) nn.size() ? nn[i].dist : ANN_DIST_INF);
+		if (nn_idx != NULL)
+			nn_idx[i] = (i < (int) nn.size() ? nn[i].idx : ANN_NULL_IDX);
+	}
+	return in_range;
+}
+
+ANN_END_NAMESPACE
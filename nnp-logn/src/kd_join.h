@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------
+// File:			kd_join.h
+// Programmer:		NNP contributors
+// Description:		Join trees for dual-tree traversals
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_kd_join_H
+#define ANN_kd_join_H
+
+#include <vector>						// join tree nodes
+
+#include "kd_flat.h"					// flattening
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Join trees
+//		The dual-tree traversals (the kNN joins of kd_all_knn.cpp and
+//		the closest pairs of kd_close_pairs.cpp) use copies of the
+//		trees made from their flattened forms, in which every node has
+//		the smallest box enclosing its points (which is usually much
+//		smaller than its cell), the range of its points in the
+//		flattened point index array, and a bound for the traversal's
+//		use.  The nodes are stored in postorder (the children before
+//		the parent).  Shrinking nodes of bd-trees are treated like
+//		splitting nodes, and empty leaves are dropped.  Since trees
+//		usually have very small buckets, each subtree of at most
+//		max_leaf points becomes a single leaf, so that the cost of
+//		visiting a pair of nodes is spread over many point
+//		comparisons.
+//
+//		The join trees are defined in kd_all_knn.cpp.
+//----------------------------------------------------------------------
+
+const int ANN_ALL_KNN_LEAF	= 64;		// default max points of a leaf
+
+struct ANNjoin_node {					// node of a join tree
+	int					first;			// first point (in pidx)
+	int					n;				// number of points
+	int					child[2];		// children (-1 for a leaf)
+	ANNdist				bound;			// largest k-th distance
+};
+
+class ANNjoin_tree {					// a tree prepared for joins
+public:
+	int					dim;			// dimension of space
+	int					n_pts;			// number of points
+	int					max_leaf;		// max points of a leaf
+	ANNpointArray		pts;			// the points
+	std::vector<ANNidx>	pidx;			// point indices, in leaf order
+	std::vector<ANNjoin_node> nodes;	// the nodes, in postorder
+	std::vector<ANNcoord> lo;			// box low points (dim per node)
+	std::vector<ANNcoord> hi;			// box high points (dim per node)
+	std::vector<ANNcoord> coords;		// leaf coordinate blocks (or empty)
+	int					root;			// root (or -1 if no points)
+
+	ANNjoin_tree(						// constructor
+		ANNkd_tree		&tree,			// the tree
+		ANNbool			with_coords,	// make leaf coordinate blocks?
+		int				leaf = ANN_ALL_KNN_LEAF);	// max points of a leaf
+
+	int build(							// copy a flat subtree
+		const std::vector<ANNflat_node> &fn,	// flat nodes
+		int				i);				// root of subtree
+
+	void subtrees(						// cut into subtrees
+		int				q,				// root of subtree to cut
+		int				max_n,			// max points per subtree
+		std::vector<int> &out);			// the subtrees (returned)
+};
+
+ANN_END_NAMESPACE
+
+#endif
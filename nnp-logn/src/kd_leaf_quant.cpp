@@ -0,0 +1,298 @@
+//----------------------------------------------------------------------
+// File:			kd_leaf_quant.cpp
+// Programmer:		NNP contributors
+// Description:		Quantized leaf codes for kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "kd_leaf_quant.h"				// quantized leaf codes
+#include "kd_tree.h"					// kd-tree declarations
+#include "pr_queue_k.h"					// k-element priority queue
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Quantizer constructor and destructor
+//		A dimension along which the box is flat gets a scale of zero,
+//		so all its coordinates (and those of the queries) are in cell
+//		0, and it adds nothing to the bounds.
+//----------------------------------------------------------------------
+
+ANNleaf_quant::ANNleaf_quant(
+	ANNleafCodes		t,				// type of codes
+	int					n,				// number of points
+	int					dd,				// dimension of space
+	ANNpoint			bnd_lo,			// bounding box low point
+	ANNpoint			bnd_hi)			// bounding box high point
+{
+	type	= t;
+	size	= (t == ANN_CODES_INT16 ? 2 : 1);
+	dim		= dd;
+	levels	= (t == ANN_CODES_INT16 ? 1 << 16 : 1 << 8);
+	lo		= new double[dim];
+	scale	= new double[dim];
+	step	= new float[dim];
+	codes	= new unsigned char[(size_t) n * dim * size];
+
+	for (int d = 0; d < dim; d++) {
+		double len = (double) bnd_hi[d] - (double) bnd_lo[d];
+		lo[d] = bnd_lo[d];
+		if (len > 0) {
+			scale[d] = levels / len;
+			step[d] = (float) (len / levels * (1 - ANN_CODE_SLACK));
+		}
+		else {							// flat dimension
+			scale[d] = 0;
+			step[d] = 0;
+		}
+	}
+}
+
+ANNleaf_quant::~ANNleaf_quant()
+{
+	delete [] lo;
+	delete [] scale;
+	delete [] step;
+	delete [] codes;
+}
+
+//----------------------------------------------------------------------
+//	annCell - cell of a coordinate
+//		The result is clamped to [-1, L], which only weakens the bound
+//		for coordinates far outside the box.
+//----------------------------------------------------------------------
+
+static int annCell(						// cell of a coordinate
+	const ANNleaf_quant	&lq,			// the quantizer
+	int					d,				// dimension
+	ANNcoord			x)				// the coordinate
+{
+	double v = floor(((double) x - lq.lo[d]) * lq.scale[d]);
+	if (v < -1) return -1;
+	if (v > lq.levels) return lq.levels;
+	return (int) v;
+}
+
+//----------------------------------------------------------------------
+//	fill - fill the code block of a leaf
+//		Points on the upper face of the box are put in the last cell.
+//----------------------------------------------------------------------
+
+void ANNleaf_quant::fill(
+	unsigned char		*block,			// the block (modified)
+	ANNpointArray		pa,				// the points
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n)				// number of points in leaf
+{
+	for (int d = 0; d < dim; d++) {
+		for (int j = 0; j < n; j++) {
+			int c = annCell(*this, d, pa[bkt[j]][d]);
+			if (c < 0) c = 0;
+			if (c >= levels) c = levels-1;
+			if (size == 1)
+				block[d*n + j] = (unsigned char) c;
+			else
+				((unsigned short *) block)[d*n + j] = (unsigned short) c;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	query - quantize a query point
+//		Stores the cells of the coordinates of q in qc.  The searches
+//		keep qc in their workspace (see search_space.h).
+//----------------------------------------------------------------------
+
+void ANNleaf_quant::query(
+	ANNpoint			q,				// the query
+	int					*qc) const		// its cells (returned)
+{
+	for (int d = 0; d < dim; d++) {
+		qc[d] = annCell(*this, d, q[d]);
+	}
+}
+
+void ANNkd_search_ctx::set_quant(		// quantize the query point
+	const ANNleaf_quant	*lq,			// the quantizer
+	int					*qc)			// room for the cells (dim)
+{
+	lq->query(q, qc);
+	quant = lq;
+	q_code = qc;
+}
+
+//----------------------------------------------------------------------
+//	annLeafBoundsPlain - plain C++ bound kernel
+//		The bounds are checked against the given bound after every
+//		four coordinates.
+//----------------------------------------------------------------------
+
+ANNbool annLeafBoundsPlain(
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	const int			*qc,			// cells of query point
+	float				bound,			// give up if all exceed this
+	float				*lb)			// lower bounds (returned)
+{
+	const unsigned short *block16 = (const unsigned short *) block;
+	int j;
+	for (j = 0; j < m; j++) lb[j] = 0;
+
+	for (int d = 0; d < lq.dim; d++) {
+		int b = qc[d];					// cell of the query
+		float s = lq.step[d];			// cell width
+		for (j = 0; j < m; j++) {
+			int c = (lq.size == 1 ? block[d*n + j0 + j]
+								  : block16[d*n + j0 + j]);
+			int g = (c > b ? c - b : b - c) - 1;	// cells in between
+			if (g > 0) {
+				float t = g * s;
+				lb[j] = ANN_SUM(lb[j], ANN_POW(t));
+			}
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			for (j = 0; j < m && lb[j] > bound; j++) ;
+			if (j == m) return ANNfalse;
+		}
+	}
+	return ANNtrue;
+}
+
+//----------------------------------------------------------------------
+//	annCodeBound - a distance bound for the bound kernels
+//		The bounds are floats whatever ANNdist is.  An infinite (or
+//		huge) distance becomes FLT_MAX.  Otherwise the conversion may
+//		round down very slightly, which the slack of the bounds more
+//		than makes up for.
+//----------------------------------------------------------------------
+
+static float annCodeBound(				// float bound of a distance
+	ANNdist				d)				// the distance
+{
+	return (d >= FLT_MAX ? FLT_MAX : (float) d);
+}
+
+//----------------------------------------------------------------------
+//	annScanLeafCodes - k-NN scan of a leaf code block
+//		The distance to a point is computed (as in the ordinary leaf
+//		search) only if its lower bound does not exceed the k-th
+//		smallest distance so far.
+//----------------------------------------------------------------------
+
+void annScanLeafCodes(
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	ANNpointArray		pa,				// the points
+	ANNpoint			q,				// query point
+	const int			*qc,			// cells of query point
+	ANNmink				&mk)			// k closest points (modified)
+{
+	float lb[ANN_SCAN_RUN];				// lower bounds of a run
+	int dim = lq.dim;					// dimension of space
+	ANNdist min_dist = mk.maxkey();		// k-th smallest distance so far
+
+	for (int j0 = 0; j0 < n; j0 += ANN_SCAN_RUN) {
+		int m = (n - j0 < ANN_SCAN_RUN ? n - j0 : ANN_SCAN_RUN);
+		if (!annLeafBounds(lq, block, n, j0, m, qc,
+				annCodeBound(min_dist), lb)) {
+			continue;					// none is close enough
+		}
+		for (int j = 0; j < m; j++) {
+			if (lb[j] > min_dist) continue;	// cannot be among the k best
+
+			ANNpoint pp = pa[bkt[j0 + j]];
+			ANNdist dist = 0;
+			int d;
+			for (d = 0; d < dim; d++) {
+				ANN_COORD(1)			// one more coordinate hit
+				ANN_FLOP(4)				// increment floating ops
+
+				ANNcoord t = q[d] - pp[d];
+										// exceeds dist to k-th smallest?
+				if ((dist = ANN_SUM(dist, ANN_POW(t))) > min_dist) {
+					break;
+				}
+			}
+			if (d >= dim &&							// among the k best?
+			   (ANN_ALLOW_SELF_MATCH || dist!=0)) {	// and no self-match
+				mk.insert(dist, bkt[j0 + j]);
+				min_dist = mk.maxkey();
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	annScanLeafCodesFR - fixed-radius scan of a leaf code block
+//		Returns the number of points within the radius.
+//----------------------------------------------------------------------
+
+int annScanLeafCodesFR(
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	ANNpointArray		pa,				// the points
+	ANNpoint			q,				// query point
+	const int			*qc,			// cells of query point
+	ANNdist				sq_rad,			// squared radius
+	ANNmink				&mk)			// k closest points (modified)
+{
+	float lb[ANN_SCAN_RUN];				// lower bounds of a run
+	int dim = lq.dim;					// dimension of space
+	float bound = annCodeBound(sq_rad);	// the radius as a bound
+	int in_range = 0;					// points in range
+
+	for (int j0 = 0; j0 < n; j0 += ANN_SCAN_RUN) {
+		int m = (n - j0 < ANN_SCAN_RUN ? n - j0 : ANN_SCAN_RUN);
+		if (!annLeafBounds(lq, block, n, j0, m, qc, bound, lb)) {
+			continue;					// none is in range
+		}
+		for (int j = 0; j < m; j++) {
+			if (lb[j] > sq_rad) continue;	// cannot be in range
+
+			ANNpoint pp = pa[bkt[j0 + j]];
+			ANNdist dist = 0;
+			int d;
+			for (d = 0; d < dim; d++) {
+				ANN_COORD(1)			// one more coordinate hit
+				ANN_FLOP(5)				// increment floating ops
+
+				ANNcoord t = q[d] - pp[d];
+										// exceeds the radius?
+				if ((dist = ANN_SUM(dist, ANN_POW(t))) > sq_rad) {
+					break;
+				}
+			}
+			if (d >= dim &&							// within the radius?
+			   (ANN_ALLOW_SELF_MATCH || dist!=0)) {	// and no self-match
+				mk.insert(dist, bkt[j0 + j]);
+				in_range++;
+			}
+		}
+	}
+	return in_range;
+}
+
+ANN_END_NAMESPACE
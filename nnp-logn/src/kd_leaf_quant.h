@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------
+// File:			kd_leaf_quant.h
+// Programmer:		NNP contributors
+// Description:		Quantized leaf codes for kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_kd_leaf_quant_H
+#define ANN_kd_leaf_quant_H
+
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Quantized leaf codes
+//		When leaf codes are enabled (see annLeafCodes()), each leaf
+//		keeps a block of small integer codes for its points, in the
+//		same structure-of-arrays order as the leaf coordinate blocks
+//		of kd_leaf_scan.h (which it replaces).  Each code is one byte
+//		(ANN_CODES_INT8) or two (ANN_CODES_INT16).  The codes are
+//		only used to prune the leaf scans, and are kept in addition
+//		to the point array, which is still read for every candidate.
+//		They add n*dim (or 2*n*dim) bytes and save no memory.
+//
+//		The quantization is per dimension, over the bounding box of
+//		the tree.  Along dimension d the box is cut into L equal
+//		cells, of width step[d], and the code of a coordinate is the
+//		number of its cell, from 0 to L-1.  The query is given the
+//		cell numbers of its coordinates in the same way, except that
+//		they range from -1 (below the box) to L (above it).  If a
+//		coordinate of a point has code c and that of the query has
+//		cell b, then the two differ by at least
+//
+//				g*step[d],	where g = max(|c - b| - 1, 0).
+//
+//		Summing these over the dimensions gives a lower bound on the
+//		distance from the query to the point, which is computed from
+//		the codes alone, in integer arithmetic (except for the final
+//		scaling by the step).  The leaf scans compute these bounds for
+//		a run of points at a time, and compute the true distance, from
+//		the point array, only for the points whose bound does not
+//		exceed the k-th smallest distance so far (or the radius).  The
+//		other points are exactly those that could not be inserted, so
+//		the results are the same as those of the ordinary search.
+//
+//		To allow for roundoff in the quantization and in the sums, the
+//		steps are shrunk slightly (by the factor 1 - ANN_CODE_SLACK)
+//		before they are used in the bounds.
+//----------------------------------------------------------------------
+
+const float ANN_CODE_SLACK = 1e-4f;		// relative slack of the bounds
+
+class ANNleaf_quant {					// quantizer and code array
+public:
+	ANNleafCodes		type;			// type of codes
+	int					size;			// bytes per code
+	int					dim;			// dimension of space
+	int					levels;			// number of cells (L)
+	double				*lo;			// low end of box
+	double				*scale;			// cells per unit length
+	float				*step;			// (shrunk) cell widths
+	unsigned char		*codes;			// code blocks of all leaves
+
+	ANNleaf_quant(						// constructor
+		ANNleafCodes	t,				// type of codes
+		int				n,				// number of points
+		int				dd,				// dimension of space
+		ANNpoint		bnd_lo,			// bounding box low point
+		ANNpoint		bnd_hi);		// bounding box high point
+
+	~ANNleaf_quant();					// destructor
+
+	void fill(							// fill the code block of a leaf
+		unsigned char	*block,			// the block (modified)
+		ANNpointArray	pa,				// the points
+		ANNidxArray		bkt,			// indices of the leaf's points
+		int				n);				// number of points in leaf
+
+	void query(							// quantize a query point
+		ANNpoint		q,				// the query
+		int				*qc) const;		// its cells (returned)
+};
+
+void annScanLeafCodes(					// k-NN scan of a leaf code block
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	ANNpointArray		pa,				// the points
+	ANNpoint			q,				// query point
+	const int			*qc,			// cells of query point
+	ANNmink				&mk);			// k closest points (modified)
+
+int annScanLeafCodesFR(					// fixed-radius scan of a code block
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	ANNpointArray		pa,				// the points
+	ANNpoint			q,				// query point
+	const int			*qc,			// cells of query point
+	ANNdist				sq_rad,			// squared radius
+	ANNmink				&mk);			// k closest points (modified)
+
+//----------------------------------------------------------------------
+//	Bound kernels
+//		A kernel computes the lower bounds of the distances from the
+//		query to a run of m points (m <= ANN_SCAN_RUN) of a leaf with n
+//		points, starting at point j0, and stores them in lb[0..m-1].
+//		Like the distance kernels of kd_leaf_scan.h, it may give up
+//		(and return ANNfalse) as soon as all the bounds of the run
+//		exceed the given bound.
+//
+//		annLeafBoundsPlain is the plain C++ kernel.  The vector kernels
+//		(AVX2 and AVX-512, in kd_leaf_simd.cpp) are selected along with
+//		the distance kernels by annSimdLevel().
+//----------------------------------------------------------------------
+
+typedef ANNbool (*ANNleaf_bounds)(		// bound kernel
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	const int			*qc,			// cells of query point
+	float				bound,			// give up if all exceed this
+	float				*lb);			// lower bounds (returned)
+
+ANNbool annLeafBoundsPlain(				// plain C++ kernel
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	const int			*qc,			// cells of query point
+	float				bound,			// give up if all exceed this
+	float				*lb);			// lower bounds (returned)
+
+extern ANNleaf_bounds	annLeafBounds;	// the kernel in use
+
+ANN_END_NAMESPACE
+
+#endif
@@ -0,0 +1,155 @@
+//----------------------------------------------------------------------
+// File:			kd_leaf_scan.cpp
+// Programmer:		NNP contributors
+// Description:		Scanning leaf coordinate blocks
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//		Added vector distance kernels
+//----------------------------------------------------------------------
+
+#include "kd_leaf_scan.h"				// leaf scan declarations
+#include "pr_queue_k.h"					// k-element priority queue
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	annFillLeafCoords - fill the coordinate block of a leaf
+//----------------------------------------------------------------------
+
+void annFillLeafCoords(
+	ANNcoord			*block,			// the block (modified)
+	ANNpointArray		pa,				// the points
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim)			// dimension of space
+{
+	for (int d = 0; d < dim; d++) {
+		for (int j = 0; j < n; j++) {
+			block[d*n + j] = pa[bkt[j]][d];
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	annLeafDistsPlain - plain C++ distance kernel
+//		The partial sums are checked against the bound after every
+//		four coordinates.
+//----------------------------------------------------------------------
+
+ANNbool annLeafDistsPlain(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	int j;
+	for (j = 0; j < m; j++) dist[j] = 0;
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		ANNcoord qd = q[d];
+		for (j = 0; j < m; j++) {
+			ANNcoord t = qd - c[j];
+			dist[j] = ANN_SUM(dist[j], ANN_POW(t));
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			for (j = 0; j < m && dist[j] > bound; j++) ;
+			if (j == m) return ANNfalse;
+		}
+	}
+	return ANNtrue;
+}
+
+//----------------------------------------------------------------------
+//	annScanLeafCoords - k-NN scan of a leaf block
+//		A point is inserted if its distance does not exceed the k-th
+//		smallest distance so far.  (The ordinary search stops summing
+//		once the partial sum exceeds this, but since the partial sums
+//		only grow, it inserts exactly the same points.)  A run is
+//		skipped if the kernel finds that none of its points can be
+//		inserted.
+//----------------------------------------------------------------------
+
+void annScanLeafCoords(
+	const ANNcoord		*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNmink				&mk)			// k closest points (modified)
+{
+	ANNdist dist[ANN_SCAN_RUN];			// distances of a run
+	ANNdist min_dist = mk.maxkey();		// k-th smallest distance so far
+
+	for (int j0 = 0; j0 < n; j0 += ANN_SCAN_RUN) {
+		int m = (n - j0 < ANN_SCAN_RUN ? n - j0 : ANN_SCAN_RUN);
+		ANN_COORD(m*dim)				// coordinate hits
+		ANN_FLOP(3*m*dim)				// floating ops
+		if (!annLeafDists(block, n, j0, m, dim, q, min_dist, dist)) {
+			continue;					// none is close enough
+		}
+		for (int j = 0; j < m; j++) {
+			if (dist[j] <= min_dist &&				// among the k best?
+			   (ANN_ALLOW_SELF_MATCH || dist[j]!=0)) {	// and no self-match
+				mk.insert(dist[j], bkt[j0 + j]);
+				min_dist = mk.maxkey();
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	annScanLeafCoordsFR - fixed-radius scan of a leaf block
+//		Returns the number of points within the radius.
+//----------------------------------------------------------------------
+
+int annScanLeafCoordsFR(
+	const ANNcoord		*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				sq_rad,			// squared radius
+	ANNmink				&mk)			// k closest points (modified)
+{
+	ANNdist dist[ANN_SCAN_RUN];			// distances of a run
+	int in_range = 0;					// points in range
+
+	for (int j0 = 0; j0 < n; j0 += ANN_SCAN_RUN) {
+		int m = (n - j0 < ANN_SCAN_RUN ? n - j0 : ANN_SCAN_RUN);
+		ANN_COORD(m*dim)				// coordinate hits
+		ANN_FLOP(3*m*dim)				// floating ops
+		if (!annLeafDists(block, n, j0, m, dim, q, sq_rad, dist)) {
+			continue;					// none is in range
+		}
+		for (int j = 0; j < m; j++) {
+			if (dist[j] <= sq_rad &&				// within the radius?
+			   (ANN_ALLOW_SELF_MATCH || dist[j]!=0)) {	// and no self-match
+				mk.insert(dist[j], bkt[j0 + j]);
+				in_range++;
+			}
+		}
+	}
+	return in_range;
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,126 @@
+//----------------------------------------------------------------------
+// File:			kd_leaf_scan.h
+// Programmer:		NNP contributors
+// Description:		Scanning leaf coordinate blocks
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//		Added vector distance kernels
+//----------------------------------------------------------------------
+
+#ifndef ANN_kd_leaf_scan_H
+#define ANN_kd_leaf_scan_H
+
+#include <ANN/ANNx.h>					// all ANN includes
+
+ANN_BEGIN_NAMESPACE
+
+class ANNmink;							// k-element priority queue
+
+//----------------------------------------------------------------------
+//	Leaf coordinate blocks
+//		When leaf coordinates are enabled (see annLeafCoords()), a
+//		copy of the coordinates of the points of each leaf is stored
+//		in a block of its own.  The block of a leaf with n points is
+//		in structure-of-arrays order: the n values of coordinate 0,
+//		then the n values of coordinate 1, and so on.  That is,
+//		coordinate d of the j-th point of the leaf is block[d*n + j].
+//
+//		The blocks of all the leaves are parts of one array, which
+//		holds the points in the order of the tree's point index array
+//		(so the block of a leaf whose bucket starts at position i of
+//		that array starts at position i*dim).  A leaf scan therefore
+//		reads consecutive memory, instead of following one pointer per
+//		point into the point array.
+//
+//		annFillLeafCoords() fills the block of one leaf.  The scans
+//		compute the distances to the points a few at a time, and then
+//		offer them to the set of closest points in bucket order.  The
+//		distances are summed in the same order as in the ordinary
+//		leaf search, and a point is inserted exactly when the ordinary
+//		search would have inserted it, so the results are identical.
+//----------------------------------------------------------------------
+
+void annFillLeafCoords(					// fill leaf coordinate block
+	ANNcoord			*block,			// the block (modified)
+	ANNpointArray		pa,				// the points
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim);			// dimension of space
+
+void annScanLeafCoords(					// k-NN scan of a leaf block
+	const ANNcoord		*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNmink				&mk);			// k closest points (modified)
+
+int annScanLeafCoordsFR(				// fixed-radius scan of a leaf block
+	const ANNcoord		*block,			// the block
+	ANNidxArray			bkt,			// indices of the leaf's points
+	int					n,				// number of points in leaf
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				sq_rad,			// squared radius
+	ANNmink				&mk);			// k closest points (modified)
+
+//----------------------------------------------------------------------
+//	Distance kernels
+//		A kernel computes the distances from q to a run of m points
+//		(m <= ANN_SCAN_RUN) of a leaf with n points, starting at point
+//		j0, and stores them in dist[0..m-1].  For each point the
+//		squares are added in order of dimension, with separate
+//		multiplies and adds, so every kernel gives exactly the sums
+//		of the ordinary leaf search.
+//
+//		Since partial sums only grow, a kernel may give up as soon as
+//		all the partial sums of the run exceed the given bound.  It
+//		then returns ANNfalse and dist[] is undefined.  Otherwise it
+//		returns ANNtrue.
+//
+//		annLeafDistsPlain is the plain C++ kernel.  The vector kernels
+//		(in kd_leaf_simd.cpp) are only compiled for x86 processors and
+//		the Euclidean norm.  annLeafDists is the kernel in use, which
+//		is selected by annSimdLevel().
+//----------------------------------------------------------------------
+
+const int ANN_SCAN_RUN = 16;			// points per run
+
+typedef ANNbool (*ANNleaf_dists)(		// distance kernel
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist);			// distances (returned)
+
+ANNbool annLeafDistsPlain(				// plain C++ kernel
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist);			// distances (returned)
+
+extern ANNleaf_dists	annLeafDists;	// the kernel in use
+
+ANN_END_NAMESPACE
+
+#endif
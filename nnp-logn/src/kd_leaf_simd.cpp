@@ -0,0 +1,625 @@
+//----------------------------------------------------------------------
+// File:			kd_leaf_simd.cpp
+// Programmer:		NNP contributors
+// Description:		Vector distance kernels for leaf coordinate blocks
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//		Added bound kernels for quantized leaf codes
+//----------------------------------------------------------------------
+
+#include "kd_leaf_scan.h"				// leaf scan declarations
+#include "kd_leaf_quant.h"				// quantized leaf codes
+
+//----------------------------------------------------------------------
+//	Compiler support
+//		The vector kernels are compiled for x86 processors, and only
+//		for the Euclidean norm (see ANN_NORM_L2 in ANN.h).  Each kernel
+//		is compiled for its own instruction set (with gcc and clang by
+//		a target attribute, while Visual C++ allows any intrinsic), so
+//		the rest of the library needs no special compiler options.
+//		Which kernel is used is decided at run time, by cpuid.
+//
+//		The kernels multiply and add separately.  Fused multiply-adds
+//		would round differently from the ordinary leaf search, so the
+//		FMA instructions are never enabled.
+//----------------------------------------------------------------------
+
+#if defined(ANN_NORM_L2) && (defined(_M_IX86) || defined(_M_X64) || \
+		defined(__i386__) || defined(__x86_64__))
+	#define ANN_LEAF_SIMD					// compile vector kernels
+#endif
+
+#ifdef ANN_LEAF_SIMD
+	#ifdef _MSC_VER
+		#include <intrin.h>					// intrinsics and cpuid
+		#define ANN_TARGET(isa)
+		#if _MSC_VER >= 1910				// AVX-512 from VS 2017 on
+			#define ANN_LEAF_AVX512
+		#endif
+	#else
+		#include <cpuid.h>					// cpuid
+		#include <immintrin.h>				// intrinsics
+		#define ANN_TARGET(isa)	__attribute__((target(isa)))
+		#define ANN_LEAF_AVX512
+		#ifdef __clang__
+			#pragma STDC FP_CONTRACT OFF	// no fused multiply-adds
+		#else
+			#pragma GCC optimize ("fp-contract=off")
+		#endif
+	#endif
+#endif
+
+ANN_BEGIN_NAMESPACE
+
+#ifdef ANN_LEAF_SIMD
+
+#ifdef ANN_FLOAT_COORDS
+
+//----------------------------------------------------------------------
+//	Single precision kernels
+//		With float coordinates (see ANN_FLOAT_COORDS in ANN.h) a vector
+//		holds twice as many lanes, so the kernels below take a run in
+//		half as many vectors as the double ones that follow; with
+//		AVX-512 a whole run is one vector.  Otherwise they are the
+//		same.
+//----------------------------------------------------------------------
+
+ANN_TARGET("sse2")
+static ANNbool annLeafDistsSSE2(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__m128 acc[ANN_SCAN_RUN/4];			// partial sums
+	int full = m/4;						// number of full vectors
+	int nv = (m+3)/4;					// number of vectors
+	int used = m - 4*(nv-1);			// lanes used by last vector
+	int last = (1 << used) - 1;			// their bits
+	ANNcoord tail[4];					// the lanes of a partial vector
+	int v, i;
+
+	for (v = 0; v < ANN_SCAN_RUN/4; v++) acc[v] = _mm_setzero_ps();
+	__m128 b = _mm_set1_ps(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m128 qd = _mm_set1_ps(q[d]);
+		for (v = 0; v < full; v++) {
+			__m128 t = _mm_sub_ps(qd, _mm_loadu_ps(c + 4*v));
+			acc[v] = _mm_add_ps(acc[v], _mm_mul_ps(t, t));
+		}
+		if (full < nv) {				// points left over
+			for (i = 0; i < 4; i++) tail[i] = (i < used ? c[4*full+i] : 0);
+			__m128 t = _mm_sub_ps(qd, _mm_loadu_ps(tail));
+			acc[full] = _mm_add_ps(acc[full], _mm_mul_ps(t, t));
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			int close = 0;
+			for (v = 0; v < nv-1; v++) {
+				close |= _mm_movemask_ps(_mm_cmple_ps(acc[v], b));
+			}
+			close |= _mm_movemask_ps(_mm_cmple_ps(acc[nv-1], b)) & last;
+			if (!close) return ANNfalse;
+		}
+	}
+	for (v = 0; v < full; v++) _mm_storeu_ps(dist + 4*v, acc[v]);
+	if (full < nv) {
+		_mm_storeu_ps(tail, acc[full]);
+		for (i = 0; i < used; i++) dist[4*full+i] = tail[i];
+	}
+	return ANNtrue;
+}
+
+ANN_TARGET("avx2")
+static ANNbool annLeafDistsAVX2(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__m256 acc[ANN_SCAN_RUN/8];			// partial sums
+	int nv = (m+7)/8;					// number of vectors
+	int used = m - 8*(nv-1);			// lanes used by last vector
+	int last = (1 << used) - 1;			// their bits
+	__m256i mask = _mm256_setr_epi32(	// load mask of last vector
+			-1, used > 1 ? -1 : 0, used > 2 ? -1 : 0, used > 3 ? -1 : 0,
+			used > 4 ? -1 : 0, used > 5 ? -1 : 0, used > 6 ? -1 : 0,
+			used > 7 ? -1 : 0);
+	int v;
+
+	for (v = 0; v < ANN_SCAN_RUN/8; v++) acc[v] = _mm256_setzero_ps();
+	__m256 b = _mm256_set1_ps(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m256 qd = _mm256_set1_ps(q[d]);
+		for (v = 0; v < nv-1; v++) {
+			__m256 t = _mm256_sub_ps(qd, _mm256_loadu_ps(c + 8*v));
+			acc[v] = _mm256_add_ps(acc[v], _mm256_mul_ps(t, t));
+		}
+		__m256 t = _mm256_sub_ps(qd, _mm256_maskload_ps(c + 8*v, mask));
+		acc[v] = _mm256_add_ps(acc[v], _mm256_mul_ps(t, t));
+
+		if ((d & 3) == 3) {				// all too far already?
+			int close = 0;
+			for (v = 0; v < nv-1; v++) {
+				close |= _mm256_movemask_ps(
+						_mm256_cmp_ps(acc[v], b, _CMP_LE_OQ));
+			}
+			close |= _mm256_movemask_ps(
+					_mm256_cmp_ps(acc[v], b, _CMP_LE_OQ)) & last;
+			if (!close) return ANNfalse;
+		}
+	}
+	for (v = 0; v < nv-1; v++) _mm256_storeu_ps(dist + 8*v, acc[v]);
+	_mm256_maskstore_ps(dist + 8*v, mask, acc[v]);
+	return ANNtrue;
+}
+
+#ifdef ANN_LEAF_AVX512
+
+ANN_TARGET("avx512f")
+static ANNbool annLeafDistsAVX512(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__mmask16 k = (__mmask16) (m >= 16 ? 0xffff : (1 << m) - 1);
+	__m512 acc = _mm512_setzero_ps();	// partial sums
+	__m512 b = _mm512_set1_ps(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m512 qd = _mm512_set1_ps(q[d]);
+		__m512 t = _mm512_sub_ps(qd, _mm512_maskz_loadu_ps(k, c));
+		acc = _mm512_add_ps(acc, _mm512_mul_ps(t, t));
+		if ((d & 3) == 3) {				// all too far already?
+			if (!_mm512_mask_cmp_ps_mask(k, acc, b, _CMP_LE_OQ)) {
+				return ANNfalse;
+			}
+		}
+	}
+	_mm512_mask_storeu_ps(dist, k, acc);
+	return ANNtrue;
+}
+
+#endif // ANN_LEAF_AVX512
+
+#else // double coordinates
+
+//----------------------------------------------------------------------
+//	annLeafDistsSSE2 - SSE2 kernel
+//		The kernels hold the partial sums of the run in vectors of
+//		distances, one point per lane.  If m is not a multiple of the
+//		vector length, the last vector is only partly used; its unused
+//		lanes are loaded as zero and are ignored.  The whole array of
+//		partial sums is cleared, not just the vectors the run uses, so
+//		that the compiler can see that none is read before it is set.
+//----------------------------------------------------------------------
+
+ANN_TARGET("sse2")
+static ANNbool annLeafDistsSSE2(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__m128d acc[ANN_SCAN_RUN/2];		// partial sums
+	int full = m/2;						// number of full vectors
+	int nv = (m+1)/2;					// number of vectors
+	int last = (m & 1 ? 0x1 : 0x3);		// lanes used by last vector
+	int v;
+
+	for (v = 0; v < ANN_SCAN_RUN/2; v++) acc[v] = _mm_setzero_pd();
+	__m128d b = _mm_set1_pd(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m128d qd = _mm_set1_pd(q[d]);
+		for (v = 0; v < full; v++) {
+			__m128d t = _mm_sub_pd(qd, _mm_loadu_pd(c + 2*v));
+			acc[v] = _mm_add_pd(acc[v], _mm_mul_pd(t, t));
+		}
+		if (full < nv) {				// one point left over
+			__m128d t = _mm_sub_pd(qd, _mm_load_sd(c + 2*full));
+			acc[full] = _mm_add_pd(acc[full], _mm_mul_pd(t, t));
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			int close = 0;
+			for (v = 0; v < nv-1; v++) {
+				close |= _mm_movemask_pd(_mm_cmple_pd(acc[v], b));
+			}
+			close |= _mm_movemask_pd(_mm_cmple_pd(acc[nv-1], b)) & last;
+			if (!close) return ANNfalse;
+		}
+	}
+	for (v = 0; v < full; v++) _mm_storeu_pd(dist + 2*v, acc[v]);
+	if (full < nv) _mm_store_sd(dist + 2*full, acc[full]);
+	return ANNtrue;
+}
+
+//----------------------------------------------------------------------
+//	annLeafDistsAVX2 - AVX2 kernel
+//		The last vector is read with a masked load, so that nothing
+//		beyond the run is read.
+//----------------------------------------------------------------------
+
+ANN_TARGET("avx2")
+static ANNbool annLeafDistsAVX2(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__m256d acc[ANN_SCAN_RUN/4];		// partial sums
+	int nv = (m+3)/4;					// number of vectors
+	int used = m - 4*(nv-1);			// lanes used by last vector
+	int last = (1 << used) - 1;			// their bits
+	__m256i mask = _mm256_set_epi64x(	// load mask of last vector
+			used > 3 ? -1 : 0, used > 2 ? -1 : 0, used > 1 ? -1 : 0, -1);
+	int v;
+
+	for (v = 0; v < ANN_SCAN_RUN/4; v++) acc[v] = _mm256_setzero_pd();
+	__m256d b = _mm256_set1_pd(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m256d qd = _mm256_set1_pd(q[d]);
+		for (v = 0; v < nv-1; v++) {
+			__m256d t = _mm256_sub_pd(qd, _mm256_loadu_pd(c + 4*v));
+			acc[v] = _mm256_add_pd(acc[v], _mm256_mul_pd(t, t));
+		}
+		__m256d t = _mm256_sub_pd(qd, _mm256_maskload_pd(c + 4*v, mask));
+		acc[v] = _mm256_add_pd(acc[v], _mm256_mul_pd(t, t));
+
+		if ((d & 3) == 3) {				// all too far already?
+			int close = 0;
+			for (v = 0; v < nv-1; v++) {
+				close |= _mm256_movemask_pd(
+						_mm256_cmp_pd(acc[v], b, _CMP_LE_OQ));
+			}
+			close |= _mm256_movemask_pd(
+					_mm256_cmp_pd(acc[v], b, _CMP_LE_OQ)) & last;
+			if (!close) return ANNfalse;
+		}
+	}
+	for (v = 0; v < nv-1; v++) _mm256_storeu_pd(dist + 4*v, acc[v]);
+	_mm256_maskstore_pd(dist + 4*v, mask, acc[v]);
+	return ANNtrue;
+}
+
+#ifdef ANN_LEAF_AVX512
+
+//----------------------------------------------------------------------
+//	annLeafDistsAVX512 - AVX-512 kernel
+//		A run is at most two vectors.  Lane masks take care of the
+//		unused lanes of the last one.
+//----------------------------------------------------------------------
+
+ANN_TARGET("avx512f")
+static ANNbool annLeafDistsAVX512(
+	const ANNcoord		*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	ANNdist				bound,			// give up if all exceed this
+	ANNdist				*dist)			// distances (returned)
+{
+	__mmask8 lo = (__mmask8) (m >= 8 ? 0xff : (1 << m) - 1);
+	__mmask8 hi = (__mmask8) (m <= 8 ? 0 : (1 << (m-8)) - 1);
+	__m512d acc0 = _mm512_setzero_pd();	// partial sums
+	__m512d acc1 = _mm512_setzero_pd();
+	__m512d b = _mm512_set1_pd(bound);
+
+	for (int d = 0; d < dim; d++) {
+		const ANNcoord *c = block + d*n + j0;	// coordinate d of the run
+		__m512d qd = _mm512_set1_pd(q[d]);
+		__m512d t = _mm512_sub_pd(qd, _mm512_maskz_loadu_pd(lo, c));
+		acc0 = _mm512_add_pd(acc0, _mm512_mul_pd(t, t));
+		if (hi) {
+			t = _mm512_sub_pd(qd, _mm512_maskz_loadu_pd(hi, c + 8));
+			acc1 = _mm512_add_pd(acc1, _mm512_mul_pd(t, t));
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			if (!_mm512_mask_cmp_pd_mask(lo, acc0, b, _CMP_LE_OQ) &&
+				!_mm512_mask_cmp_pd_mask(hi, acc1, b, _CMP_LE_OQ)) {
+				return ANNfalse;
+			}
+		}
+	}
+	_mm512_mask_storeu_pd(dist, lo, acc0);
+	if (hi) _mm512_mask_storeu_pd(dist + 8, hi, acc1);
+	return ANNtrue;
+}
+
+#endif // ANN_LEAF_AVX512
+
+#endif // ANN_FLOAT_COORDS
+
+//----------------------------------------------------------------------
+//	Bound kernels
+//		The bound kernels (see kd_leaf_quant.h) widen the codes of a
+//		run to 32-bit integers, one point per lane, and compute the
+//		number of cells between each code and the cell of the query in
+//		integer arithmetic.  Only the scaling by the cell width and the
+//		sums are in floating point (in float, whatever ANNcoord is).
+//		The codes of a partial vector are first copied to a buffer, so
+//		that nothing beyond the run is read.  There is no SSE2 kernel
+//		(SSE2 lacks the widening and absolute value instructions); at
+//		that level the plain kernel is used.  The AVX-512 kernel uses
+//		the zero-masking forms of the widening, absolute value, max
+//		and conversion intrinsics, with all lanes set: the plain forms
+//		start from an undefined vector, which GCC warns may be used
+//		uninitialized.  Both compile to the same instructions.
+//----------------------------------------------------------------------
+
+ANN_TARGET("avx2")
+static inline __m256i annLoadCodesAVX2(	// load 8 codes as integers
+	const unsigned char	*c,				// the codes
+	int					size,			// bytes per code
+	int					k)				// number of codes to read
+{
+	unsigned char buf[16];				// codes of a partial vector
+	if (k < 8) {
+		memset(buf, 0, sizeof(buf));
+		memcpy(buf, c, k*size);
+		c = buf;
+	}
+	if (size == 1)
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) c));
+	else
+		return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) c));
+}
+
+ANN_TARGET("avx2")
+static ANNbool annLeafBoundsAVX2(
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	const int			*qc,			// cells of query point
+	float				bound,			// give up if all exceed this
+	float				*lb)			// lower bounds (returned)
+{
+	__m256 acc[ANN_SCAN_RUN/8];			// partial sums
+	int nv = (m+7)/8;					// number of vectors
+	int used = m - 8*(nv-1);			// lanes used by last vector
+	int last = (1 << used) - 1;			// their bits
+	int size = lq.size;					// bytes per code
+	__m256i one = _mm256_set1_epi32(1);
+	__m256i zero = _mm256_setzero_si256();
+	int v;
+
+	for (v = 0; v < ANN_SCAN_RUN/8; v++) acc[v] = _mm256_setzero_ps();
+	__m256 b = _mm256_set1_ps(bound);
+
+	for (int d = 0; d < lq.dim; d++) {
+		const unsigned char *c = block + (d*n + j0)*size;	// codes d of run
+		__m256i qd = _mm256_set1_epi32(qc[d]);
+		__m256 s = _mm256_set1_ps(lq.step[d]);
+		for (v = 0; v < nv; v++) {
+			__m256i x = annLoadCodesAVX2(c + 8*v*size, size,
+					v < nv-1 ? 8 : used);
+			__m256i g = _mm256_max_epi32(zero, _mm256_sub_epi32(
+					_mm256_abs_epi32(_mm256_sub_epi32(x, qd)), one));
+			__m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(g), s);
+			acc[v] = _mm256_add_ps(acc[v], _mm256_mul_ps(t, t));
+		}
+		if ((d & 3) == 3) {				// all too far already?
+			int close = 0;
+			for (v = 0; v < nv-1; v++) {
+				close |= _mm256_movemask_ps(
+						_mm256_cmp_ps(acc[v], b, _CMP_LE_OQ));
+			}
+			close |= _mm256_movemask_ps(
+					_mm256_cmp_ps(acc[v], b, _CMP_LE_OQ)) & last;
+			if (!close) return ANNfalse;
+		}
+	}
+	__m256i mask = _mm256_cmpgt_epi32(	// store mask of last vector
+			_mm256_set1_epi32(used), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	for (v = 0; v < nv-1; v++) _mm256_storeu_ps(lb + 8*v, acc[v]);
+	_mm256_maskstore_ps(lb + 8*v, mask, acc[v]);
+	return ANNtrue;
+}
+
+#ifdef ANN_LEAF_AVX512
+
+ANN_TARGET("avx512f")
+static ANNbool annLeafBoundsAVX512(
+	const ANNleaf_quant	&lq,			// the quantizer
+	const unsigned char	*block,			// the block
+	int					n,				// number of points in leaf
+	int					j0,				// first point of run
+	int					m,				// number of points in run
+	const int			*qc,			// cells of query point
+	float				bound,			// give up if all exceed this
+	float				*lb)			// lower bounds (returned)
+{
+	__mmask16 k = (__mmask16) (m >= 16 ? 0xffff : (1 << m) - 1);
+	__mmask16 all = (__mmask16) 0xffff;	// all lanes
+	unsigned char buf[32];				// codes of a partial vector
+	int size = lq.size;					// bytes per code
+	__m512i one = _mm512_set1_epi32(1);
+	__m512i zero = _mm512_setzero_si512();
+	__m512 acc = _mm512_setzero_ps();	// partial sums
+	__m512 b = _mm512_set1_ps(bound);
+
+	if (m < 16) memset(buf, 0, sizeof(buf));
+	for (int d = 0; d < lq.dim; d++) {
+		const unsigned char *c = block + (d*n + j0)*size;	// codes d of run
+		if (m < 16) {
+			memcpy(buf, c, m*size);
+			c = buf;
+		}
+		__m512i x = (size == 1 ?
+				_mm512_maskz_cvtepu8_epi32(all,
+					_mm_loadu_si128((const __m128i *) c)) :
+				_mm512_maskz_cvtepu16_epi32(all,
+					_mm256_loadu_si256((const __m256i *) c)));
+		__m512i g = _mm512_maskz_max_epi32(all, zero, _mm512_sub_epi32(
+				_mm512_maskz_abs_epi32(all,
+					_mm512_sub_epi32(x, _mm512_set1_epi32(qc[d]))),
+				one));
+		__m512 t = _mm512_mul_ps(_mm512_maskz_cvtepi32_ps(all, g),
+				_mm512_set1_ps(lq.step[d]));
+		acc = _mm512_add_ps(acc, _mm512_mul_ps(t, t));
+		if ((d & 3) == 3) {				// all too far already?
+			if (!_mm512_mask_cmp_ps_mask(k, acc, b, _CMP_LE_OQ)) {
+				return ANNfalse;
+			}
+		}
+	}
+	_mm512_mask_storeu_ps(lb, k, acc);
+	return ANNtrue;
+}
+
+#endif // ANN_LEAF_AVX512
+
+//----------------------------------------------------------------------
+//	annCpuLevel - highest level supported by the processor
+//		AVX and AVX-512 also need the operating system to save the
+//		vector registers, which is checked through xgetbv.
+//----------------------------------------------------------------------
+
+static void annCpuid(					// execute cpuid
+	unsigned			leaf,			// leaf
+	unsigned			*r)				// eax, ebx, ecx, edx (returned)
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuidex(info, (int) leaf, 0);
+	for (int i = 0; i < 4; i++) r[i] = (unsigned) info[i];
+#else
+	__cpuid_count(leaf, 0, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+static unsigned annXgetbv()				// enabled register state
+{
+#ifdef _MSC_VER
+	return (unsigned) _xgetbv(0);
+#else
+	unsigned lo, hi;
+	__asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+	return lo;
+#endif
+}
+
+static ANNsimdLevel annCpuLevel()
+{
+	unsigned r[4];
+
+	annCpuid(0, r);
+	unsigned max_leaf = r[0];
+	if (max_leaf < 1) return ANN_SIMD_NONE;
+
+	annCpuid(1, r);
+	if (!(r[3] & (1u << 26))) return ANN_SIMD_NONE;	// no SSE2
+	if (max_leaf < 7 ||
+		!(r[2] & (1u << 27)) ||			// no xgetbv
+		!(r[2] & (1u << 28))) {			// or no AVX
+			return ANN_SIMD_SSE2;
+	}
+	unsigned xcr0 = annXgetbv();
+	if ((xcr0 & 0x06) != 0x06) return ANN_SIMD_SSE2;	// no AVX state
+
+	annCpuid(7, r);
+	if (!(r[1] & (1u << 5))) return ANN_SIMD_SSE2;		// no AVX2
+	if (!(r[1] & (1u << 16)) ||			// no AVX-512F
+		(xcr0 & 0xe6) != 0xe6) {		// or no AVX-512 state
+			return ANN_SIMD_AVX2;
+	}
+	return ANN_SIMD_AVX512;
+}
+
+#endif // ANN_LEAF_SIMD
+
+//----------------------------------------------------------------------
+//	annSimdLevel - limit the vector instructions used
+//		The kernel is first selected when the library is loaded.
+//		Until then (for example, in constructors of other static
+//		objects) the plain kernel is used.
+//----------------------------------------------------------------------
+
+ANNleaf_dists annLeafDists = annLeafDistsPlain;	// the kernel in use
+ANNleaf_bounds annLeafBounds = annLeafBoundsPlain;	// the bound kernel in use
+
+ANNsimdLevel annSimdLevel(				// limit vector instructions used
+	ANNsimdLevel		max_level)		// highest level to use
+{
+#ifdef ANN_LEAF_SIMD
+	ANNsimdLevel level = annCpuLevel();
+	#ifndef ANN_LEAF_AVX512
+	if (level > ANN_SIMD_AVX2) level = ANN_SIMD_AVX2;
+	#endif
+	if (level > max_level) level = max_level;
+
+	switch (level) {
+	#ifdef ANN_LEAF_AVX512
+	case ANN_SIMD_AVX512:
+		annLeafDists = annLeafDistsAVX512;
+		annLeafBounds = annLeafBoundsAVX512;
+		break;
+	#endif
+	case ANN_SIMD_AVX2:
+		annLeafDists = annLeafDistsAVX2;
+		annLeafBounds = annLeafBoundsAVX2;
+		break;
+	case ANN_SIMD_SSE2:
+		annLeafDists = annLeafDistsSSE2;
+		annLeafBounds = annLeafBoundsPlain;
+		break;
+	default:
+		level = ANN_SIMD_NONE;
+		annLeafDists = annLeafDistsPlain;
+		annLeafBounds = annLeafBoundsPlain;
+		break;
+	}
+	return level;
+#else
+	return ANN_SIMD_NONE;				// no vector kernels
+#endif
+}
+
+static ANNsimdLevel annInitLevel = annSimdLevel(ANN_SIMD_AVX512);
+
+ANN_END_NAMESPACE
@@ -0,0 +1,415 @@
+//----------------------------------------------------------------------
+// File:			kd_par_build.cpp
+// Programmer:		NNP contributors
+// Description:		Parallel construction of kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "kd_par_build.h"				// parallel construction
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	The pool of the current build
+//----------------------------------------------------------------------
+
+static ANN_THREAD_LOCAL ANNthread_pool *ANNcurBuildPool = NULL;
+
+ANNthread_pool *annBuildPool()			// pool of current build (or NULL)
+{
+	return ANNcurBuildPool;
+}
+
+ANNthread_pool *annBuildPoolFor(		// pool to build a tree with
+	int					n)				// number of points
+{
+	int n_threads = (ANNbuildThreads > 0 ? ANNbuildThreads
+										 : annHardwareThreads());
+	if (n_threads <= 1 || n < ANN_PAR_SUBTREE) {
+		return NULL;					// not worth it
+	}
+	return annThreadPool(n_threads);
+}
+
+ANNbuild_scope::ANNbuild_scope(ANNthread_pool *pool)
+{
+	saved = ANNcurBuildPool;
+	ANNcurBuildPool = pool;
+}
+
+ANNbuild_scope::~ANNbuild_scope()
+{
+	ANNcurBuildPool = saved;
+}
+
+//----------------------------------------------------------------------
+//	Chunks
+//		A parallel scan divides pidx[0..n-1] into chunks of
+//		ANN_PAR_GRAIN points, the last one possibly shorter, and
+//		processes the chunks in parallel.
+//----------------------------------------------------------------------
+
+static int annNumChunks(int n)			// number of chunks
+{
+	return (n + ANN_PAR_GRAIN - 1) / ANN_PAR_GRAIN;
+}
+
+static void annChunk(					// bounds of a chunk
+	int					k,				// chunk number
+	int					n,				// number of points
+	int					&i0,			// first point (returned)
+	int					&i1)			// last point + 1 (returned)
+{
+	i0 = k * ANN_PAR_GRAIN;
+	i1 = (n - i0 < ANN_PAR_GRAIN ? n : i0 + ANN_PAR_GRAIN);
+}
+
+//----------------------------------------------------------------------
+//	annParBounds - min and max along dimensions d0..d0+nd-1
+//		Each chunk computes its own min and max, which are then
+//		combined.  The results are exactly those of a serial scan.
+//----------------------------------------------------------------------
+
+class ANNbounds_body : public ANNrange_body {
+public:
+	ANNpointArray		pa;				// point array
+	ANNidxArray			pidx;			// point indices
+	int					n;				// number of points
+	int					d0;				// first dimension
+	int					nd;				// number of dimensions
+	ANNcoord			*lo;			// min of chunk k is lo[k*nd...]
+	ANNcoord			*hi;			// max of chunk k is hi[k*nd...]
+
+	void run(int c0, int c1)
+	{
+		for (int k = c0; k < c1; k++) {
+			int i0, i1;
+			annChunk(k, n, i0, i1);
+			ANNcoord *l = lo + k*nd;
+			ANNcoord *h = hi + k*nd;
+			int j;
+			for (j = 0; j < nd; j++) {
+				l[j] = h[j] = pa[pidx[i0]][d0 + j];
+			}
+			for (int i = i0 + 1; i < i1; i++) {
+				ANNpoint p = pa[pidx[i]] + d0;
+				for (j = 0; j < nd; j++) {
+					if (p[j] < l[j]) l[j] = p[j];
+					else if (p[j] > h[j]) h[j] = p[j];
+				}
+			}
+		}
+	}
+};
+
+static void annParBounds(				// min and max along dimensions
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d0,				// first dimension
+	int					nd,				// number of dimensions
+	ANNcoord			*min,			// minima (returned)
+	ANNcoord			*max)			// maxima (returned)
+{
+	int n_chunks = annNumChunks(n);
+	ANNbounds_body body;
+	body.pa = pa;
+	body.pidx = pidx;
+	body.n = n;
+	body.d0 = d0;
+	body.nd = nd;
+	body.lo = new ANNcoord[n_chunks * nd];
+	body.hi = new ANNcoord[n_chunks * nd];
+
+	annParallelFor(pool, 0, n_chunks, 1, body);
+
+	for (int j = 0; j < nd; j++) {		// combine the chunks
+		min[j] = body.lo[j];
+		max[j] = body.hi[j];
+		for (int k = 1; k < n_chunks; k++) {
+			if (body.lo[k*nd + j] < min[j]) min[j] = body.lo[k*nd + j];
+			if (body.hi[k*nd + j] > max[j]) max[j] = body.hi[k*nd + j];
+		}
+	}
+	delete [] body.lo;
+	delete [] body.hi;
+}
+
+//----------------------------------------------------------------------
+//	annParEnclRect, annParMinMax
+//----------------------------------------------------------------------
+
+void annParEnclRect(					// smallest enclosing rectangle
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension
+	ANNorthRect			&bnds)			// bounding cube (returned)
+{
+	annParBounds(pool, pa, pidx, n, 0, dim, bnds.lo, bnds.hi);
+}
+
+void annParMinMax(						// min and max along a dimension
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension to check
+	ANNcoord			&min,			// minimum value (returned)
+	ANNcoord			&max)			// maximum value (returned)
+{
+	annParBounds(pool, pa, pidx, n, d, 1, &min, &max);
+}
+
+//----------------------------------------------------------------------
+//	annParPartition - partition points in parallel
+//		Permutes pidx[0..n-1] so that the points for which the given
+//		predicate holds come first, and returns their number, br.
+//		The permutation is the one made by the serial two-pointer
+//		partition (see annPlaneSplit in kd_util.cpp).
+//
+//		This is done in four steps.  (1) Each chunk evaluates the
+//		predicate on its points, saving the results as flags, and
+//		counts them.  This gives br.  (2) For each chunk, we count the
+//		misplaced points in it: those to the left of br whose flag is
+//		off and those to the right of br whose flag is on.  (3) Each
+//		chunk lists the positions of its misplaced points, in array A
+//		(those on the left, from left to right) and array B (those on
+//		the right, from right to left), at offsets computed from the
+//		counts of step (2).  (4) A[i] and B[i] are swapped, for all i.
+//		The serial partition makes exactly these swaps.
+//----------------------------------------------------------------------
+
+class ANNsplit_pred {					// which side a point belongs on
+public:
+	virtual ~ANNsplit_pred() {}			// virtual destructor
+	virtual ANNbool left(ANNidx i) = 0;	// does point i go on the left?
+};
+
+class ANNflag_body : public ANNrange_body {
+public:
+	ANNsplit_pred		*pred;			// the predicate
+	ANNidxArray			pidx;			// point indices
+	int					n;				// number of points
+	unsigned char		*flag;			// flags (returned)
+	int					*cnt;			// flags set per chunk (returned)
+
+	void run(int c0, int c1)
+	{
+		for (int k = c0; k < c1; k++) {
+			int i0, i1;
+			annChunk(k, n, i0, i1);
+			int c = 0;
+			for (int i = i0; i < i1; i++) {
+				flag[i] = (unsigned char) pred->left(pidx[i]);
+				c += flag[i];
+			}
+			cnt[k] = c;
+		}
+	}
+};
+
+class ANNgather_body : public ANNrange_body {
+public:
+	const unsigned char	*flag;			// the flags
+	int					n;				// number of points
+	int					br;				// the break
+	const int			*off_l;			// offsets into A per chunk
+	const int			*off_r;			// offsets into B per chunk
+	int					*A;				// misplaced on left (returned)
+	int					*B;				// misplaced on right (returned)
+
+	void run(int c0, int c1)
+	{
+		for (int k = c0; k < c1; k++) {
+			int i0, i1, i;
+			annChunk(k, n, i0, i1);
+			int a = off_l[k];
+			for (i = i0; i < i1 && i < br; i++) {
+				if (!flag[i]) A[a++] = i;
+			}
+			int b = off_r[k];
+			for (i = i1 - 1; i >= i0 && i >= br; i--) {
+				if (flag[i]) B[b++] = i;
+			}
+		}
+	}
+};
+
+class ANNswap_body : public ANNrange_body {
+public:
+	ANNidxArray			pidx;			// point indices
+	const int			*A;				// positions on the left
+	const int			*B;				// positions on the right
+
+	void run(int lo, int hi)
+	{
+		for (int i = lo; i < hi; i++) {
+			ANNidx tmp = pidx[A[i]];
+			pidx[A[i]] = pidx[B[i]];
+			pidx[B[i]] = tmp;
+		}
+	}
+};
+
+static int annParPartition(				// partition points in parallel
+	ANNthread_pool		*pool,			// the pool
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	ANNsplit_pred		&pred)			// the predicate
+{
+	int n_chunks = annNumChunks(n);
+	int k, i;
+										// (1) flags and counts
+	unsigned char *flag = new unsigned char[n > 0 ? n : 1];
+	int *cnt = new int[n_chunks + 1];
+	ANNflag_body fb;
+	fb.pred = &pred;
+	fb.pidx = pidx;
+	fb.n = n;
+	fb.flag = flag;
+	fb.cnt = cnt;
+	annParallelFor(pool, 0, n_chunks, 1, fb);
+
+	int br = 0;
+	for (k = 0; k < n_chunks; k++) br += cnt[k];
+
+										// (2) misplaced points per chunk
+	int *off_l = new int[n_chunks + 1];
+	int *off_r = new int[n_chunks + 1];
+	int n_mis = 0;						// number of misplaced pairs
+	for (k = 0; k < n_chunks; k++) {
+		int i0, i1;
+		annChunk(k, n, i0, i1);
+		off_l[k] = n_mis;
+		if (i1 <= br) {					// chunk is left of the break
+			n_mis += (i1 - i0) - cnt[k];
+		}
+		else if (i0 < br) {				// chunk contains the break
+			for (i = i0; i < br; i++) {
+				if (!flag[i]) n_mis++;
+			}
+		}
+	}
+	int n_right = 0;
+	for (k = n_chunks - 1; k >= 0; k--) {
+		int i0, i1;
+		annChunk(k, n, i0, i1);
+		off_r[k] = n_right;
+		if (i0 >= br) {					// chunk is right of the break
+			n_right += cnt[k];
+		}
+		else if (i1 > br) {				// chunk contains the break
+			for (i = br; i < i1; i++) {
+				if (flag[i]) n_right++;
+			}
+		}
+	}									// (now n_right == n_mis)
+
+	if (n_mis > 0) {					// (3) list misplaced points
+		int *A = new int[n_mis];
+		int *B = new int[n_mis];
+		ANNgather_body gb;
+		gb.flag = flag;
+		gb.n = n;
+		gb.br = br;
+		gb.off_l = off_l;
+		gb.off_r = off_r;
+		gb.A = A;
+		gb.B = B;
+		annParallelFor(pool, 0, n_chunks, 1, gb);
+
+		ANNswap_body sb;				// (4) swap them
+		sb.pidx = pidx;
+		sb.A = A;
+		sb.B = B;
+		annParallelFor(pool, 0, n_mis, ANN_PAR_GRAIN, sb);
+
+		delete [] A;
+		delete [] B;
+	}
+	delete [] flag;
+	delete [] cnt;
+	delete [] off_l;
+	delete [] off_r;
+	return br;
+}
+
+//----------------------------------------------------------------------
+//	annParPlaneSplit, annParBoxSplit
+//----------------------------------------------------------------------
+
+class ANNplane_pred : public ANNsplit_pred {
+public:
+	ANNpointArray		pa;				// point array
+	int					d;				// cutting dimension
+	ANNcoord			cv;				// cutting value
+	ANNbool				strict;			// < cv (or <= cv)?
+
+	ANNbool left(ANNidx i)
+	{
+		return (ANNbool) (strict ? pa[i][d] < cv : pa[i][d] <= cv);
+	}
+};
+
+class ANNbox_pred : public ANNsplit_pred {
+public:
+	ANNpointArray		pa;				// point array
+	int					dim;			// dimension of space
+	ANNorthRect			*box;			// the box
+
+	ANNbool left(ANNidx i)
+	{
+		return box->inside(dim, pa[i]);
+	}
+};
+
+int annParPlaneSplit(					// partition about a plane
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension along which to split
+	ANNcoord			cv,				// cutting value
+	ANNbool				strict)			// left side is < cv (or <= cv)?
+{
+	ANNplane_pred pred;
+	pred.pa = pa;
+	pred.d = d;
+	pred.cv = cv;
+	pred.strict = strict;
+	return annParPartition(pool, pidx, n, pred);
+}
+
+int annParBoxSplit(						// partition about a box
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension of space
+	ANNorthRect			&box)			// the box
+{
+	ANNbox_pred pred;
+	pred.pa = pa;
+	pred.dim = dim;
+	pred.box = &box;
+	return annParPartition(pool, pidx, n, pred);
+}
+
+ANN_END_NAMESPACE
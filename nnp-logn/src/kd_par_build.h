@@ -0,0 +1,120 @@
+//----------------------------------------------------------------------
+// File:			kd_par_build.h
+// Programmer:		NNP contributors
+// Description:		Parallel construction of kd- and bd-trees
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_kd_par_build_H
+#define ANN_kd_par_build_H
+
+#include "kd_tree.h"					// kd-tree declarations
+#include "thread_pool.h"				// thread pool
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Parallel construction
+//		A tree is built in parallel in two ways.  First, once the
+//		points of a node have been partitioned, rkd_tree() and
+//		rbd_tree() build the low (or inner) subtree as a task of the
+//		thread pool, while building the other subtree themselves.
+//		This is only done if both subtrees have at least
+//		ANN_PAR_SUBTREE points.
+//
+//		Second, near the root, where there are still few subtrees to
+//		go around, the scans of the points made by the splitting
+//		routines (annEnclRect, annSpread and annMinMax) and the
+//		partitions (annPlaneSplit and annBoxSplit) are themselves
+//		done in parallel, in chunks of ANN_PAR_GRAIN points.  This is
+//		done for arrays of at least ANN_PAR_SCAN points.
+//
+//		The parallel partition gives exactly the permutation of the
+//		serial one.  The serial partition swaps the i-th point (from
+//		the left) that is on the wrong side of the break with the i-th
+//		(from the right) on the wrong side of it; since the break is
+//		just the number of points that belong on the left, these pairs
+//		can be found in parallel by counting, and then swapped in
+//		parallel.  The median selection of annMedianSplit is left
+//		serial, as its permutation depends on the order of its swaps.
+//		So the tree (and its point index array) is exactly the one
+//		built by a single thread.
+//
+//		The pool in use is kept per thread, and is set for the
+//		duration of a build (or of a subtree task) by declaring an
+//		ANNbuild_scope.  If it is NULL, everything is serial.
+//----------------------------------------------------------------------
+
+const int ANN_PAR_SUBTREE	= 1 << 14;	// min points of a subtree task
+const int ANN_PAR_SCAN		= 1 << 16;	// min points of a parallel scan
+const int ANN_PAR_GRAIN		= 1 << 14;	// points per chunk of a scan
+
+ANNthread_pool *annBuildPool();			// pool of current build (or NULL)
+
+ANNthread_pool *annBuildPoolFor(		// pool to build a tree with
+	int					n);				// number of points
+
+class ANNbuild_scope {					// sets the pool of a build
+	ANNthread_pool		*saved;			// the previous pool
+public:
+	ANNbuild_scope(ANNthread_pool *pool);	// constructor
+	~ANNbuild_scope();					// destructor (restore)
+};
+
+//----------------------------------------------------------------------
+//	Parallel scans and partitions
+//		These are the parallel versions of the utilities of the same
+//		names in kd_util.cpp, which call them for large arrays.
+//----------------------------------------------------------------------
+
+void annParEnclRect(					// smallest enclosing rectangle
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension
+	ANNorthRect			&bnds);			// bounding cube (returned)
+
+void annParMinMax(						// min and max along a dimension
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension to check
+	ANNcoord			&min,			// minimum value (returned)
+	ANNcoord			&max);			// maximum value (returned)
+
+int annParPlaneSplit(					// partition about a plane
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension along which to split
+	ANNcoord			cv,				// cutting value
+	ANNbool				strict);		// left side is < cv (or <= cv)?
+
+int annParBoxSplit(						// partition about a box
+	ANNthread_pool		*pool,			// the pool
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension of space
+	ANNorthRect			&box);			// the box
+
+ANN_END_NAMESPACE
+
+#endif
@@ -20,10 +20,17 @@
 // History:
 //	Revision 0.1  03/04/98
 //		Initial release
+//	Revision 1.2
+//		Search state passed in an ANNkd_search_ctx instead of globals
+//		Leaves with coordinate blocks are scanned by annScanLeafCoords
+//		Leaves with code blocks are scanned by annScanLeafCodes
+//		Queues are borrowed from the thread's search workspace
 //----------------------------------------------------------------------
 
 #include "kd_pr_search.h"				// kd priority search declarations
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Approximate nearest neighbor searching by priority search.
 //		The kd-tree is searched for an approximate nearest neighbor.
@@ -67,19 +74,11 @@
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
-//		To keep argument lists short, a number of global variables
-//		are maintained which are common to all the recursive calls.
-//		These are given below.
+//		The state which is common to all the recursive calls is kept
+//		in a search context (ANNkd_search_ctx), which is set up by
+//		annkPriSearch() and passed by reference to every call.
 //----------------------------------------------------------------------
 
-double			ANNprEps;				// the error bound
-int				ANNprDim;				// dimension of space
-ANNpoint		ANNprQ;					// query point
-double			ANNprMaxErr;			// max tolerable squared error
-ANNpointArray	ANNprPts;				// the points
-ANNpr_queue		*ANNprBoxPQ;			// priority queue for boxes
-ANNmink		*ANNprPointMK;			// set of k closest points
-
 //----------------------------------------------------------------------
 //	annkPriSearch - priority search for k nearest neighbors
 //----------------------------------------------------------------------
@@ -91,59 +90,55 @@ void ANNkd_tree::annkPriSearch(
 	ANNdistArray		dd,				// dist to near neighbors (returned)
 	double				eps)			// error bound (ignored)
 {
-										// max tolerable squared error
-	ANNprMaxErr = ANN_POW(1.0 + eps);
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
 	ANN_FLOP(2)							// increment floating ops
 
-	ANNprDim = dim;						// copy arguments to static equivs
-	ANNprQ = q;
-	ANNprPts = pts;
-	ANNptsVisited = 0;					// initialize count of points visited
-
-	ANNprPointMK = new ANNmink(k);		// create set for closest k points
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	if (leaf_quant != NULL)				// quantize the query point
+		ctx.set_quant(leaf_quant, ws->query_codes(dim));
+	ctx.point_mk = &point_mk;
 
 										// distance to root box
 	ANNdist box_dist = annBoxDistance(q,
 				bnd_box_lo, bnd_box_hi, dim);
 
-	ANNprBoxPQ = new ANNpr_queue(n_pts);// create priority queue for boxes
-	ANNprBoxPQ->insert(box_dist, root); // insert root in priority queue
+	ANNpr_queue &box_pq = ws->box_queue();	// queue for boxes
+	ctx.box_pq = &box_pq;
+	box_pq.insert(box_dist, root);		// insert root in priority queue
 
-	while (ANNprBoxPQ->non_empty() &&
-		(!(ANNmaxPtsVisited != 0 && ANNptsVisited > ANNmaxPtsVisited))) {
+	while (box_pq.non_empty() && !ctx.visit_limit()) {
 		ANNkd_ptr np;					// next box from prior queue
 
 										// extract closest box from queue
-		ANNprBoxPQ->extr_min(box_dist, (void *&) np);
+		box_pq.extr_min(box_dist, (void *&) np);
 
 		ANN_FLOP(2)						// increment floating ops
-		if (box_dist*ANNprMaxErr >= ANNprPointMK->maxkey())
+		if (box_dist*ctx.max_err >= point_mk.maxkey())
 			break;
 
-		np->ann_pri_search(box_dist);	// search this subtree.
+		np->ann_pri_search(box_dist, ctx);// search this subtree.
 	}
 
 	for (int i = 0; i < k; i++) {		// extract the k-th closest points
-		dd[i] = ANNprPointMK->ith_smallestkey(i);
-		nn_idx[i] = ANNprPointMK->ith_smallest_info(i);
+		dd[i] = point_mk.ith_smallestkey(i);
+		nn_idx[i] = point_mk.ith_smallest_info(i);
 	}
-
-	delete ANNprPointMK;				// deallocate closest point set
-	delete ANNprBoxPQ;					// deallocate priority queue
 }
 
 //----------------------------------------------------------------------
 //	kd_split::ann_pri_search - search a splitting node
 //----------------------------------------------------------------------
 
-void ANNkd_split::ann_pri_search(ANNdist box_dist)
+void ANNkd_split::ann_pri_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 	ANNdist new_dist;					// distance to child visited later
 										// distance to cutting plane
-	ANNcoord cut_diff = ANNprQ[cut_dim] - cut_val;
+	ANNcoord cut_diff = ctx.q[cut_dim] - cut_val;
 
 	if (cut_diff < 0) {					// left of cutting plane
-		ANNcoord box_diff = cd_bnds[ANN_LO] - ANNprQ[cut_dim];
+		ANNcoord box_diff = cd_bnds[ANN_LO] - ctx.q[cut_dim];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -151,12 +146,12 @@ void ANNkd_split::ann_pri_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 		if (child[ANN_HI] != KD_TRIVIAL)// enqueue if not trivial
-			ANNprBoxPQ->insert(new_dist, child[ANN_HI]);
+			ctx.box_pq->insert(new_dist, child[ANN_HI]);
 										// continue with closer child
-		child[ANN_LO]->ann_pri_search(box_dist);
+		child[ANN_LO]->ann_pri_search(box_dist, ctx);
 	}
 	else {								// right of cutting plane
-		ANNcoord box_diff = ANNprQ[cut_dim] - cd_bnds[ANN_HI];
+		ANNcoord box_diff = ctx.q[cut_dim] - cd_bnds[ANN_HI];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -164,9 +159,9 @@ void ANNkd_split::ann_pri_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 		if (child[ANN_LO] != KD_TRIVIAL)// enqueue if not trivial
-			ANNprBoxPQ->insert(new_dist, child[ANN_LO]);
+			ctx.box_pq->insert(new_dist, child[ANN_LO]);
 										// continue with closer child
-		child[ANN_HI]->ann_pri_search(box_dist);
+		child[ANN_HI]->ann_pri_search(box_dist, ctx);
 	}
 	ANN_SPL(1)							// one more splitting node visited
 	ANN_FLOP(8)							// increment floating ops
@@ -178,7 +173,7 @@ void ANNkd_split::ann_pri_search(ANNdist box_dist)
 //		This is virtually identical to the ann_search for standard search.
 //----------------------------------------------------------------------
 
-void ANNkd_leaf::ann_pri_search(ANNdist box_dist)
+void ANNkd_leaf::ann_pri_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 	register ANNdist dist;				// distance to data point
 	register ANNcoord* pp;				// data coordinate pointer
@@ -187,15 +182,36 @@ void ANNkd_leaf::ann_pri_search(ANNdist box_dist)
 	register ANNcoord t;
 	register int d;
 
-	min_dist = ANNprPointMK->maxkey(); // k-th smallest distance so far
+	if (codes != NULL) {				// scan the code block
+		annScanLeafCodes(*ctx.quant, codes, bkt, n_pts, ctx.pts, ctx.q,
+				ctx.q_code, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+	if (coords != NULL) {				// scan the coordinate block
+		annScanLeafCoords(coords, bkt, n_pts, ctx.dim, ctx.q, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+
+	ANNpointArray	pts = ctx.pts;		// the points
+	ANNpoint		q   = ctx.q;		// the query point
+	int				dim = ctx.dim;		// dimension of space
+	ANNmink			*point_mk = ctx.point_mk;// set of k closest points
+
+	min_dist = point_mk->maxkey();		// k-th smallest distance so far
 
 	for (int i = 0; i < n_pts; i++) {	// check points in bucket
 
-		pp = ANNprPts[bkt[i]];			// first coord of next data point
-		qq = ANNprQ;					// first coord of query point
+		pp = pts[bkt[i]];				// first coord of next data point
+		qq = q;							// first coord of query point
 		dist = 0;
 
-		for(d = 0; d < ANNprDim; d++) {
+		for(d = 0; d < dim; d++) {
 			ANN_COORD(1)				// one more coordinate hit
 			ANN_FLOP(4)					// increment floating ops
 
@@ -206,14 +222,16 @@ void ANNkd_leaf::ann_pri_search(ANNdist box_dist)
 			}
 		}
 
-		if (d >= ANNprDim &&					// among the k best?
+		if (d >= dim &&							// among the k best?
 		   (ANN_ALLOW_SELF_MATCH || dist!=0)) { // and no self-match problem
 												// add it to the list
-			ANNprPointMK->insert(dist, bkt[i]);
-			min_dist = ANNprPointMK->maxkey();
+			point_mk->insert(dist, bkt[i]);
+			min_dist = point_mk->maxkey();
 		}
 	}
 	ANN_LEAF(1)							// one more leaf node visited
 	ANN_PTS(n_pts)						// increment points visited
-	ANNptsVisited += n_pts;				// increment number of points visited
+	ctx.pts_visited += n_pts;			// increment number of points visited
 }
+
+ANN_END_NAMESPACE
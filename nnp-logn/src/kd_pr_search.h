@@ -20,6 +20,8 @@
 // History:
 //	Revision 0.1  03/04/98
 //		Initial release
+//	Revision 1.2
+//		Removed search globals (see ANNkd_search_ctx in kd_tree.h)
 //----------------------------------------------------------------------
 
 #ifndef ANNkd_pr_search_H
@@ -27,23 +29,12 @@
 
 #include "kd_tree.h"					// kd-tree declarations
 #include "kd_util.h"					// kd-tree utilities
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "kd_leaf_quant.h"				// quantized leaf codes
+#include "search_space.h"				// search workspaces
 #include "pr_queue.h"					// priority queue declarations
 #include "pr_queue_k.h"					// k-element priority queue
 
 #include <ANN/ANNperf.h>				// performance evaluation
 
-//----------------------------------------------------------------------
-//	Global variables
-//		Active for the life of each call to Appx_Near_Neigh() or
-//		Appxk_Near_Neigh().
-//----------------------------------------------------------------------
-
-extern double			ANNprEps;		// the error bound
-extern int				ANNprDim;		// dimension of space
-extern ANNpoint			ANNprQ;			// query point
-extern double			ANNprMaxErr;	// max tolerable squared error
-extern ANNpointArray	ANNprPts;		// the points
-extern ANNpr_queue		*ANNprBoxPQ;	// priority queue for boxes
-extern ANNmink			*ANNprPointMK;	// set of k closest points
-
 #endif
@@ -0,0 +1,496 @@
+//----------------------------------------------------------------------
+// File:			kd_presort.cpp
+// Programmer:		NNP contributors
+// Description:		Construction of kd-trees from presorted points
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include <algorithm>					// sort
+#include <utility>						// pair
+#include <vector>						// sorted orders and paths
+
+#include "kd_tree.h"					// kd-tree declarations
+#include "kd_par_build.h"				// parallel construction
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Presorted construction
+//		rkd_tree() finds each split by scanning and partitioning all
+//		the points of the node, so the time it takes depends on the
+//		depth of the tree (which for the sliding midpoint rule may be
+//		linear in n) and on the pivots of the median selection.
+//		presort_kd_tree() builds the trees of the kd and sliding
+//		midpoint rules in O(dn log n) time in the worst case.
+//
+//		The points are sorted once along each dimension (by their
+//		coordinate, and then by index, so that duplicates have a
+//		fixed order).  The points of a node are kept in a range of
+//		positions, the same in each of the dim sorted orders, which
+//		is the range of pidx that they occupy in the tree.
+//
+//		The tree is built in rounds.  A round at a node of n points
+//		follows the path from the node towards its larger child,
+//		splitting off the smaller side at each step, until at most
+//		half of the n points (rounded up) are left.  Each step takes
+//		O(d) time plus the number of positions passed over on the
+//		side split off.  The spreads are given by the first and last
+//		points of each order that are still on the path, the cutting
+//		value of the sliding midpoint rule is located by a binary
+//		search in the order of the cutting dimension, the points on
+//		either side of it are counted from the nearer end, and the
+//		points split off are marked from their end of the order.
+//		At the end of the round, the orders are distributed stably
+//		among the sides split off (and what is left) in one pass, and
+//		each of these is built by a round of its own.  Since each has
+//		at most half of the points, every point goes through O(log n)
+//		rounds, at O(d) time per point per round.
+//
+//		The splits are those of kd_split() and sl_midpt_split() with
+//		exact spreads and medians (annBuildSample() does not apply).
+//		Points lying on a cutting plane are divided between its sides
+//		by index, which may differ from the division made by
+//		annPlaneSplit(), so trees of points with equal coordinates
+//		may differ from those of rkd_tree().  Otherwise they are the
+//		same.
+//
+//		The recursion is only O(log n) deep, however deep the tree.
+//		The sorts and (for large rounds) the distributions are done
+//		one dimension per task of the build's thread pool, and large
+//		sides are built by tasks as in rkd_tree().  The sorted orders
+//		take dim*n indices of memory.
+//----------------------------------------------------------------------
+
+const double PS_ERR = 0.001;			// a small value (see sl_midpt_split)
+
+class ANNpresort_build {				// state of a presorted build
+public:
+	ANNpointArray		pa;				// point array
+	ANNidxArray			pidx;			// point indices of the tree
+	int					n_pts;			// number of points
+	int					dim;			// dimension of space
+	int					bsp;			// bucket space
+	ANNbool				sl_midpt;		// sliding midpoint (or kd) rule?
+	std::vector<ANNidx>	ord;			// order along d is ord[d*n_pts...]
+	std::vector<int>	side;			// side of a point in its round
+
+	ANNidx *order(int d)				// order along dimension d
+		{ return &ord[(size_t) d * n_pts]; }
+
+	ANNkd_ptr build(					// build the tree of a range
+		int				a,				// first position
+		int				b,				// last position + 1
+		ANNorthRect		&bnd_box);		// bounding box
+};
+
+//----------------------------------------------------------------------
+//	Sorting and distribution
+//		The sorts and distributions are independent from one dimension
+//		to the next, so each dimension is a unit of annParallelFor.
+//		A distribution moves the points of positions [a,b) of each
+//		order to the ranges of their sides (side[]), keeping them in
+//		order within each side.
+//----------------------------------------------------------------------
+
+class ANNpresort_sort_body : public ANNrange_body {
+public:
+	ANNpresort_build	*pb;			// the build
+
+	void run(int d0, int d1)
+	{
+		int n = pb->n_pts;				// sort (coordinate, index) pairs
+		std::vector<std::pair<ANNcoord, ANNidx> > key(n);
+		for (int d = d0; d < d1; d++) {
+			for (int i = 0; i < n; i++) {
+				ANNidx p = pb->pidx[i];
+				key[i] = std::make_pair(pb->pa[p][d], p);
+			}
+			std::sort(key.begin(), key.end());
+			ANNidx *o = pb->order(d);
+			for (int i = 0; i < n; i++) {
+				o[i] = key[i].second;
+			}
+		}
+	}
+};
+
+class ANNpresort_dist_body : public ANNrange_body {
+public:
+	ANNpresort_build	*pb;			// the build
+	int					a, b;			// the positions
+	const std::vector<int> *start;		// first position of each side
+
+	void run(int d0, int d1)
+	{
+		std::vector<ANNidx> tmp(b - a);	// distributed order
+		std::vector<int> next;			// next position of each side
+		for (int d = d0; d < d1; d++) {
+			ANNidx *o = pb->order(d);
+			next = *start;
+			for (int i = a; i < b; i++) {
+				tmp[next[pb->side[o[i]]]++ - a] = o[i];
+			}
+			std::copy(tmp.begin(), tmp.end(), o + a);
+		}
+	}
+};
+
+//----------------------------------------------------------------------
+//	The path of a round
+//		A step of the path records its split and the side split off,
+//		which is built after the round.  The points still on the path
+//		have side -1, and those split off have the number of their
+//		step.  first[d] and last[d] are positions in the order along
+//		d, which are moved past points split off when they are used.
+//----------------------------------------------------------------------
+
+struct ANNpresort_step {				// a step of a path
+	int					cd;				// cutting dimension
+	ANNcoord			cv;				// cutting value
+	ANNcoord			lv, hv;			// bounds of the box along cd
+	ANNbool				low;			// low side split off? (else high)
+	int					start;			// first position of the side
+	int					n;				// number of points of the side
+	ANNkd_ptr			root;			// subtree of the side
+};
+
+class ANNpresort_path {					// the path of a round
+public:
+	ANNpresort_build	&pb;			// the build
+	std::vector<int>	first;			// first position on the path
+	std::vector<int>	last;			// last position on the path
+	int					m;				// number of points on the path
+
+	ANNpresort_path(ANNpresort_build &b, int a, int e)
+		: pb(b), first(b.dim, a), last(b.dim, e-1), m(e-a) {}
+
+	ANNcoord coord(int d, int i)		// coordinate of i-th along d
+		{ return pb.pa[pb.order(d)[i]][d]; }
+
+	ANNbool on(int d, int i)			// is i-th along d on the path?
+		{ return (ANNbool) (pb.side[pb.order(d)[i]] < 0); }
+
+	ANNcoord min(int d)					// min along d on the path
+		{
+			while (!on(d, first[d])) first[d]++;
+			return coord(d, first[d]);
+		}
+
+	ANNcoord max(int d)					// max along d on the path
+		{
+			while (!on(d, last[d])) last[d]--;
+			return coord(d, last[d]);
+		}
+
+	int count(int d, int i)				// number on path before i-th
+		{
+			int k = 0;					// count from the nearer end
+			if (i - first[d] <= last[d] + 1 - i) {
+				for (int j = first[d]; j < i; j++) k += on(d, j);
+				return k;
+			}
+			for (int j = i; j <= last[d]; j++) k += on(d, j);
+			return m - k;
+		}
+
+	int bound(int d, ANNcoord cv, ANNbool strict);	// see below
+	void kd_split(int &cd, ANNcoord &cv, int &n_lo);
+	void sl_midpt_split(ANNorthRect &bnds, int &cd, ANNcoord &cv, int &n_lo);
+};
+
+//----------------------------------------------------------------------
+//	bound - first position along d (between first[d] and last[d]+1)
+//		whose coordinate is >= cv (or > cv if strict).  Points that are
+//		no longer on the path are still in order, so this is a binary
+//		search.
+//----------------------------------------------------------------------
+
+int ANNpresort_path::bound(int d, ANNcoord cv, ANNbool strict)
+{
+	int l = first[d];
+	int r = last[d] + 1;
+	while (l < r) {
+		int i = l + (r - l) / 2;
+		ANNcoord c = coord(d, i);
+		if (c < cv || (strict && c == cv)) l = i + 1;
+		else r = i;
+	}
+	return l;
+}
+
+//----------------------------------------------------------------------
+//	kd_split - the split of kd_split() for the path
+//		The dimension of maximum spread is cut just after the m/2-th
+//		point.  The cutting value is the midpoint between it and the
+//		next one, which are found when that side is split off.
+//----------------------------------------------------------------------
+
+void ANNpresort_path::kd_split(int &cd, ANNcoord &cv, int &n_lo)
+{
+	cd = 0;
+	ANNcoord max_spr = 0;
+	for (int d = 0; d < pb.dim; d++) {	// find dimension of max spread
+		ANNcoord spr = max(d) - min(d);
+		if (spr > max_spr) {
+			max_spr = spr;
+			cd = d;
+		}
+	}
+	n_lo = m/2;
+	cv = 0;								// set when split off
+}
+
+//----------------------------------------------------------------------
+//	sl_midpt_split - the split of sl_midpt_split() for the path
+//		br1 and br2 (the numbers of points below and not above the
+//		cutting value) are counted from the nearer end of the order,
+//		which takes no longer than passing over the side split off
+//		(unless n_lo = m/2, which only happens at most twice in a
+//		round).
+//----------------------------------------------------------------------
+
+void ANNpresort_path::sl_midpt_split(ANNorthRect &bnds, int &cd,
+	ANNcoord &cv, int &n_lo)
+{
+	int d;
+
+	ANNcoord max_length = bnds.hi[0] - bnds.lo[0];
+	for (d = 1; d < pb.dim; d++) {		// find length of longest box side
+		ANNcoord length = bnds.hi[d] - bnds.lo[d];
+		if (length > max_length) {
+			max_length = length;
+		}
+	}
+	ANNcoord max_spread = -1;			// find long side with most spread
+	for (d = 0; d < pb.dim; d++) {
+		if ((bnds.hi[d] - bnds.lo[d]) >= (1-PS_ERR)*max_length) {
+			ANNcoord spr = max(d) - min(d);
+			if (spr > max_spread) {
+				max_spread = spr;
+				cd = d;
+			}
+		}
+	}
+										// ideal split at midpoint
+	ANNcoord ideal_cut_val = (bnds.lo[cd] + bnds.hi[cd])/2;
+	ANNcoord lo = min(cd);
+	ANNcoord hi = max(cd);
+
+	if (ideal_cut_val < lo) {			// slide to min or max as needed
+		cv = lo;
+		n_lo = 1;
+	}
+	else if (ideal_cut_val > hi) {
+		cv = hi;
+		n_lo = m-1;
+	}
+	else {
+		cv = ideal_cut_val;
+		int br1 = count(cd, bound(cd, cv, ANNfalse));
+		int br2 = count(cd, bound(cd, cv, ANNtrue));
+		if (br1 > m/2) n_lo = br1;
+		else if (br2 < m/2) n_lo = br2;
+		else n_lo = m/2;
+	}
+}
+
+//----------------------------------------------------------------------
+//	ANNpresort_task - build a side split off by a round
+//----------------------------------------------------------------------
+
+class ANNpresort_task : public ANNtask {
+	ANNpresort_build	&pb;			// the build
+	ANNpresort_step		&st;			// the step
+	ANNorthRect			bnd_box;		// bounding box (a copy)
+	ANNthread_pool		*pool;			// the pool
+public:
+	ANNpresort_task(ANNpresort_build &b, ANNpresort_step &s,
+			const ANNorthRect &bb, ANNthread_pool *pl)
+		: pb(b), st(s), bnd_box(b.dim, bb), pool(pl) {}
+
+	void run()
+		{
+			ANNbuild_scope scope(pool);
+			st.root = pb.build(st.start, st.start + st.n, bnd_box);
+		}
+};
+
+//----------------------------------------------------------------------
+//	build - build the subtree of positions [a,b) by a round
+//		The bounding box is modified as the round goes, but is
+//		restored on return.
+//----------------------------------------------------------------------
+
+ANNkd_ptr ANNpresort_build::build(int a, int b, ANNorthRect &bnd_box)
+{
+	int n = b - a;
+	if (n <= bsp || n <= 1) {			// n small, make a leaf node
+		if (n == 0) return KD_TRIVIAL;
+		ANNidx *o = order(0);
+		for (int i = a; i < b; i++) {
+			pidx[i] = o[i];
+		}
+		return new ANNkd_leaf(n, pidx + a);
+	}
+
+	ANNpresort_path path(*this, a, b);
+	std::vector<ANNpresort_step> steps;
+	int lo = a, hi = b;					// positions left on the path
+	int k, i;
+
+	while (path.m > bsp && path.m > (n+1)/2) {
+		ANNpresort_step st;
+		int n_lo;
+		if (sl_midpt) path.sl_midpt_split(bnd_box, st.cd, st.cv, n_lo);
+		else path.kd_split(st.cd, st.cv, n_lo);
+
+		ANNidx *o = order(st.cd);
+		int s = (int) steps.size();
+		st.low = (ANNbool) (n_lo <= path.m - n_lo);
+		if (st.low) {					// split off the low side
+			st.n = n_lo;
+			st.start = lo;
+			for (k = 0, i = path.first[st.cd]; k < st.n; i++) {
+				if (path.on(st.cd, i)) {
+					side[o[i]] = s;
+					k++;
+				}
+			}
+			if (!sl_midpt) {			// midpoint of the two sides
+				st.cv = (path.coord(st.cd, i-1) + path.min(st.cd))/2.0;
+			}
+			lo += st.n;
+		}
+		else {							// split off the high side
+			st.n = path.m - n_lo;
+			st.start = hi - st.n;
+			for (k = 0, i = path.last[st.cd]; k < st.n; i--) {
+				if (path.on(st.cd, i)) {
+					side[o[i]] = s;
+					k++;
+				}
+			}
+			hi -= st.n;
+		}
+		path.m -= st.n;
+
+		st.lv = bnd_box.lo[st.cd];		// move down the path
+		st.hv = bnd_box.hi[st.cd];
+		if (st.low) bnd_box.lo[st.cd] = st.cv;
+		else bnd_box.hi[st.cd] = st.cv;
+		st.root = NULL;
+		steps.push_back(st);
+	}
+
+	int n_steps = (int) steps.size();	// the rest is the last side
+	std::vector<int> start(n_steps + 1);
+	for (i = 0; i < n_steps; i++) {
+		start[i] = steps[i].start;
+	}
+	start[n_steps] = lo;
+	ANNidx *o = order(0);
+	for (i = a; i < b; i++) {
+		if (side[o[i]] < 0) side[o[i]] = n_steps;
+	}
+
+	ANNthread_pool *pool = annBuildPool();
+	ANNpresort_dist_body body;			// distribute the orders
+	body.pb = this;
+	body.a = a;
+	body.b = b;
+	body.start = &start;
+	annParallelFor(n >= ANN_PAR_SCAN ? pool : NULL, 0, dim, 1, body);
+
+	for (i = a; i < b; i++) {			// reset for the next rounds
+		side[o[i]] = -1;
+	}
+
+	for (i = n_steps-1; i >= 0; i--) {	// back to the top of the path
+		bnd_box.lo[steps[i].cd] = steps[i].lv;
+		bnd_box.hi[steps[i].cd] = steps[i].hv;
+	}
+
+	ANNtask_group group;				// build the sides
+	for (i = 0; i < n_steps; i++) {
+		ANNpresort_step &st = steps[i];
+		if (st.low) bnd_box.hi[st.cd] = st.cv;
+		else bnd_box.lo[st.cd] = st.cv;
+
+		if (pool != NULL && st.n >= ANN_PAR_SUBTREE) {
+			pool->spawn(group, new ANNpresort_task(*this, st, bnd_box, pool));
+		}
+		else {
+			st.root = build(st.start, st.start + st.n, bnd_box);
+		}
+
+		bnd_box.lo[st.cd] = st.lv;		// move down the path
+		bnd_box.hi[st.cd] = st.hv;
+		if (st.low) bnd_box.lo[st.cd] = st.cv;
+		else bnd_box.hi[st.cd] = st.cv;
+	}
+	ANNkd_ptr root = build(lo, hi, bnd_box);
+	if (pool != NULL) pool->wait(group);
+
+	for (i = n_steps-1; i >= 0; i--) {	// make the path's splitting nodes
+		ANNpresort_step &st = steps[i];
+		bnd_box.lo[st.cd] = st.lv;		// (restoring the box)
+		bnd_box.hi[st.cd] = st.hv;
+		if (st.low) root = new ANNkd_split(st.cd, st.cv, st.lv, st.hv, st.root, root);
+		else root = new ANNkd_split(st.cd, st.cv, st.lv, st.hv, root, st.root);
+	}
+	return root;
+}
+
+//----------------------------------------------------------------------
+//	presort_kd_tree - build a kd-tree from presorted points
+//		The rule must be ANN_KD_STD, ANN_KD_SL_MIDPT or
+//		ANN_KD_SUGGEST.  Like rkd_tree(), this permutes pidx and
+//		restores bnd_box.
+//----------------------------------------------------------------------
+
+ANNkd_ptr presort_kd_tree(				// build kd-tree from sorted points
+	ANNpointArray		pa,				// point array (unaltered)
+	ANNidxArray			pidx,			// point indices to store in tree
+	int					n,				// number of points
+	int					dim,			// dimension of space
+	int					bsp,			// bucket space
+	ANNorthRect			&bnd_box,		// bounding box for points
+	ANNsplitRule		split)			// splitting rule
+{
+	ANNpresort_build pb;
+	pb.pa = pa;
+	pb.pidx = pidx;
+	pb.n_pts = n;
+	pb.dim = dim;
+	pb.bsp = bsp;
+	pb.sl_midpt = (ANNbool) (split != ANN_KD_STD);
+	pb.ord.resize((size_t) dim * n);
+
+	ANNidx max_idx = 0;					// sides are indexed by point
+	for (int i = 0; i < n; i++) {
+		if (pidx[i] > max_idx) max_idx = pidx[i];
+	}
+	pb.side.assign(max_idx + 1, -1);
+
+	ANNpresort_sort_body body;			// sort along each dimension
+	body.pb = &pb;
+	annParallelFor(annBuildPool(), 0, dim, 1, body);
+
+	return pb.build(0, n, bnd_box);
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------
+// File:			kd_range_search.cpp
+// Programmer:		NNP contributors
+// Description:		Orthogonal range search and counting
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+// 
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+// 
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "kd_range_search.h"			// kd range search declarations
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Orthogonal range search
+//		The search visits the nodes whose cells meet the query box.
+//		A node whose cell lies in the box has all of its points in
+//		the box, so once k indices have been stored, it adds the
+//		number of points in its subtree (see fill_counts()) to the
+//		count and returns.  Otherwise a splitting node visits each
+//		child whose cell meets the box, and a leaf checks each of its
+//		points (unless its cell lies in the box).
+//
+//		The cell of the root is the bounding box of the tree.  The
+//		cell of a child is that of its parent cut at the cutting
+//		value, which is always within the parent's cell for the
+//		splitting rules of kd_split.cpp, but is clipped to it anyway.
+//----------------------------------------------------------------------
+
+int ANNkd_tree::annRangeSearch(
+	ANNpoint			lo,				// low corner of the box
+	ANNpoint			hi,				// high corner of the box
+	int					k,				// number of indices to return
+	ANNidxArray			idx)			// indices of points (returned)
+{
+	if (root == NULL) return 0;			// no points
+	ANNkd_range_ctx ctx(dim, pts, lo, hi, k, idx);
+
+	for (int d = 0; d < dim; d++) {		// set the cell of the root
+		if (bnd_box_lo[d] > hi[d] || bnd_box_hi[d] < lo[d])
+			return 0;					// it misses the box
+		ctx.cell.lo[d] = bnd_box_lo[d];
+		ctx.cell.hi[d] = bnd_box_hi[d];
+		if (!ctx.within(d)) ctx.n_out++;
+	}
+	root->ann_range_search(ctx);		// search starting at the root
+	return ctx.n_found;
+}
+
+int ANNkd_tree::annRangeSearch(
+	const ANNorthRect	&box,			// the box
+	int					k,				// number of indices to return
+	ANNidxArray			idx)			// indices of points (returned)
+{
+	return annRangeSearch(box.lo, box.hi, k, idx);
+}
+
+int ANNkd_tree::annRangeCount(
+	ANNpoint			lo,				// low corner of the box
+	ANNpoint			hi)				// high corner of the box
+{
+	return annRangeSearch(lo, hi, 0, NULL);
+}
+
+int ANNkd_tree::annRangeCount(
+	const ANNorthRect	&box)			// the box
+{
+	return annRangeSearch(box.lo, box.hi, 0, NULL);
+}
+
+//----------------------------------------------------------------------
+//	kd_split::ann_range_search - search a splitting node
+//----------------------------------------------------------------------
+
+void ANNkd_split::ann_range_search(ANNkd_range_ctx &ctx)
+{
+	if (ctx.n_out == 0 && ctx.n_found >= ctx.k) {
+		ctx.n_found += n_sub;			// count the whole subtree
+		return;
+	}
+
+	ANNcoord lo = ctx.cell.lo[cut_dim];	// the cell along cut_dim
+	ANNcoord hi = ctx.cell.hi[cut_dim];
+
+	if (ctx.lo[cut_dim] <= cut_val) {	// low child meets the box
+		ctx.set_hi(cut_dim, cut_val < hi ? cut_val : hi);
+		child[ANN_LO]->ann_range_search(ctx);
+		ctx.set_hi(cut_dim, hi);
+	}
+	if (ctx.hi[cut_dim] >= cut_val) {	// high child meets the box
+		ctx.set_lo(cut_dim, cut_val > lo ? cut_val : lo);
+		child[ANN_HI]->ann_range_search(ctx);
+		ctx.set_lo(cut_dim, lo);
+	}
+	ANN_SPL(1)							// one more splitting node visited
+}
+
+//----------------------------------------------------------------------
+//	kd_leaf::ann_range_search - search points in a leaf node
+//----------------------------------------------------------------------
+
+void ANNkd_leaf::ann_range_search(ANNkd_range_ctx &ctx)
+{
+	if (ctx.n_out == 0) {				// all points are in the box
+		if (ctx.n_found >= ctx.k) {
+			ctx.n_found += n_pts;
+			return;
+		}
+		for (int i = 0; i < n_pts; i++) {
+			ctx.report(bkt[i]);
+		}
+	}
+	else {								// check each point
+		for (int i = 0; i < n_pts; i++) {
+			if (ctx.inside(ctx.pts[bkt[i]]))
+				ctx.report(bkt[i]);
+		}
+		ANN_PTS(n_pts)					// increment points visited
+	}
+	ANN_LEAF(1)							// one more leaf node visited
+}
+
+ANN_END_NAMESPACE
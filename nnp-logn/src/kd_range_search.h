@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------
+// File:			kd_range_search.h
+// Programmer:		NNP contributors
+// Description:		Orthogonal range search and counting
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+// 
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+// 
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANNkd_range_search_H
+#define ANNkd_range_search_H
+
+#include "kd_tree.h"					// kd-tree declarations
+
+#include <ANN/ANNperf.h>				// performance evaluation
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Range search context
+//		A range search keeps the cell of the node being visited, which
+//		is changed along one dimension (or, at a shrinking node, a few)
+//		on the way down the tree and changed back on the way up, and
+//		the number of dimensions along which the cell is not within
+//		the query box.  The cell lies in the box when this is 0, and
+//		since set_lo() and set_hi() keep it up to date, this takes
+//		constant time to check at each node.
+//
+//		The indices of the first k points found in the box are stored
+//		in idx, and n_found counts all of them.
+//----------------------------------------------------------------------
+
+class ANNkd_range_ctx {					// state of one range search
+public:
+	int					dim;			// dimension of space
+	ANNpointArray		pts;			// the points
+	ANNpoint			lo;				// low corner of the box
+	ANNpoint			hi;				// high corner of the box
+	ANNorthRect			cell;			// cell of the current node
+	int					n_out;			// dims of cell not within box
+	int					k;				// number of indices to store
+	ANNidxArray			idx;			// indices of points (or NULL)
+	int					n_found;		// number of points in box
+
+	ANNkd_range_ctx(					// constructor
+		int				dd,				// dimension of space
+		ANNpointArray	pa,				// the points
+		ANNpoint		l,				// low corner of the box
+		ANNpoint		h,				// high corner of the box
+		int				kk,				// number of indices to store
+		ANNidxArray		ix)				// room for the indices
+		: cell(dd)
+		{
+			dim				= dd;
+			pts				= pa;
+			lo				= l;
+			hi				= h;
+			n_out			= 0;
+			k				= kk;
+			idx				= ix;
+			n_found			= 0;
+		}
+
+	int within(int d)					// is cell within box along d?
+		{ return cell.lo[d] >= lo[d] && cell.hi[d] <= hi[d]; }
+
+	void set_lo(int d, ANNcoord v)		// set low side of cell along d
+		{ n_out += within(d);  cell.lo[d] = v;  n_out -= within(d); }
+
+	void set_hi(int d, ANNcoord v)		// set high side of cell along d
+		{ n_out += within(d);  cell.hi[d] = v;  n_out -= within(d); }
+
+	ANNbool inside(ANNpoint p)			// is p in the box?
+		{
+			for (int d = 0; d < dim; d++) {
+				if (p[d] < lo[d] || p[d] > hi[d]) return ANNfalse;
+			}
+			return ANNtrue;
+		}
+
+	void report(ANNidx i)				// a point in the box
+		{
+			if (n_found < k) idx[n_found] = i;
+			n_found++;
+		}
+};
+
+ANN_END_NAMESPACE
+
+#endif
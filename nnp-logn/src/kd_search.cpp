@@ -22,10 +22,17 @@
 //		Initial release
 //	Revision 1.0  04/01/05
 //		Changed names LO, HI to ANN_LO, ANN_HI
+//	Revision 1.2
+//		Search state passed in an ANNkd_search_ctx instead of globals
+//		Leaves with coordinate blocks are scanned by annScanLeafCoords
+//		Leaves with code blocks are scanned by annScanLeafCodes
+//		Queues are borrowed from the thread's search workspace
 //----------------------------------------------------------------------
 
 #include "kd_search.h"					// kd-search declarations
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Approximate nearest neighbor searching by kd-tree search
 //		The kd-tree is searched for an approximate nearest neighbor.
@@ -71,17 +78,14 @@
 //----------------------------------------------------------------------
 
 //----------------------------------------------------------------------
-//		To keep argument lists short, a number of global variables
-//		are maintained which are common to all the recursive calls.
-//		These are given below.
+//		The state which is common to all the recursive calls (the
+//		query point, the error bound, the k closest points seen so
+//		far, etc.) is kept in a search context (ANNkd_search_ctx),
+//		which is created by annkSearch() and passed by reference to
+//		every call.  Nothing global is modified by the search, so
+//		the same tree may be searched by several threads at once.
 //----------------------------------------------------------------------
 
-int				ANNkdDim;				// dimension of space
-ANNpoint		ANNkdQ;					// query point
-double			ANNkdMaxErr;			// max tolerable squared error
-ANNpointArray	ANNkdPts;				// the points
-ANNmink		*ANNkdPointMK;			// set of k closest points
-
 //----------------------------------------------------------------------
 //	annkSearch - search for the k nearest neighbors
 //----------------------------------------------------------------------
@@ -93,46 +97,43 @@ void ANNkd_tree::annkSearch(
 	ANNdistArray		dd,				// the approximate nearest neighbor
 	double				eps)			// the error bound
 {
-
-	ANNkdDim = dim;						// copy arguments to static equivs
-	ANNkdQ = q;
-	ANNkdPts = pts;
-	ANNptsVisited = 0;					// initialize count of points visited
-
 	if (k > n_pts) {					// too many near neighbors?
 		annError("Requesting more near neighbors than data points", ANNabort);
 	}
-
-	ANNkdMaxErr = ANN_POW(1.0 + eps);
+										// set up the search context
+	ANNkd_search_ctx ctx(dim, q, pts, eps);
 	ANN_FLOP(2)							// increment floating op count
 
-	ANNkdPointMK = new ANNmink(k);		// create set for closest k points
+	ANNsearch_lease ws;					// borrow the thread's workspace
+	ANNmink &point_mk = ws->mink(k);	// set for closest k points
+	if (leaf_quant != NULL)				// quantize the query point
+		ctx.set_quant(leaf_quant, ws->query_codes(dim));
+	ctx.point_mk = &point_mk;
 										// search starting at the root
-	root->ann_search(annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim));
+	root->ann_search(annBoxDistance(q, bnd_box_lo, bnd_box_hi, dim), ctx);
 
 	for (int i = 0; i < k; i++) {		// extract the k-th closest points
-		dd[i] = ANNkdPointMK->ith_smallestkey(i);
-		nn_idx[i] = ANNkdPointMK->ith_smallest_info(i);
+		dd[i] = point_mk.ith_smallestkey(i);
+		nn_idx[i] = point_mk.ith_smallest_info(i);
 	}
-	delete ANNkdPointMK;				// deallocate closest point set
 }
 
 //----------------------------------------------------------------------
 //	kd_split::ann_search - search a splitting node
 //----------------------------------------------------------------------
 
-void ANNkd_split::ann_search(ANNdist box_dist)
+void ANNkd_split::ann_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 										// check dist calc term condition
-	if (ANNmaxPtsVisited != 0 && ANNptsVisited > ANNmaxPtsVisited) return;
+	if (ctx.visit_limit()) return;
 
 										// distance to cutting plane
-	ANNcoord cut_diff = ANNkdQ[cut_dim] - cut_val;
+	ANNcoord cut_diff = ctx.q[cut_dim] - cut_val;
 
 	if (cut_diff < 0) {					// left of cutting plane
-		child[ANN_LO]->ann_search(box_dist);// visit closer child first
+		child[ANN_LO]->ann_search(box_dist, ctx);// visit closer child first
 
-		ANNcoord box_diff = cd_bnds[ANN_LO] - ANNkdQ[cut_dim];
+		ANNcoord box_diff = cd_bnds[ANN_LO] - ctx.q[cut_dim];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -140,14 +141,14 @@ void ANNkd_split::ann_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 										// visit further child if close enough
-		if (box_dist * ANNkdMaxErr < ANNkdPointMK->maxkey())
-			child[ANN_HI]->ann_search(box_dist);
+		if (box_dist * ctx.max_err < ctx.point_mk->maxkey())
+			child[ANN_HI]->ann_search(box_dist, ctx);
 
 	}
 	else {								// right of cutting plane
-		child[ANN_HI]->ann_search(box_dist);// visit closer child first
+		child[ANN_HI]->ann_search(box_dist, ctx);// visit closer child first
 
-		ANNcoord box_diff = ANNkdQ[cut_dim] - cd_bnds[ANN_HI];
+		ANNcoord box_diff = ctx.q[cut_dim] - cd_bnds[ANN_HI];
 		if (box_diff < 0)				// within bounds - ignore
 			box_diff = 0;
 										// distance to further box
@@ -155,8 +156,8 @@ void ANNkd_split::ann_search(ANNdist box_dist)
 				ANN_DIFF(ANN_POW(box_diff), ANN_POW(cut_diff)));
 
 										// visit further child if close enough
-		if (box_dist * ANNkdMaxErr < ANNkdPointMK->maxkey())
-			child[ANN_LO]->ann_search(box_dist);
+		if (box_dist * ctx.max_err < ctx.point_mk->maxkey())
+			child[ANN_LO]->ann_search(box_dist, ctx);
 
 	}
 	ANN_FLOP(10)						// increment floating ops
@@ -167,9 +168,11 @@ void ANNkd_split::ann_search(ANNdist box_dist)
 //	kd_leaf::ann_search - search points in a leaf node
 //		Note: The unreadability of this code is the result of
 //		some fine tuning to replace indexing by pointer operations.
+//		The frequently used fields of the search context are copied
+//		into locals so they can be kept in registers.
 //----------------------------------------------------------------------
 
-void ANNkd_leaf::ann_search(ANNdist box_dist)
+void ANNkd_leaf::ann_search(ANNdist box_dist, ANNkd_search_ctx &ctx)
 {
 	register ANNdist dist;				// distance to data point
 	register ANNcoord* pp;				// data coordinate pointer
@@ -178,15 +181,36 @@ void ANNkd_leaf::ann_search(ANNdist box_dist)
 	register ANNcoord t;
 	register int d;
 
-	min_dist = ANNkdPointMK->maxkey(); // k-th smallest distance so far
+	if (codes != NULL) {				// scan the code block
+		annScanLeafCodes(*ctx.quant, codes, bkt, n_pts, ctx.pts, ctx.q,
+				ctx.q_code, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+	if (coords != NULL) {				// scan the coordinate block
+		annScanLeafCoords(coords, bkt, n_pts, ctx.dim, ctx.q, *ctx.point_mk);
+		ANN_LEAF(1)						// one more leaf node visited
+		ANN_PTS(n_pts)					// increment points visited
+		ctx.pts_visited += n_pts;		// increment number of points visited
+		return;
+	}
+
+	ANNpointArray	pts = ctx.pts;		// the points
+	ANNpoint		q   = ctx.q;		// the query point
+	int				dim = ctx.dim;		// dimension of space
+	ANNmink			*point_mk = ctx.point_mk;// set of k closest points
+
+	min_dist = point_mk->maxkey();		// k-th smallest distance so far
 
 	for (int i = 0; i < n_pts; i++) {	// check points in bucket
 
-		pp = ANNkdPts[bkt[i]];			// first coord of next data point
-		qq = ANNkdQ;					// first coord of query point
+		pp = pts[bkt[i]];				// first coord of next data point
+		qq = q;							// first coord of query point
 		dist = 0;
 
-		for(d = 0; d < ANNkdDim; d++) {
+		for(d = 0; d < dim; d++) {
 			ANN_COORD(1)				// one more coordinate hit
 			ANN_FLOP(4)					// increment floating ops
 
@@ -197,14 +221,16 @@ void ANNkd_leaf::ann_search(ANNdist box_dist)
 			}
 		}
 
-		if (d >= ANNkdDim &&					// among the k best?
+		if (d >= dim &&							// among the k best?
 		   (ANN_ALLOW_SELF_MATCH || dist!=0)) { // and no self-match problem
 												// add it to the list
-			ANNkdPointMK->insert(dist, bkt[i]);
-			min_dist = ANNkdPointMK->maxkey();
+			point_mk->insert(dist, bkt[i]);
+			min_dist = point_mk->maxkey();
 		}
 	}
 	ANN_LEAF(1)							// one more leaf node visited
 	ANN_PTS(n_pts)						// increment points visited
-	ANNptsVisited += n_pts;				// increment number of points visited
+	ctx.pts_visited += n_pts;			// increment number of points visited
 }
+
+ANN_END_NAMESPACE
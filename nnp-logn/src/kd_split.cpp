@@ -21,12 +21,18 @@
 //	Revision 0.1  03/04/98
 //		Initial release
 //	Revision 1.0  04/01/05
+//	Revision 1.2
+//		Spreads and medians of large nodes may be estimated from
+//		samples (see annBuildSample())
+//		Fair splits find all spreads in one scan of the points
 //----------------------------------------------------------------------
 
 #include "kd_tree.h"					// kd-tree definitions
 #include "kd_util.h"					// kd-tree utilities
 #include "kd_split.h"					// splitting functions
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Constants
 //----------------------------------------------------------------------
@@ -53,9 +59,9 @@ void kd_split(
 {
 										// find dimension of maximum spread
 	cut_dim = annMaxSpread(pa, pidx, n, dim);
-	n_lo = n/2;							// median rank
 										// split about median
-	annMedianSplit(pa, pidx, n, cut_dim, cut_val, n_lo);
+	annSampleMedianSplit(pa, pidx, n, cut_dim,
+			bnds.lo[cut_dim], bnds.hi[cut_dim], cut_val, n_lo);
 }
 
 //----------------------------------------------------------------------
@@ -262,6 +268,8 @@ void fair_split(
 	}
 
 	ANNcoord max_spread = 0;			// find legal cut with max spread
+	ANNorthRect spr_box(dim);			// spreads along all dims at once
+	annSampleEnclRect(pa, pidx, n, dim, spr_box);
 	cut_dim = 0;
 	for (d = 0; d < dim; d++) {
 		ANNcoord length = bnds.hi[d] - bnds.lo[d];
@@ -269,7 +277,7 @@ void fair_split(
 										// without violating aspect ratio?
 		if (((double) max_length)*2.0/((double) length) <= FS_ASPECT_RATIO) {
 										// compute spread along this dim
-			ANNcoord spr = annSpread(pa, pidx, n, d);
+			ANNcoord spr = spr_box.hi[d] - spr_box.lo[d];
 			if (spr > max_spread) {		// best spread so far
 				max_spread = spr;
 				cut_dim = d;			// this is dimension to cut
@@ -302,8 +310,9 @@ void fair_split(
 		n_lo = br2;
 	}
 	else {								// median cut preserves asp ratio
-		n_lo = n/2;						// split about median
-		annMedianSplit(pa, pidx, n, cut_dim, cut_val, n_lo);
+										// split about median
+		annSampleMedianSplit(pa, pidx, n, cut_dim,
+				lo_cut, hi_cut, cut_val, n_lo);
 	}
 }
 
@@ -368,6 +377,8 @@ void sl_fair_split(
 	}
 
 	ANNcoord max_spread = 0;			// find legal cut with max spread
+	ANNorthRect spr_box(dim);			// spreads along all dims at once
+	annSampleEnclRect(pa, pidx, n, dim, spr_box);
 	cut_dim = 0;
 	for (d = 0; d < dim; d++) {
 		ANNcoord length = bnds.hi[d] - bnds.lo[d];
@@ -375,7 +386,7 @@ void sl_fair_split(
 										// without violating aspect ratio?
 		if (((double) max_length)*2.0/((double) length) <= FS_ASPECT_RATIO) {
 										// compute spread along this dim
-			ANNcoord spr = annSpread(pa, pidx, n, d);
+			ANNcoord spr = spr_box.hi[d] - spr_box.lo[d];
 			if (spr > max_spread) {		// best spread so far
 				max_spread = spr;
 				cut_dim = d;			// this is dimension to cut
@@ -422,7 +433,10 @@ void sl_fair_split(
 		}
 	}
 	else {								// median cut is good enough
-		n_lo = n/2;						// split about median
-		annMedianSplit(pa, pidx, n, cut_dim, cut_val, n_lo);
+										// split about median
+		annSampleMedianSplit(pa, pidx, n, cut_dim,
+				lo_cut, hi_cut, cut_val, n_lo);
 	}
 }
+
+ANN_END_NAMESPACE
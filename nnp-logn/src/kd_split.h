@@ -27,6 +27,8 @@
 
 #include "kd_tree.h"					// kd-tree definitions
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	External entry points
 //		These are all splitting procedures for kd-trees.
@@ -82,4 +84,6 @@ void sl_fair_split(						// sliding fair-split kd-splitter
 	ANNcoord			&cut_val,		// cutting value (returned)
 	int					&n_lo);			// num of points on low side (returned)
 
+ANN_END_NAMESPACE
+
 #endif
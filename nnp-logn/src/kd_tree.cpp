@@ -26,13 +26,29 @@
 //		Added optional pa, pi arguments to Skeleton kd_tree constructor
 //			for use in load constructor.
 //		Added annClose() to eliminate KD_TRIVIAL memory leak.
+//	Revision 1.2
+//		annClose() also shuts down the thread pools.
+//		annClose() also frees the search workspaces.
+//		Added leaf coordinate blocks (MakeLeafCoords()).
+//		Added quantized leaf codes (MakeLeafCodes()).
+//		Large subtrees are built in parallel.
+//		Trees may be built from presorted points (annBuildPresort()).
+//		Added fill_leaves() and ANNkd_leaf::remove().
+//		Added subtree point counts (fill_counts()).
 //----------------------------------------------------------------------
 
 #include "kd_tree.h"					// kd-tree declarations
 #include "kd_split.h"					// kd-tree splitting rules
 #include "kd_util.h"					// kd-tree utilities
+#include "kd_leaf_scan.h"				// leaf coordinate blocks
+#include "kd_leaf_quant.h"				// quantized leaf codes
+#include "thread_pool.h"				// thread pools
+#include "kd_par_build.h"				// parallel construction
+#include "search_space.h"				// search workspaces
 #include <ANN/ANNperf.h>				// performance evaluation
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Global data
 //
@@ -182,6 +198,151 @@ void ANNkd_split::getStats(						// get subtree statistics
 	st.n_spl++;									// increment number of splits
 }
 
+//----------------------------------------------------------------------
+//	Leaf coordinate blocks
+//		fill_coords() gives each nonempty leaf its part of the tree's
+//		coordinate array, which holds the points in the order of the
+//		point index array pidx (see kd_leaf_scan.h).  The bucket of
+//		every leaf is a subarray of pidx, so the block of a leaf is
+//		found from the position of its bucket.  The trivial leaf is
+//		shared among trees, and is left alone.
+//----------------------------------------------------------------------
+
+void ANNkd_leaf::fill_coords(					// set leaf coord block
+	ANNpointArray		pa,						// the points
+	int					dim,					// dimension of space
+	ANNidxArray			pidx,					// tree's point indices
+	ANNcoord			*block)					// tree's coordinate array
+{
+	if (n_pts == 0) return;						// nothing to store
+	coords = block + (bkt - pidx)*dim;			// our part of the array
+	annFillLeafCoords(coords, pa, bkt, n_pts, dim);
+}
+
+void ANNkd_split::fill_coords(					// set leaf coord blocks
+	ANNpointArray		pa,						// the points
+	int					dim,					// dimension of space
+	ANNidxArray			pidx,					// tree's point indices
+	ANNcoord			*block)					// tree's coordinate array
+{
+	child[ANN_LO]->fill_coords(pa, dim, pidx, block);
+	child[ANN_HI]->fill_coords(pa, dim, pidx, block);
+}
+
+void ANNkd_tree::MakeLeafCoords()				// build leaf coord blocks
+{
+	if (root == NULL || pts == NULL) return;	// no leaves or no points
+	leaf_coords = new ANNcoord[(size_t) n_pts * dim];
+	root->fill_coords(pts, dim, pidx, leaf_coords);
+}
+
+//----------------------------------------------------------------------
+//	Quantized leaf codes
+//		fill_codes() gives each nonempty leaf its part of the code
+//		array of the quantizer, in the same way as fill_coords().  The
+//		quantizer is set up over the bounding box of the tree (see
+//		kd_leaf_quant.h).
+//----------------------------------------------------------------------
+
+void ANNkd_leaf::fill_codes(					// set leaf code block
+	ANNleaf_quant		&lq,					// the quantizer
+	ANNpointArray		pa,						// the points
+	ANNidxArray			pidx)					// tree's point indices
+{
+	if (n_pts == 0) return;						// nothing to store
+	codes = lq.codes + (bkt - pidx)*lq.dim*lq.size;	// our part of the array
+	lq.fill(codes, pa, bkt, n_pts);
+}
+
+void ANNkd_split::fill_codes(					// set leaf code blocks
+	ANNleaf_quant		&lq,					// the quantizer
+	ANNpointArray		pa,						// the points
+	ANNidxArray			pidx)					// tree's point indices
+{
+	child[ANN_LO]->fill_codes(lq, pa, pidx);
+	child[ANN_HI]->fill_codes(lq, pa, pidx);
+}
+
+void ANNkd_tree::MakeLeafCodes()				// build quantized leaf codes
+{
+	if (root == NULL || pts == NULL) return;	// no leaves or no points
+	leaf_quant = new ANNleaf_quant(ANNuseLeafCodes, n_pts, dim,
+			bnd_box_lo, bnd_box_hi);
+	root->fill_codes(*leaf_quant, pts, pidx);
+}
+
+//----------------------------------------------------------------------
+//	Subtree counts
+//		fill_counts() sets the number of points in the subtree of every
+//		splitting node, and returns the number of points in the subtree
+//		of the node.  It is called once the tree has been built (or
+//		loaded).  The counts are used by range counting (see
+//		kd_range_search.cpp).
+//----------------------------------------------------------------------
+
+int ANNkd_leaf::fill_counts()					// set subtree counts
+{
+	return n_pts;
+}
+
+int ANNkd_split::fill_counts()					// set subtree counts
+{
+	n_sub = child[ANN_LO]->fill_counts() + child[ANN_HI]->fill_counts();
+	return n_sub;
+}
+
+//----------------------------------------------------------------------
+//	Removing points
+//		fill_leaves() sets leaf_of[i] to the leaf holding point i, for
+//		every point of the tree.  A point stays in the same leaf for
+//		the life of the tree, so remove() can then go straight to its
+//		leaf, which takes it out of its bucket by moving the last
+//		point of the bucket into its place (and the removed point to
+//		the end, so that pidx stays a permutation).  The coordinate or
+//		code block of the leaf, if any, is filled again for the points
+//		that remain, which fit in the block they had.  The cells are
+//		not changed, so the tree remains valid for searching, and
+//		searches no longer find the point.  The counts of the
+//		splitting nodes above it are not changed, so range searches
+//		must not be used on the tree afterwards.  These are used by
+//		the forests of kd_forest.cpp.
+//----------------------------------------------------------------------
+
+void ANNkd_leaf::fill_leaves(					// set leaves of points
+	ANNkd_leaf			**leaf_of)				// leaves (modified)
+{
+	for (int j = 0; j < n_pts; j++) {
+		leaf_of[bkt[j]] = this;
+	}
+}
+
+void ANNkd_split::fill_leaves(					// set leaves of points
+	ANNkd_leaf			**leaf_of)				// leaves (modified)
+{
+	child[ANN_LO]->fill_leaves(leaf_of);
+	child[ANN_HI]->fill_leaves(leaf_of);
+}
+
+ANNbool ANNkd_leaf::remove(						// remove a point
+	ANNidx				i,						// the point
+	ANNpointArray		pa,						// the points
+	int					dim,					// dimension of space
+	ANNleaf_quant		*lq)					// quantizer (or NULL)
+{
+	for (int j = 0; j < n_pts; j++) {
+		if (bkt[j] == i) {						// found it
+			bkt[j] = bkt[--n_pts];				// last point takes its place
+			bkt[n_pts] = i;
+			if (coords != NULL)					// refill the blocks
+				annFillLeafCoords(coords, pa, bkt, n_pts, dim);
+			if (codes != NULL)
+				lq->fill(codes, pa, bkt, n_pts);
+			return ANNtrue;
+		}
+	}
+	return ANNfalse;							// not in this leaf
+}
+
 //----------------------------------------------------------------------
 //	getStats
 //		Collects a number of statistics related to kd_tree or
@@ -212,14 +373,20 @@ ANNkd_tree::~ANNkd_tree()				// tree destructor
 	if (pidx != NULL) delete [] pidx;
 	if (bnd_box_lo != NULL) annDeallocPt(bnd_box_lo);
 	if (bnd_box_hi != NULL) annDeallocPt(bnd_box_hi);
+	if (leaf_coords != NULL) delete [] leaf_coords;
+	if (leaf_quant != NULL) delete leaf_quant;
 }
 
 //----------------------------------------------------------------------
 //	This is called with all use of ANN is finished.  It eliminates the
-//	minor memory leak caused by the allocation of KD_TRIVIAL.
+//	minor memory leak caused by the allocation of KD_TRIVIAL, stops
+//	the threads of any thread pools that have been created, and frees
+//	the search workspaces of all threads.
 //----------------------------------------------------------------------
 void annClose()				// close use of ANN
 {
+	annClosePools();
+	annCloseSearchSpaces();
 	if (KD_TRIVIAL != NULL) {
 		delete KD_TRIVIAL;
 		KD_TRIVIAL = NULL;
@@ -266,6 +433,8 @@ void ANNkd_tree::SkeletonTree(			// construct skeleton tree
 	}
 
 	bnd_box_lo = bnd_box_hi = NULL;		// bounding box is nonexistent
+	leaf_coords = NULL;					// no leaf coordinate blocks
+	leaf_quant = NULL;					// no quantized leaf codes
 	if (KD_TRIVIAL == NULL)				// no trivial leaf node yet?
 		KD_TRIVIAL = new ANNkd_leaf(0, IDX_TRIVIAL);	// allocate it
 }
@@ -309,8 +478,37 @@ ANNkd_tree::ANNkd_tree(					// basic constructor
 //		This procedure selects a cutting dimension and cutting value,
 //		partitions pa about these values, and returns the number of
 //		points on the low side of the cut.
+//
+//		When building with a thread pool (see kd_par_build.h), and
+//		both sides of the cut have many points, the low subtree is
+//		built by a task of the pool (with its own copy of the bounding
+//		box), while this call builds the high subtree.
 //----------------------------------------------------------------------
 
+class ANNkd_subtree_task : public ANNtask {	// build a subtree
+	ANNkd_ptr			&root;			// where to put it
+	ANNpointArray		pa;				// point array
+	ANNidxArray			pidx;			// point indices
+	int					n;				// number of points
+	int					dim;			// dimension of space
+	int					bsp;			// bucket space
+	ANNorthRect			bnd_box;		// bounding box (a copy)
+	ANNkd_splitter		splitter;		// splitting routine
+	ANNthread_pool		*pool;			// the pool
+public:
+	ANNkd_subtree_task(ANNkd_ptr &r, ANNpointArray a, ANNidxArray pi,
+			int nn, int dd, int bs, const ANNorthRect &bb,
+			ANNkd_splitter sp, ANNthread_pool *pl)
+		: root(r), pa(a), pidx(pi), n(nn), dim(dd), bsp(bs),
+		  bnd_box(dd, bb), splitter(sp), pool(pl) {}
+
+	void run()
+		{
+			ANNbuild_scope scope(pool);
+			root = rkd_tree(pa, pidx, n, dim, bsp, bnd_box, splitter);
+		}
+};
+
 ANNkd_ptr rkd_tree(				// recursive construction of kd-tree
 	ANNpointArray		pa,				// point array
 	ANNidxArray			pidx,			// point indices to store in subtree
@@ -338,17 +536,34 @@ ANNkd_ptr rkd_tree(				// recursive construction of kd-tree
 		ANNcoord lv = bnd_box.lo[cd];	// save bounds for cutting dimension
 		ANNcoord hv = bnd_box.hi[cd];
 
-		bnd_box.hi[cd] = cv;			// modify bounds for left subtree
-		lo = rkd_tree(					// build left subtree
-				pa, pidx, n_lo,			// ...from pidx[0..n_lo-1]
-				dim, bsp, bnd_box, splitter);
-		bnd_box.hi[cd] = hv;			// restore bounds
-
-		bnd_box.lo[cd] = cv;			// modify bounds for right subtree
-		hi = rkd_tree(					// build right subtree
-				pa, pidx + n_lo, n-n_lo,// ...from pidx[n_lo..n-1]
-				dim, bsp, bnd_box, splitter);
-		bnd_box.lo[cd] = lv;			// restore bounds
+		ANNthread_pool *pool = annBuildPool();
+		if (pool != NULL && n_lo >= ANN_PAR_SUBTREE &&
+				n-n_lo >= ANN_PAR_SUBTREE) {
+			ANNtask_group group;		// build left subtree in parallel
+			bnd_box.hi[cd] = cv;
+			pool->spawn(group, new ANNkd_subtree_task(lo,
+					pa, pidx, n_lo, dim, bsp, bnd_box, splitter, pool));
+			bnd_box.hi[cd] = hv;
+
+			bnd_box.lo[cd] = cv;		// build right subtree here
+			hi = rkd_tree(pa, pidx + n_lo, n-n_lo,
+					dim, bsp, bnd_box, splitter);
+			bnd_box.lo[cd] = lv;
+			pool->wait(group);			// wait for left subtree
+		}
+		else {
+			bnd_box.hi[cd] = cv;		// modify bounds for left subtree
+			lo = rkd_tree(				// build left subtree
+					pa, pidx, n_lo,		// ...from pidx[0..n_lo-1]
+					dim, bsp, bnd_box, splitter);
+			bnd_box.hi[cd] = hv;		// restore bounds
+
+			bnd_box.lo[cd] = cv;		// modify bounds for right subtree
+			hi = rkd_tree(				// build right subtree
+					pa, pidx + n_lo, n-n_lo,// ...from pidx[n_lo..n-1]
+					dim, bsp, bnd_box, splitter);
+			bnd_box.lo[cd] = lv;		// restore bounds
+		}
 
 										// create the splitting node
 		ANNkd_split *ptr = new ANNkd_split(cd, cv, lv, hv, lo, hi);
@@ -363,6 +578,10 @@ ANNkd_ptr rkd_tree(				// recursive construction of kd-tree
 //		It first builds a skeleton tree, then computes the bounding box
 //		of the data points, and then invokes rkd_tree() to actually
 //		build the tree, passing it the appropriate splitting routine.
+//		Large trees are built using the thread pool for construction
+//		(see annBuildThreads()).  If annBuildPresort() is on, trees of
+//		the kd and sliding midpoint rules are built from presorted
+//		points instead (see kd_presort.cpp).
 //----------------------------------------------------------------------
 
 ANNkd_tree::ANNkd_tree(					// construct from point array
@@ -376,13 +595,18 @@ ANNkd_tree::ANNkd_tree(					// construct from point array
 	pts = pa;							// where the points are
 	if (n == 0) return;					// no points--no sweat
 
+	ANNbuild_scope scope(annBuildPoolFor(n));	// parallel if large
 	ANNorthRect bnd_box(dd);			// bounding box for points
 	annEnclRect(pa, pidx, n, dd, bnd_box);// construct bounding rectangle
 										// copy to tree structure
 	bnd_box_lo = annCopyPt(dd, bnd_box.lo);
 	bnd_box_hi = annCopyPt(dd, bnd_box.hi);
 
-	switch (split) {					// build by rule
+	if (ANNbuildPresort && (split == ANN_KD_STD ||
+			split == ANN_KD_SL_MIDPT || split == ANN_KD_SUGGEST)) {
+		root = presort_kd_tree(pa, pidx, n, dd, bs, bnd_box, split);
+	}
+	else switch (split) {					// build by rule
 	case ANN_KD_STD:					// standard kd-splitting rule
 		root = rkd_tree(pa, pidx, n, dd, bs, bnd_box, kd_split);
 		break;
@@ -402,4 +626,12 @@ ANNkd_tree::ANNkd_tree(					// construct from point array
 	default:
 		annError("Illegal splitting method", ANNabort);
 	}
+	root->fill_counts();				// count points of subtrees
+
+	if (ANNuseLeafCodes != ANN_CODES_NONE)	// quantize points to the leaves
+		MakeLeafCodes();
+	else if (ANNuseLeafCoords)			// copy points to the leaves
+		MakeLeafCoords();
 }
+
+ANN_END_NAMESPACE
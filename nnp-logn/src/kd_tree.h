@@ -22,6 +22,14 @@
 //		Initial release
 //	Revision 1.1  05/03/05
 //		Added fixed radius kNN search
+//	Revision 1.2
+//		Search state moved from globals into ANNkd_search_ctx, which
+//		is passed to the node search routines.
+//		Added flatten() to the nodes (see kd_flat.h).
+//		Added leaf coordinate blocks (see kd_leaf_scan.h).
+//		Added quantized leaf codes (see kd_leaf_quant.h).
+//		Added fill_leaves() and ANNkd_leaf::remove() (see kd_forest.cpp).
+//		Added subtree point counts and range search (see kd_range_search.h).
 //----------------------------------------------------------------------
 
 #ifndef ANNkd_tree_H
@@ -31,6 +39,76 @@
 
 using namespace std;					// make std:: available
 
+ANN_BEGIN_NAMESPACE
+
+class ANNmink;							// k-element priority queue
+class ANNpr_queue;						// priority queue for boxes
+class ANNflat_build;					// tree being flattened
+class ANNleaf_quant;					// quantizer of leaf codes
+class ANNkd_leaf;						// leaf node
+class ANNkd_range_ctx;					// state of a range search
+
+//----------------------------------------------------------------------
+//	Search context
+//		Everything a single search needs to share among the recursive
+//		calls (the query point, the error bound, the current k closest
+//		points, etc.) is kept in a search context.  The entry points
+//		(annkSearch(), annkPriSearch() and annkFRSearch()) create one
+//		on the stack and pass it by reference down the tree.  Since
+//		the tree itself is never written during a search, any number
+//		of threads may search the same tree at the same time, each
+//		with its own context.
+//
+//		Not all fields are used by all searches.  The box queue is
+//		used only by priority search, and the squared radius and the
+//		count of points in range only by fixed-radius search.  The
+//		cells of the query point are only computed if the tree has
+//		quantized leaf codes (see kd_leaf_quant.h).
+//----------------------------------------------------------------------
+
+class ANNkd_search_ctx {				// state of one search
+public:
+	int					dim;			// dimension of space
+	ANNpoint			q;				// query point
+	double				max_err;		// max tolerable squared error
+	ANNpointArray		pts;			// the points
+	ANNmink				*point_mk;		// set of k closest points
+	ANNpr_queue			*box_pq;		// priority queue for boxes
+	ANNdist				sq_rad;			// squared radius search bound
+	int					pts_in_range;	// number of points in the range
+	int					max_pts_visit;	// max points to visit (0 = no limit)
+	int					pts_visited;	// number of points visited
+	const ANNleaf_quant	*quant;			// quantizer of leaf codes (or NULL)
+	const int			*q_code;		// cells of query point (or NULL)
+
+	ANNkd_search_ctx(					// constructor
+		int				dd,				// dimension of space
+		ANNpoint		qq,				// query point
+		ANNpointArray	pa,				// the points
+		double			eps)			// the error bound
+		{
+			dim				= dd;
+			q				= qq;
+			pts				= pa;
+			max_err			= ANN_POW(1.0 + eps);
+			point_mk		= NULL;
+			box_pq			= NULL;
+			sq_rad			= 0;
+			pts_in_range	= 0;
+			max_pts_visit	= ANNmaxPtsVisited;
+			pts_visited		= 0;
+			quant			= NULL;
+			q_code			= NULL;
+		}
+
+	void set_quant(						// quantize the query point
+		const ANNleaf_quant	*lq,		// the quantizer
+		int				*qc);			// room for the cells (dim)
+
+	ANNbool visit_limit()				// exceeded max points to visit?
+		{ return (ANNbool) (max_pts_visit != 0 && pts_visited > max_pts_visit); }
+};
+
 //----------------------------------------------------------------------
 //	Generic kd-tree node
 //
@@ -47,9 +125,14 @@ class ANNkd_node{						// generic kd-tree node (empty shell)
 public:
 	virtual ~ANNkd_node() {}					// virtual distroyer
 
-	virtual void ann_search(ANNdist) = 0;		// tree search
-	virtual void ann_pri_search(ANNdist) = 0;	// priority search
-	virtual void ann_FR_search(ANNdist) = 0;	// fixed-radius search
+												// tree search
+	virtual void ann_search(ANNdist, ANNkd_search_ctx&) = 0;
+												// priority search
+	virtual void ann_pri_search(ANNdist, ANNkd_search_ctx&) = 0;
+												// fixed-radius search
+	virtual void ann_FR_search(ANNdist, ANNkd_search_ctx&) = 0;
+												// orthogonal range search
+	virtual void ann_range_search(ANNkd_range_ctx&) = 0;
 
 	virtual void getStats(						// get tree statistics
 				int dim,						// dimension of space
@@ -58,6 +141,18 @@ public:
 												// print node
 	virtual void print(int level, ostream &out) = 0;
 	virtual void dump(ostream &out) = 0;		// dump node
+												// append to flat tree
+	virtual void flatten(ANNflat_build &fb) = 0;
+												// set leaf coord blocks
+	virtual void fill_coords(ANNpointArray pa, int dim,
+				ANNidxArray pidx, ANNcoord *block) = 0;
+												// set leaf code blocks
+	virtual void fill_codes(ANNleaf_quant &lq, ANNpointArray pa,
+				ANNidxArray pidx) = 0;
+												// set leaves of points
+	virtual void fill_leaves(ANNkd_leaf **leaf_of) = 0;
+												// set subtree counts
+	virtual int fill_counts() = 0;
 
 	friend class ANNkd_tree;					// allow kd-tree to access us
 };
@@ -86,12 +181,19 @@ typedef void (*ANNkd_splitter)(			// splitting routine for kd-trees
 //		are indices in the array points, which resides with the
 //		root of the kd-tree.  We also store the number of points
 //		that reside in this bucket.
+//
+//		If the tree has leaf coordinate blocks, coords points to the
+//		block of this leaf (see kd_leaf_scan.h).  Otherwise it is NULL.
+//		Likewise, if the tree has quantized leaf codes, codes points
+//		to the code block of this leaf (see kd_leaf_quant.h).
 //----------------------------------------------------------------------
 
 class ANNkd_leaf: public ANNkd_node		// leaf node for kd-tree
 {
 	int					n_pts;			// no. points in bucket
 	ANNidxArray			bkt;			// bucket of points
+	ANNcoord			*coords;		// coordinate block (or NULL)
+	unsigned char		*codes;			// code block (or NULL)
 public:
 	ANNkd_leaf(							// constructor
 		int				n,				// number of points
@@ -99,6 +201,8 @@ public:
 		{
 			n_pts		= n;			// number of points in bucket
 			bkt			= b;			// the bucket
+			coords		= NULL;			// no coordinate block yet
+			codes		= NULL;			// no code block yet
 		}
 
 	~ANNkd_leaf() { }					// destructor (none)
@@ -109,10 +213,30 @@ public:
 				ANNorthRect &bnd_box);			// bounding box
 	virtual void print(int level, ostream &out);// print node
 	virtual void dump(ostream &out);			// dump node
+												// append to flat tree
+	virtual void flatten(ANNflat_build &fb);
+												// set leaf coord blocks
+	virtual void fill_coords(ANNpointArray pa, int dim,
+				ANNidxArray pidx, ANNcoord *block);
+												// set leaf code blocks
+	virtual void fill_codes(ANNleaf_quant &lq, ANNpointArray pa,
+				ANNidxArray pidx);
+												// set leaves of points
+	virtual void fill_leaves(ANNkd_leaf **leaf_of);
+												// set subtree counts
+	virtual int fill_counts();
+												// remove a point
+	ANNbool remove(ANNidx i, ANNpointArray pa, int dim,
+				ANNleaf_quant *lq);
 
-	virtual void ann_search(ANNdist);			// standard search
-	virtual void ann_pri_search(ANNdist);		// priority search
-	virtual void ann_FR_search(ANNdist);		// fixed-radius search
+												// standard search
+	virtual void ann_search(ANNdist, ANNkd_search_ctx&);
+												// priority search
+	virtual void ann_pri_search(ANNdist, ANNkd_search_ctx&);
+												// fixed-radius search
+	virtual void ann_FR_search(ANNdist, ANNkd_search_ctx&);
+												// orthogonal range search
+	virtual void ann_range_search(ANNkd_range_ctx&);
 };
 
 //----------------------------------------------------------------------
@@ -136,12 +260,15 @@ extern ANNkd_leaf *KD_TRIVIAL;					// trivial (empty) leaf node
 //		cutting dimension is maintained (this is used to speed up point
 //		to box distance calculations) [we do not store the entire bounding
 //		box since this may be wasteful of space in high dimensions].
-//		We also store pointers to the 2 children.
+//		We also store pointers to the 2 children, and the number of
+//		points in the subtree, which is set by fill_counts() once the
+//		tree is built and is used to answer range counts.
 //----------------------------------------------------------------------
 
 class ANNkd_split : public ANNkd_node	// splitting node of a kd-tree
 {
 	int					cut_dim;		// dim orthogonal to cutting plane
+	int					n_sub;			// no. points in subtree
 	ANNcoord			cut_val;		// location of cutting plane
 	ANNcoord			cd_bnds[2];		// lower and upper bounds of
 										// rectangle along cut_dim
@@ -154,6 +281,7 @@ public:
 		ANNkd_ptr lc=NULL, ANNkd_ptr hc=NULL)	// children
 		{
 			cut_dim		= cd;					// cutting dimension
+			n_sub		= 0;					// not counted yet
 			cut_val		= cv;					// cutting value
 			cd_bnds[ANN_LO] = lv;				// lower bound for rectangle
 			cd_bnds[ANN_HI] = hv;				// upper bound for rectangle
@@ -175,10 +303,27 @@ public:
 				ANNorthRect &bnd_box);			// bounding box
 	virtual void print(int level, ostream &out);// print node
 	virtual void dump(ostream &out);			// dump node
+												// append to flat tree
+	virtual void flatten(ANNflat_build &fb);
+												// set leaf coord blocks
+	virtual void fill_coords(ANNpointArray pa, int dim,
+				ANNidxArray pidx, ANNcoord *block);
+												// set leaf code blocks
+	virtual void fill_codes(ANNleaf_quant &lq, ANNpointArray pa,
+				ANNidxArray pidx);
+												// set leaves of points
+	virtual void fill_leaves(ANNkd_leaf **leaf_of);
+												// set subtree counts
+	virtual int fill_counts();
 
-	virtual void ann_search(ANNdist);			// standard search
-	virtual void ann_pri_search(ANNdist);		// priority search
-	virtual void ann_FR_search(ANNdist);		// fixed-radius search
+												// standard search
+	virtual void ann_search(ANNdist, ANNkd_search_ctx&);
+												// priority search
+	virtual void ann_pri_search(ANNdist, ANNkd_search_ctx&);
+												// fixed-radius search
+	virtual void ann_FR_search(ANNdist, ANNkd_search_ctx&);
+												// orthogonal range search
+	virtual void ann_range_search(ANNkd_range_ctx&);
 };
 
 //----------------------------------------------------------------------
@@ -194,4 +339,15 @@ ANNkd_ptr rkd_tree(				// recursive construction of kd-tree
 	ANNorthRect			&bnd_box,		// bounding box for current node
 	ANNkd_splitter		splitter);		// splitting routine
 
+ANNkd_ptr presort_kd_tree(		// construction from presorted points
+	ANNpointArray		pa,				// point array (unaltered)
+	ANNidxArray			pidx,			// point indices to store in tree
+	int					n,				// number of points
+	int					dim,			// dimension of space
+	int					bsp,			// bucket space
+	ANNorthRect			&bnd_box,		// bounding box for points
+	ANNsplitRule		split);			// splitting rule (see kd_presort.cpp)
+
+ANN_END_NAMESPACE
+
 #endif
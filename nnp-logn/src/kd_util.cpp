@@ -20,12 +20,23 @@
 // History:
 //	Revision 0.1  03/04/98
 //		Initial release
+//	Revision 1.2
+//		Large scans and partitions are done in parallel when building
+//		with a thread pool (see kd_par_build.h)
+//		Spreads and medians of large nodes may be estimated from
+//		samples (see annBuildSample())
 //----------------------------------------------------------------------
 
+#include <algorithm>					// nth_element
+#include <vector>						// sample values
+
 #include "kd_util.h"					// kd-utility declarations
+#include "kd_par_build.h"				// parallel construction
 
 #include <ANN/ANNperf.h>				// performance evaluation
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 // The following routines are utility functions for manipulating
 // points sets, used in determining splitting planes for kd-tree
@@ -43,6 +54,37 @@
 										// accessing a single point
 #define PP(i)			(pa[pidx[(i)]])
 
+//----------------------------------------------------------------------
+//	Sampling
+//		If ANNbuildSample is positive (see annBuildSample()), the
+//		spreads of nodes of more than ANN_SAMPLE_RATIO times that many
+//		points are computed over a sample of ANNbuildSample of their
+//		points, and so are their medians (see annSampleMedianSplit()).
+//		Only the bounds used to slide cuts (annMinMax) and the tests
+//		of balance (annSplitBalance) remain exact, so every rule still
+//		makes valid splits.  The j-th point of the sample is the one
+//		at a position in pidx given by a hash of j, so the sample is
+//		the same for every dimension, and the tree is the same from
+//		one build to the next, whatever the number of threads.
+//----------------------------------------------------------------------
+
+const int ANN_SAMPLE_RATIO = 4;			// min ratio of points to sample
+
+inline ANNbool annUseSample(int n)		// estimate for n points?
+{
+	return (ANNbuildSample > 0 && n / ANN_SAMPLE_RATIO > ANNbuildSample)
+		? ANNtrue : ANNfalse;
+}
+
+inline int annSamplePos(int j, int n)	// position of j-th sample point
+{
+	unsigned int h = (unsigned int) j * 2654435761u;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	return (int) (((unsigned long long) h * (unsigned int) n) >> 32);
+}
+
 //----------------------------------------------------------------------
 //	annAspectRatio
 //		Compute the aspect ratio (ratio of longest to shortest side)
@@ -67,7 +109,9 @@ double annAspectRatio(
 //----------------------------------------------------------------------
 //	annEnclRect, annEnclCube
 //		These utilities compute the smallest rectangle and cube enclosing
-//		a set of points, respectively.
+//		a set of points, respectively.  The points are read one at a
+//		time, all their coordinates at once, which in high dimensions
+//		is much faster than scanning the points once per dimension.
 //----------------------------------------------------------------------
 
 void annEnclRect(
@@ -77,15 +121,21 @@ void annEnclRect(
 	int					dim,			// dimension
 	ANNorthRect			&bnds)			// bounding cube (returned)
 {
-	for (int d = 0; d < dim; d++) {		// find smallest enclosing rectangle
-		ANNcoord lo_bnd = PA(0,d);		// lower bound on dimension d
-		ANNcoord hi_bnd = PA(0,d);		// upper bound on dimension d
-		for (int i = 0; i < n; i++) {
-			if (PA(i,d) < lo_bnd) lo_bnd = PA(i,d);
-			else if (PA(i,d) > hi_bnd) hi_bnd = PA(i,d);
+	ANNthread_pool *pool = annBuildPool();
+	if (pool != NULL && n >= ANN_PAR_SCAN) {	// large: scan in parallel
+		annParEnclRect(pool, pa, pidx, n, dim, bnds);
+		return;
+	}
+	int d;
+	for (d = 0; d < dim; d++) {			// start with the first point
+		bnds.lo[d] = bnds.hi[d] = PA(0,d);
+	}
+	for (int i = 1; i < n; i++) {		// find smallest enclosing rectangle
+		ANNpoint p = PP(i);
+		for (d = 0; d < dim; d++) {
+			if (p[d] < bnds.lo[d]) bnds.lo[d] = p[d];
+			else if (p[d] > bnds.hi[d]) bnds.hi[d] = p[d];
 		}
-		bnds.lo[d] = lo_bnd;
-		bnds.hi[d] = hi_bnd;
 	}
 }
 
@@ -145,6 +195,38 @@ ANNdist annBoxDistance(			// compute distance from point to box
 	return dist;
 }
 
+//----------------------------------------------------------------------
+//	annSampleEnclRect - rectangle enclosing the points or a sample
+//		Computes the smallest rectangle enclosing the points, or, if
+//		their number calls for it, the points of the sample (which is
+//		an estimate of it).
+//----------------------------------------------------------------------
+
+void annSampleEnclRect(
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension
+	ANNorthRect			&bnds)			// bounding rectangle (returned)
+{
+	if (!annUseSample(n)) {				// use all the points
+		annEnclRect(pa, pidx, n, dim, bnds);
+		return;
+	}
+	ANNpoint p = PP(annSamplePos(0, n));
+	int d;
+	for (d = 0; d < dim; d++) {
+		bnds.lo[d] = bnds.hi[d] = p[d];
+	}
+	for (int j = 1; j < ANNbuildSample; j++) {
+		p = PP(annSamplePos(j, n));
+		for (d = 0; d < dim; d++) {
+			if (p[d] < bnds.lo[d]) bnds.lo[d] = p[d];
+			else if (p[d] > bnds.hi[d]) bnds.hi[d] = p[d];
+		}
+	}
+}
+
 //----------------------------------------------------------------------
 //	annSpread - find spread along given dimension
 //	annMinMax - find min and max coordinates along given dimension
@@ -157,6 +239,22 @@ ANNcoord annSpread(				// compute point spread along dimension
 	int					n,				// number of points
 	int					d)				// dimension to check
 {
+	if (annUseSample(n)) {				// estimate from a sample
+		ANNcoord min = PA(annSamplePos(0, n), d);
+		ANNcoord max = min;
+		for (int j = 1; j < ANNbuildSample; j++) {
+			ANNcoord c = PA(annSamplePos(j, n), d);
+			if (c < min) min = c;
+			else if (c > max) max = c;
+		}
+		return (max - min);
+	}
+	ANNthread_pool *pool = annBuildPool();
+	if (pool != NULL && n >= ANN_PAR_SCAN) {	// large: scan in parallel
+		ANNcoord min, max;
+		annParMinMax(pool, pa, pidx, n, d, min, max);
+		return (max - min);
+	}
 	ANNcoord min = PA(0,d);				// compute max and min coords
 	ANNcoord max = PA(0,d);
 	for (int i = 1; i < n; i++) {
@@ -175,6 +273,11 @@ void annMinMax(					// compute min and max coordinates along dim
 	ANNcoord			&min,			// minimum value (returned)
 	ANNcoord			&max)			// maximum value (returned)
 {
+	ANNthread_pool *pool = annBuildPool();
+	if (pool != NULL && n >= ANN_PAR_SCAN) {	// large: scan in parallel
+		annParMinMax(pool, pa, pidx, n, d, min, max);
+		return;
+	}
 	min = PA(0,d);						// compute max and min coords
 	max = PA(0,d);
 	for (int i = 1; i < n; i++) {
@@ -195,8 +298,10 @@ int annMaxSpread(						// compute dimension of max spread
 
 	if (n == 0) return max_dim;			// no points, who cares?
 
+	ANNorthRect bnds(dim);				// bounds of points (or sample)
+	annSampleEnclRect(pa, pidx, n, dim, bnds);
 	for (int d = 0; d < dim; d++) {		// compute spread along each dim
-		ANNcoord spr = annSpread(pa, pidx, n, d);
+		ANNcoord spr = bnds.hi[d] - bnds.lo[d];
 		if (spr > max_spr) {			// bigger than current max
 			max_spr = spr;
 			max_dim = d;
@@ -274,6 +379,50 @@ void annMedianSplit(
 	cv = (PA(n_lo-1,d) + PA(n_lo,d))/2.0;
 }
 
+//----------------------------------------------------------------------
+//	annSampleMedianSplit - split point array about an estimated median
+//		If the spreads of n points are estimated from a sample (see
+//		annUseSample() above), this splits the points about the median
+//		of the sample along dimension d, provided it lies in the range
+//		[lo_cv, hi_cv] (the split rule's limits).  The points equal to
+//		the cutting value are divided between the sides so that n_lo
+//		is as close to n/2 as possible, and since the cutting value is
+//		a coordinate of one of the points, 0 < n_lo < n.  Otherwise it
+//		splits them exactly about the median, as annMedianSplit, with
+//		n_lo = n/2.
+//----------------------------------------------------------------------
+
+void annSampleMedianSplit(
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension along which to split
+	ANNcoord			lo_cv,			// lowest allowed cutting value
+	ANNcoord			hi_cv,			// highest allowed cutting value
+	ANNcoord			&cv,			// cutting value (returned)
+	int					&n_lo)			// number of points below (returned)
+{
+	if (annUseSample(n)) {				// median of a sample
+		std::vector<ANNcoord> val(ANNbuildSample);
+		for (int j = 0; j < ANNbuildSample; j++) {
+			val[j] = PA(annSamplePos(j, n), d);
+		}
+		int m = ANNbuildSample/2;
+		std::nth_element(val.begin(), val.begin() + m, val.end());
+		if (val[m] >= lo_cv && val[m] <= hi_cv) {
+			int br1, br2;
+			cv = val[m];
+			annPlaneSplit(pa, pidx, n, d, cv, br1, br2);
+			if (br1 > n/2) n_lo = br1;
+			else if (br2 < n/2) n_lo = br2;
+			else n_lo = n/2;
+			return;
+		}
+	}
+	n_lo = n/2;							// exact median
+	annMedianSplit(pa, pidx, n, d, cv, n_lo);
+}
+
 //----------------------------------------------------------------------
 //	annPlaneSplit - split point array about a cutting plane
 //		Split the points in an array about a given plane along a
@@ -297,6 +446,13 @@ void annPlaneSplit(				// split points by a plane
 	int					&br1,			// first break (values < cv)
 	int					&br2)			// second break (values == cv)
 {
+	ANNthread_pool *pool = annBuildPool();
+	if (pool != NULL && n >= ANN_PAR_SCAN) {	// large: partition in parallel
+		br1 = annParPlaneSplit(pool, pa, pidx, n, d, cv, ANNtrue);
+		br2 = br1 + annParPlaneSplit(pool, pa, pidx + br1, n - br1,
+				d, cv, ANNfalse);
+		return;
+	}
 	int l = 0;
 	int r = n-1;
 	for(;;) {							// partition pa[0..n-1] about cv
@@ -337,6 +493,11 @@ void annBoxSplit(				// split points by a box
 	ANNorthRect			&box,			// the box
 	int					&n_in)			// number of points inside (returned)
 {
+	ANNthread_pool *pool = annBuildPool();
+	if (pool != NULL && n >= ANN_PAR_SCAN) {	// large: partition in parallel
+		n_in = annParBoxSplit(pool, pa, pidx, n, dim, box);
+		return;
+	}
 	int l = 0;
 	int r = n-1;
 	for(;;) {							// partition pa[0..n-1] about box
@@ -437,3 +598,5 @@ void annBnds2Box(
 		bnds[i].project(inner_box.hi);
 	}
 }
+
+ANN_END_NAMESPACE
@@ -27,6 +27,8 @@
 
 #include "kd_tree.h"					// kd-tree declarations
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	externally accessible functions
 //----------------------------------------------------------------------
@@ -49,6 +51,13 @@ void annEnclCube(				// compute smallest enclosing cube
 	int					dim,			// dimension
 	ANNorthRect &bnds);					// bounding cube (returned)
 
+void annSampleEnclRect(			// enclosing rectangle (or estimate)
+	ANNpointArray		pa,				// point array
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					dim,			// dimension
+	ANNorthRect &bnds);					// bounding rectangle (returned)
+
 ANNdist annBoxDistance(			// compute distance from point to box
 	const ANNpoint		q,				// the point
 	const ANNpoint		lo,				// low point of box
@@ -83,6 +92,16 @@ void annMedianSplit(			// split points along median value
 	ANNcoord			&cv,			// cutting value
 	int					n_lo);			// split into n_lo and n-n_lo
 
+void annSampleMedianSplit(		// split points near median value
+	ANNpointArray		pa,				// points to split
+	ANNidxArray			pidx,			// point indices
+	int					n,				// number of points
+	int					d,				// dimension along which to split
+	ANNcoord			lo_cv,			// lowest allowed cutting value
+	ANNcoord			hi_cv,			// highest allowed cutting value
+	ANNcoord			&cv,			// cutting value (returned)
+	int					&n_lo);			// number of points below (returned)
+
 void annPlaneSplit(				// split points by a plane
 	ANNpointArray		pa,				// points to split
 	ANNidxArray			pidx,			// point indices
@@ -121,4 +140,6 @@ void annBnds2Box(				// convert bounds to inner box
 	ANNorthHSArray		bnds,			// bounds array
 	ANNorthRect			&inner_box);	// inner box (returned)
 
+ANN_END_NAMESPACE
+
 #endif
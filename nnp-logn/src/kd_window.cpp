@@ -0,0 +1,467 @@
+//----------------------------------------------------------------------
+// File:			kd_window.cpp
+// Programmer:		NNP contributors
+// Description:		Sliding windows of point streams
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include <algorithm>					// heap operations
+#include <deque>						// indices and times of points
+#include <functional>					// greater
+#include <vector>						// blocks and pairs
+
+#include <ANN/ANNx.h>					// all ANN includes
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	The forest
+//		Every point gets a sequence number, in order of arrival, and
+//		since points leave in the same order, the points in the
+//		window are those numbered from oldest to next-1.  They are
+//		divided into blocks of consecutive numbers, oldest first,
+//		each with its own copy of its points and (unless it has fewer
+//		than ANN_WINDOW_MIN_TREE points, which are simply scanned) a
+//		kd-tree over them.  The indices and times of the points are
+//		kept in order of arrival, apart from the blocks.
+//
+//		A new point becomes a block of its own, which is merged with
+//		the newest blocks as long as they are no larger than it, so
+//		that the block sizes follow the binary digits of the number of
+//		points that have arrived, and each point is copied O(log n)
+//		times.  When some of the points of the oldest block leave, its
+//		remaining points are split into pieces of 1, 2, 4, ... points,
+//		the smallest oldest, so that each point is split off O(log n)
+//		times before it leaves.  Pieces are never merged.  Every block
+//		thus holds only points in the window, and searches need not
+//		check whether the points they find are still there.
+//
+//		The closest pair is found from the pairs of each point and
+//		its nearest neighbor (at the time it was found), kept in a
+//		min-heap by distance.  The nearest neighbor of the newer point
+//		of the closest pair is at least as close as the other point,
+//		which was in the window whenever it was searched for, so if
+//		both points of the pair at the top of the heap are still in
+//		the window, that pair is the closest pair.  If only its first
+//		point is, a new nearest neighbor is found for it, and if
+//		neither is, it is discarded.  Pairs of points that have left
+//		are also removed whenever they make up half the heap.
+//----------------------------------------------------------------------
+
+typedef long long ANNseq;				// sequence number of a point
+
+const int ANN_WINDOW_MIN_TREE = 64;		// min points of a block with a tree
+
+struct ANNwindow_block {				// a block of points
+	ANNseq				first;			// number of first point
+	int					n;				// number of points
+	ANNbool				piece;			// split from an older block?
+	ANNpointArray		pts;			// the points
+	ANNkd_tree			*tree;			// tree of the points (or NULL)
+};
+
+struct ANNwindow_pair {					// a point and a near neighbor
+	ANNdist				dist;			// squared distance
+	ANNseq				p, q;			// the points
+
+	bool operator>(const ANNwindow_pair &a) const	// order by distance
+		{ return dist > a.dist; }
+};
+
+struct ANNwindow_nn {					// a near neighbor
+	ANNdist				dist;			// squared distance
+	ANNseq				p;				// the point
+};
+
+struct ANNwindow_data {
+	std::vector<ANNwindow_block*> blocks;	// the blocks, oldest first
+	std::deque<ANNidx>	idx;			// indices of the points
+	std::deque<double>	times;			// times of the points
+	ANNseq				oldest;			// number of oldest point
+	ANNseq				next;			// number of next new point
+	ANNseq				paired;			// first point without a pair
+	std::vector<ANNwindow_pair> pairs;	// near pairs (a min-heap)
+
+	int find(ANNseq p);					// block holding a point
+	ANNpoint point(ANNseq p)			// coordinates of a point
+		{ ANNwindow_block *b = blocks[find(p)]; return b->pts[p - b->first]; }
+};
+
+int ANNwindow_data::find(ANNseq p)		// block holding a point
+{
+	int lo = 0, hi = (int) blocks.size() - 1;
+	while (lo < hi) {					// last block with first <= p
+		int mid = (lo + hi + 1) / 2;
+		if (blocks[mid]->first <= p) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+//----------------------------------------------------------------------
+//	Block utilities
+//		new_block allocates a block for the points numbered from first
+//		to first+n-1, copying their coordinates from the blocks now
+//		holding them, and builds its tree.
+//----------------------------------------------------------------------
+
+static void copy_coords(				// copy a point's coordinates
+	int					dim,			// dimension of space
+	ANNpoint			dst,			// destination
+	ANNpoint			src)			// source
+{
+	for (int d = 0; d < dim; d++) dst[d] = src[d];
+}
+
+static ANNwindow_block *new_block(		// make a block
+	ANNwindow_data		*data,			// the forest
+	int					dim,			// dimension of space
+	ANNseq				first,			// number of first point
+	int					n,				// number of points
+	ANNbool				piece)			// split from an older block?
+{
+	ANNwindow_block *b = new ANNwindow_block;
+	b->first = first;
+	b->n = n;
+	b->piece = piece;
+	b->pts = annAllocPts(n, dim);
+	for (int i = 0; i < n; i++) {
+		copy_coords(dim, b->pts[i], data->point(first + i));
+	}
+	b->tree = (n < ANN_WINDOW_MIN_TREE ? NULL : new ANNkd_tree(b->pts, n, dim));
+	return b;
+}
+
+static void delete_block(				// delete a block
+	ANNwindow_block		*b)				// the block
+{
+	delete b->tree;
+	annDeallocPts(b->pts);
+	delete b;
+}
+
+//----------------------------------------------------------------------
+//	Searching
+//		search finds the k nearest neighbors of a point among the
+//		points of the window, other than the point numbered skip, by
+//		searching each block and keeping the k closest results, in
+//		order of increasing distance.  The largest block is searched
+//		first, and once k results have been found, the other trees
+//		are given a fixed-radius search, with the k-th distance so far
+//		as the radius, which visits far fewer nodes.
+//----------------------------------------------------------------------
+
+static void search(						// k nearest neighbors
+	ANNwindow_data		*data,			// the forest
+	int					dim,			// dimension of space
+	ANNpoint			q,				// query point
+	int					k,				// number of near neighbors
+	ANNseq				skip,			// point to skip (or -1)
+	double				eps,			// error bound
+	std::vector<ANNwindow_nn> &nn)		// the near neighbors (returned)
+{
+	nn.clear();
+	std::vector<ANNidx> b_idx(k+1);		// results of one block
+	std::vector<ANNdist> b_dd(k+1);
+
+	int n_blocks = (int) data->blocks.size();
+	int big = 0;						// the largest block
+	for (int i = 1; i < n_blocks; i++) {
+		if (data->blocks[i]->n > data->blocks[big]->n) big = i;
+	}
+
+	for (int i = 0; i < n_blocks; i++) {
+		ANNwindow_block *b = data->blocks[i == 0 ? big : (i == big ? 0 : i)];
+		int m;
+		if (b->tree != NULL) {			// search its tree
+			ANNbool has_skip = (skip >= b->first && skip < b->first + b->n)
+				? ANNtrue : ANNfalse;
+			m = (has_skip ? k+1 : k);
+			if (m > b->n) m = b->n;
+			if ((int) nn.size() < k) {
+				b->tree->annkSearch(q, m, &b_idx[0], &b_dd[0], eps);
+			}
+			else {						// only closer than the k-th
+				int in = b->tree->annkFRSearch(q, nn.back().dist, m,
+						&b_idx[0], &b_dd[0], eps);
+				if (in < m) m = in;
+			}
+		}
+		else {							// scan its points
+			m = b->n;
+			if ((int) b_idx.size() < m) {
+				b_idx.resize(m);
+				b_dd.resize(m);
+			}
+			for (int j = 0; j < m; j++) {
+				b_idx[j] = j;
+				b_dd[j] = annDist(dim, q, b->pts[j]);
+			}
+		}
+		for (int j = 0; j < m; j++) {	// insert into the k closest
+			ANNwindow_nn a;
+			a.dist = b_dd[j];
+			a.p = b->first + b_idx[j];
+			if (a.p == skip) continue;
+			if ((int) nn.size() == k && !(a.dist < nn.back().dist)) continue;
+			if ((int) nn.size() == k) nn.pop_back();
+			int pos = (int) nn.size();
+			nn.push_back(a);
+			while (pos > 0 && a.dist < nn[pos-1].dist) {
+				nn[pos] = nn[pos-1];
+				pos--;
+			}
+			nn[pos] = a;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	Constructor and destructor
+//----------------------------------------------------------------------
+
+ANNwindow::ANNwindow(
+	int					dd,				// dimension
+	int					mp,				// max points in window (0 = any)
+	double				ma)				// max age of points (0 = any)
+{
+	dim = dd;
+	max_pts = mp;
+	max_age = ma;
+	data = new ANNwindow_data;
+	data->oldest = 0;
+	data->next = 0;
+	data->paired = 0;
+}
+
+ANNwindow::~ANNwindow()
+{
+	for (size_t i = 0; i < data->blocks.size(); i++) {
+		delete_block(data->blocks[i]);
+	}
+	delete data;
+}
+
+int ANNwindow::nPoints()				// return number of points
+{
+	return (int) (data->next - data->oldest);
+}
+
+int ANNwindow::nTrees()					// return number of trees
+{
+	int n = 0;
+	for (size_t i = 0; i < data->blocks.size(); i++) {
+		if (data->blocks[i]->tree != NULL) n++;
+	}
+	return n;
+}
+
+//----------------------------------------------------------------------
+//	remove_before - remove the points numbered less than cut
+//		Blocks of points that have all left are deleted, and the rest
+//		of a block that some of its points have left is split into
+//		pieces.  Pairs of points that have left are removed from the
+//		heap when they make up more than half of it.
+//----------------------------------------------------------------------
+
+static void remove_before(				// remove old points
+	ANNwindow_data		*data,			// the forest
+	int					dim,			// dimension of space
+	ANNseq				cut)			// number of first point to keep
+{
+	if (cut <= data->oldest) return;
+	std::vector<ANNwindow_block*> &bl = data->blocks;
+	int gone = 0;						// blocks that have left
+	while (gone < (int) bl.size() && bl[gone]->first + bl[gone]->n <= cut) {
+		delete_block(bl[gone++]);
+	}
+	bl.erase(bl.begin(), bl.begin() + gone);
+
+	if (!bl.empty() && bl[0]->first < cut) {	// split the oldest block
+		ANNwindow_block *b = bl[0];
+		std::vector<ANNwindow_block*> pieces;
+		ANNseq first = cut, end = b->first + b->n;
+		for (int size = 1; first < end; size *= 2) {
+			int n = (end - first < size ? (int) (end - first) : size);
+			pieces.push_back(new_block(data, dim, first, n, ANNtrue));
+			first += n;
+		}
+		delete_block(b);
+		bl.erase(bl.begin());
+		bl.insert(bl.begin(), pieces.begin(), pieces.end());
+	}
+
+	for (ANNseq s = data->oldest; s < cut; s++) {
+		data->idx.pop_front();
+		data->times.pop_front();
+	}
+	data->oldest = cut;
+
+	std::vector<ANNwindow_pair> &pr = data->pairs;
+	if (pr.size() > 2 * (size_t) (data->next - cut) + 16) {
+		size_t k = 0;					// keep pairs still in the window
+		for (size_t i = 0; i < pr.size(); i++) {
+			if (pr[i].p >= cut) pr[k++] = pr[i];
+		}
+		pr.resize(k);
+		std::make_heap(pr.begin(), pr.end(), std::greater<ANNwindow_pair>());
+	}
+}
+
+//----------------------------------------------------------------------
+//	insert - add a point
+//		The new point is merged with the newest blocks (other than
+//		pieces) that are no larger than the points merged so far, into
+//		a single new block.  Then old points leave, if there are too
+//		many or they are too old.
+//----------------------------------------------------------------------
+
+void ANNwindow::insert(
+	ANNpoint			p,				// the point (copied)
+	ANNidx				idx,			// its index
+	double				time)			// its time
+{
+	if (!data->times.empty() && time < data->times.back()) {
+		annError("Points must be inserted in order of time", ANNabort);
+	}
+	ANNwindow_block *b = new ANNwindow_block;	// the point's own block
+	b->first = data->next++;
+	b->n = 1;
+	b->piece = ANNfalse;
+	b->pts = annAllocPts(1, dim);
+	copy_coords(dim, b->pts[0], p);
+	b->tree = NULL;
+	data->blocks.push_back(b);
+	data->idx.push_back(idx);
+	data->times.push_back(time);
+
+	int last = (int) data->blocks.size() - 1;	// blocks to merge
+	int i = last, n = 1;
+	while (i > 0 && !data->blocks[i-1]->piece && data->blocks[i-1]->n <= n) {
+		n += data->blocks[--i]->n;
+	}
+	if (i < last) {						// merge blocks i..last
+		ANNwindow_block *m = new_block(data, dim,
+				data->blocks[i]->first, n, ANNfalse);
+		for (int j = i; j <= last; j++) {
+			delete_block(data->blocks[j]);
+		}
+		data->blocks.resize(i);
+		data->blocks.push_back(m);
+	}
+
+	if (max_age > 0) {					// too old?
+		expire(time - max_age);
+	}
+	if (max_pts > 0 && nPoints() > max_pts) {	// too many?
+		remove_before(data, dim, data->next - max_pts);
+	}
+}
+
+//----------------------------------------------------------------------
+//	expire - remove the points before a given time
+//----------------------------------------------------------------------
+
+void ANNwindow::expire(
+	double				time)			// remove points before this time
+{
+	ANNseq keep = std::lower_bound(data->times.begin(), data->times.end(), time)
+			- data->times.begin();
+	remove_before(data, dim, data->oldest + keep);
+}
+
+//----------------------------------------------------------------------
+//	annkSearch - k nearest neighbors of a query point
+//----------------------------------------------------------------------
+
+void ANNwindow::annkSearch(
+	ANNpoint			q,				// query point
+	int					k,				// number of near neighbors
+	ANNidxArray			nn_idx,			// nearest neighbor indices (returned)
+	ANNdistArray		dd,				// the approximate nearest neighbor
+	double				eps)			// the error bound
+{
+	if (k > nPoints()) {
+		annError("Requesting more near neighbors than data points", ANNabort);
+	}
+	std::vector<ANNwindow_nn> nn;
+	search(data, dim, q, k, -1, eps, nn);
+	for (int i = 0; i < k; i++) {
+		nn_idx[i] = data->idx[(size_t) (nn[i].p - data->oldest)];
+		dd[i] = nn[i].dist;
+	}
+}
+
+//----------------------------------------------------------------------
+//	closestPair - the closest pair of points in the window
+//		Points that have arrived since the last call are paired with
+//		their nearest neighbors first.  Then pairs are taken from the
+//		top of the heap until one whose points are both still in the
+//		window is found.
+//----------------------------------------------------------------------
+
+static void pair_point(						// pair a point with its neighbor
+	ANNwindow_data		*data,			// the forest
+	int					dim,			// dimension of space
+	ANNseq				p,				// the point
+	std::vector<ANNwindow_nn> &nn)		// work space
+{
+	if (data->next - data->oldest < 2) return;	// nothing to pair with
+	search(data, dim, data->point(p), 1, p, 0.0, nn);
+	ANNwindow_pair pr;
+	pr.dist = nn[0].dist;
+	pr.p = p;
+	pr.q = nn[0].p;
+	data->pairs.push_back(pr);
+	std::push_heap(data->pairs.begin(), data->pairs.end(),
+			std::greater<ANNwindow_pair>());
+}
+
+ANNbool ANNwindow::closestPair(
+	ANNidx				&idx1,			// older point (returned)
+	ANNidx				&idx2,			// newer point (returned)
+	ANNdist				&dist)			// squared distance (returned)
+{
+	std::vector<ANNwindow_nn> nn;
+	std::vector<ANNwindow_pair> &pr = data->pairs;
+	std::greater<ANNwindow_pair> cmp;
+
+	if (data->paired < data->oldest) data->paired = data->oldest;
+	for ( ; data->paired < data->next; data->paired++) {
+		pair_point(data, dim, data->paired, nn);
+	}
+
+	while (!pr.empty()) {
+		ANNwindow_pair top = pr[0];
+		if (top.p >= data->oldest && top.q >= data->oldest) {
+			ANNseq a = (top.p < top.q ? top.p : top.q);
+			ANNseq b = (top.p < top.q ? top.q : top.p);
+			idx1 = data->idx[(size_t) (a - data->oldest)];
+			idx2 = data->idx[(size_t) (b - data->oldest)];
+			dist = top.dist;
+			return ANNtrue;
+		}
+		std::pop_heap(pr.begin(), pr.end(), cmp);
+		pr.pop_back();
+		if (top.p >= data->oldest) {	// its neighbor has left
+			pair_point(data, dim, top.p, nn);
+		}
+	}
+	return ANNfalse;
+}
+
+ANN_END_NAMESPACE
@@ -33,6 +33,8 @@
 
 using namespace std;					// make std:: available
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Performance statistics
 //		The following data and routines are used for computing
@@ -134,3 +136,5 @@ DLL_API void annPrintStats(				// print statistics for a run
 	cout << "  )\n";
 	cout.flush();
 }
+
+ANN_END_NAMESPACE
@@ -21,6 +21,8 @@
 // History:
 //	Revision 0.1  03/04/98
 //		Initial release
+//	Revision 1.2
+//		Changed to a 4-ary heap of handles, which grows as needed
 //----------------------------------------------------------------------
 
 #ifndef PR_QUEUE_H
@@ -29,10 +31,12 @@
 #include <ANN/ANNx.h>					// all ANN includes
 #include <ANN/ANNperf.h>				// performance evaluation
 
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Basic types.
 //----------------------------------------------------------------------
-typedef void			*PQinfo;		// info field is generic pointer
+typedef int				PQinfo;			// info field is a handle
 typedef ANNdist			PQkey;			// key field is distance
 
 //----------------------------------------------------------------------
@@ -40,37 +44,91 @@ typedef ANNdist			PQkey;			// key field is distance
 //		A priority queue is a list of items, along with associated
 //		priorities.  The basic operations are insert and extract_minimum.
 //
-//		The priority queue is maintained using a standard binary heap.
-//		(Implementation note: Indexing is performed from [1..max] rather
-//		than the C standard of [0..max-1].  This simplifies parent/child
-//		computations.)  User information consists of a void pointer,
-//		and the user is responsible for casting this quantity into whatever
-//		useful form is desired.
+//		The priority queue is maintained using a 4-ary heap, indexed
+//		from [0..n-1], with the children of item i at 4i+1..4i+4.  A
+//		heap of this shape is half as deep as a binary heap, and
+//		extracting the minimum compares the four children of an item
+//		in a single cache line.  To keep them there, the keys and the
+//		info fields are kept in separate arrays, and the key array is
+//		aligned so that each group of four children starts a 32-byte
+//		block.
+//
+//		User information is a 32-bit handle.  The flattened trees use
+//		node indices.  Trees of pointers may instead insert and
+//		extract void pointers; these are kept in a side array, whose
+//		index is the handle, and the user is responsible for casting
+//		them into whatever useful form is desired.
+//
+//		The arrays grow as needed, rather than being sized to the
+//		number of data points.  They are kept when the queue is
+//		emptied by reset(), so a queue kept from one search to the
+//		next (see search_space.h) soon stops allocating.
 //
 //		Because the priority queue is so central to the efficiency of
 //		query processing, all the code is inline.
 //----------------------------------------------------------------------
 
 class ANNpr_queue {
-
-	struct pq_node {					// node in priority queue
-		PQkey			key;			// key value
-		PQinfo			info;			// info field
-	};
 	int			n;						// number of items in queue
-	int			max_size;				// maximum queue size
-	pq_node		*pq;					// the priority queue (array of nodes)
+	int			max_size;				// size of arrays
+	char		*key_mem;				// memory for keys
+	PQkey		*keys;					// keys of items
+	PQinfo		*infos;					// info fields of items
+	int			n_ptrs;					// number of pointers
+	int			max_ptrs;				// size of pointer array
+	void		**ptrs;					// pointers, by handle
+
+	void grow()							// double the size of the heap
+		{
+			int max = (max_size < 32 ? 64 : 2*max_size);
+			const size_t blk = 4*sizeof(PQkey);	// size of four keys
+			char *km = new char[(max+1)*sizeof(PQkey) + blk];
+			size_t a = (size_t) (km + sizeof(PQkey));	// align item 1
+			a = (a + blk - 1) / blk * blk;
+			PQkey *k = (PQkey *) (a - sizeof(PQkey));
+			PQinfo *inf = new PQinfo[max];
+			for (int i = 0; i < n; i++) {
+				k[i] = keys[i];
+				inf[i] = infos[i];
+			}
+			delete [] key_mem;
+			delete [] infos;
+			key_mem = km;
+			keys = k;
+			infos = inf;
+			max_size = max;
+		}
+
+	void grow_ptrs()					// double the pointer array
+		{
+			int max = (max_ptrs < 32 ? 64 : 2*max_ptrs);
+			void **p = new void*[max];
+			for (int i = 0; i < n_ptrs; i++) p[i] = ptrs[i];
+			delete [] ptrs;
+			ptrs = p;
+			max_ptrs = max;
+		}
 
 public:
-	ANNpr_queue(int max)				// constructor (given max size)
+	ANNpr_queue(int max = 0)			// constructor (initial size)
 		{
 			n = 0;						// initially empty
-			max_size = max;				// maximum number of items
-			pq = new pq_node[max+1];	// queue is array [1..max] of nodes
+			max_size = 0;
+			key_mem = NULL;
+			keys = NULL;
+			infos = NULL;
+			n_ptrs = 0;
+			max_ptrs = 0;
+			ptrs = NULL;
+			while (max_size < max) grow();
 		}
 
 	~ANNpr_queue()						// destructor
-		{ delete [] pq; }
+		{
+			delete [] key_mem;
+			delete [] infos;
+			delete [] ptrs;
+		}
 
 	ANNbool empty()						// is queue empty?
 		{ if (n==0) return ANNtrue; else return ANNfalse; }
@@ -79,47 +137,75 @@ public:
 		{ if (n==0) return ANNfalse; else return ANNtrue; }
 
 	void reset()						// make existing queue empty
-		{ n = 0; }
+		{ n = 0; n_ptrs = 0; }
 
 	inline void insert(					// insert item (inlined for speed)
 		PQkey kv,						// key value
 		PQinfo inf)						// item info
 		{
-			if (++n > max_size) annError("Priority queue overflow.", ANNabort);
-			register int r = n;
-			while (r > 1) {				// sift up new item
-				register int p = r/2;
+			if (n == max_size) grow();
+			register int r = n++;
+			while (r > 0) {				// sift up new item
+				register int p = (r-1) >> 2;
 				ANN_FLOP(1)				// increment floating ops
-				if (pq[p].key <= kv)	// in proper order
+				if (keys[p] <= kv)		// in proper order
 					break;
-				pq[r] = pq[p];			// else swap with parent
+				keys[r] = keys[p];		// else swap with parent
+				infos[r] = infos[p];
 				r = p;
 			}
-			pq[r].key = kv;				// insert new item at final location
-			pq[r].info = inf;
+			keys[r] = kv;				// insert new item at final location
+			infos[r] = inf;
+		}
+
+	inline void insert(					// insert item with pointer info
+		PQkey kv,						// key value
+		void *ptr)						// item info
+		{
+			if (n_ptrs == max_ptrs) grow_ptrs();
+			ptrs[n_ptrs] = ptr;
+			insert(kv, n_ptrs++);
 		}
 
 	inline void extr_min(				// extract minimum (inlined for speed)
 		PQkey &kv,						// key (returned)
 		PQinfo &inf)					// item info (returned)
 		{
-			kv = pq[1].key;				// key of min item
-			inf = pq[1].info;			// information of min item
-			register PQkey kn = pq[n--].key;// last item in queue
-			register int p = 1;			// p points to item out of position
-			register int r = p<<1;		// left child of p
-			while (r <= n) {			// while r is still within the heap
-				ANN_FLOP(2)				// increment floating ops
-										// set r to smaller child of p
-				if (r < n  && pq[r].key > pq[r+1].key) r++;
-				if (kn <= pq[r].key)	// in proper order
+			kv = keys[0];				// key of min item
+			inf = infos[0];				// information of min item
+			n--;
+			register PQkey kn = keys[n];// last item in queue
+			register PQinfo in = infos[n];
+			register int p = 0;			// p points to item out of position
+			register int r;				// first child of p
+			while ((r = (p<<2) + 1) < n) {
+				register int e = (r + 4 < n ? r + 4 : n);
+				register int m = r;		// smallest child of p
+				register PQkey mk = keys[r];
+				for (register int c = r+1; c < e; c++) {
+					if (keys[c] < mk) { mk = keys[c]; m = c; }
+				}
+				ANN_FLOP(e-r)			// increment floating ops
+				if (kn <= mk)			// in proper order
 					break;
-				pq[p] = pq[r];			// else swap with child
-				p = r;					// advance pointers
-				r = p<<1;
+				keys[p] = mk;			// else swap with child
+				infos[p] = infos[m];
+				p = m;					// advance pointer
 			}
-			pq[p] = pq[n+1];			// insert last item in proper place
+			keys[p] = kn;				// insert last item in proper place
+			infos[p] = in;
+		}
+
+	inline void extr_min(				// extract minimum with pointer info
+		PQkey &kv,						// key (returned)
+		void *&ptr)						// item info (returned)
+		{
+			PQinfo h;
+			extr_min(kv, h);
+			ptr = ptrs[h];
 		}
 };
 
+ANN_END_NAMESPACE
+
 #endif
@@ -20,6 +20,9 @@
 // History:
 //	Revision 0.1  03/04/98
 //		Initial release
+//	Revision 1.2
+//		Added reset() so a list can be reused (see search_space.h)
+//		Added heap for large k
 //----------------------------------------------------------------------
 
 #ifndef PR_QUEUE_K_H
@@ -28,6 +31,10 @@
 #include <ANN/ANNx.h>					// all ANN includes
 #include <ANN/ANNperf.h>				// performance evaluation
 
+#include <algorithm>					// sort, reverse
+
+ANN_BEGIN_NAMESPACE
+
 //----------------------------------------------------------------------
 //	Basic types
 //----------------------------------------------------------------------
@@ -53,66 +60,193 @@ const PQKinfo	PQ_NULL_INFO =  ANN_NULL_IDX;	// nonexistent info value
 //		PQKinfo).  The special info and key values PQ_NULL_INFO and
 //		PQ_NULL_KEY means that thise entry is empty.
 //
-//		It is currently implemented using an array with k items.
-//		Items are stored in increasing sorted order, and insertions
-//		are made through standard insertion sort.  (This is quite
-//		inefficient, but current applications call for small values
-//		of k and relatively few insertions.)
-//		
-//		Note that the list contains k+1 entries, but the last entry
-//		is used as a simple placeholder and is otherwise ignored.
+//		How the items are kept depends on k:
+//
+//		ANN_MINK_SORTED	(k <= ANN_MINK_SORT_MAX)  The items are stored
+//				in increasing sorted order, and insertions are made
+//				through standard insertion sort.  This is the fastest
+//				for the small values of k most applications call for.
+//				The list contains k+1 entries, but the last entry is
+//				used as a simple placeholder and is otherwise ignored.
+//
+//		ANN_MINK_HEAP	(larger k)  The items form a binary max-heap,
+//				whose root is the k-th smallest key once the heap is
+//				full.  An insertion costs O(log k) rather than O(k).
+//
+//		In both cases maxkey() is exactly the k-th smallest key
+//		inserted so far, so the searches prune just as much as with
+//		the sorted list, and searches limited by eps or by
+//		annMaxPtsVisit() return the same points.
+//
+//		In the heap the items are sorted only when the
+//		results are extracted (by the first call to ith_smallestkey()
+//		or ith_smallest_info() after an insertion).  Items with equal
+//		keys are then ordered by their info fields; in the sorted array
+//		they stay in the order in which they were inserted.  In all
+//		cases, once the list holds k items, a key that is not smaller
+//		than maxkey() is ignored.
+//
+//		reset() empties the list and changes k.  The array is only
+//		reallocated if it is too small, so a list kept from one search
+//		to the next does no allocation once it is large enough.
 //----------------------------------------------------------------------
 
+const int ANN_MINK_SORT_MAX = 32;		// largest k kept sorted
+
+enum ANNminkMode {						// how the items are kept
+		ANN_MINK_SORTED = 0,			// sorted array
+		ANN_MINK_HEAP	= 1};			// binary max-heap
+
 class ANNmink {
 	struct mk_node {					// node in mink structure
 		PQKkey			key;			// key value
 		PQKinfo			info;			// info field (user defined)
+		bool operator<(const mk_node &b) const	// order for extraction
+			{ return key < b.key || (key == b.key && info < b.info); }
 	};
 
 	int			k;						// max number of keys to store
 	int			n;						// number of keys currently active
+	int			max_n;					// number of nodes in the array
+	ANNminkMode	mode;					// how the items are kept
+	ANNbool		sorted;					// items in sorted order?
 	mk_node		*mk;					// the list itself
 
+	void finish();						// sort items for extraction
+	void unsort();						// undo finish() (heap)
+	void sift_down(PQKkey kv, PQKinfo inf);	// replace root of heap
+	void sift_up(PQKkey kv, PQKinfo inf);	// add a heap item
+
 public:
-	ANNmink(int max)					// constructor (given max size)
+	ANNmink(int max = 0)				// constructor (given max size)
 		{
-			n = 0;						// initially no items
-			k = max;					// maximum number of items
-			mk = new mk_node[max+1];	// sorted array of keys
+			max_n = 0;
+			mk = NULL;
+			reset(max);
 		}
 
 	~ANNmink()							// destructor
 		{ delete [] mk; }
+
+	void reset(int max)					// make empty, with new max size
+		{
+			mode = (max <= ANN_MINK_SORT_MAX ? ANN_MINK_SORTED :
+					ANN_MINK_HEAP);
+			int size = max+1;
+			if (size > max_n || mk == NULL) {	// array too small?
+				delete [] mk;
+				mk = new mk_node[size];
+				max_n = size;
+			}
+			n = 0;						// initially no items
+			k = max;					// maximum number of items
+			sorted = ANNtrue;
+		}
 	
 	PQKkey ANNminkey()					// return minimum key
-		{ return (n > 0 ? mk[0].key : PQ_NULL_KEY); }
+		{
+			if (!sorted) finish();
+			return (n > 0 ? mk[0].key : PQ_NULL_KEY);
+		}
 	
 	PQKkey maxkey()					// return maximum key
-		{ return (n == k ? mk[k-1].key : PQ_NULL_KEY); }
+		{
+			if (n < k) return PQ_NULL_KEY;
+			if (mode == ANN_MINK_SORTED) return mk[k-1].key;
+			return (sorted ? mk[n-1].key : mk[0].key);
+		}
 	
 	PQKkey ith_smallestkey(int i)		// ith smallest key (i in [0..n-1])
-		{ return (i < n ? mk[i].key : PQ_NULL_KEY); }
+		{
+			if (!sorted) finish();
+			return (i < n ? mk[i].key : PQ_NULL_KEY);
+		}
 	
 	PQKinfo ith_smallest_info(int i)	// info for ith smallest (i in [0..n-1])
-		{ return (i < n ? mk[i].info : PQ_NULL_INFO); }
+		{
+			if (!sorted) finish();
+			return (i < n ? mk[i].info : PQ_NULL_INFO);
+		}
 
 	inline void insert(					// insert item (inlined for speed)
 		PQKkey kv,						// key value
 		PQKinfo inf)					// item info
 		{
-			register int i;
+			if (mode == ANN_MINK_SORTED) {
+				register int i;
 										// slide larger values up
-			for (i = n; i > 0; i--) {
-				if (mk[i-1].key > kv)
-					mk[i] = mk[i-1];
-				else
-					break;
+				for (i = n; i > 0; i--) {
+					if (mk[i-1].key > kv)
+						mk[i] = mk[i-1];
+					else
+						break;
+				}
+				mk[i].key = kv;			// store element here
+				mk[i].info = inf;
+				if (n < k) n++;			// increment number of items
+				ANN_FLOP(k-i+1)			// increment floating ops
+			}
+			else {						// heap
+				if (sorted) unsort();
+				if (n < k) sift_up(kv, inf);
+				else if (kv < mk[0].key) sift_down(kv, inf);
 			}
-			mk[i].key = kv;				// store element here
-			mk[i].info = inf;
-			if (n < k) n++;				// increment number of items
-			ANN_FLOP(k-i+1)				// increment floating ops
 		}
 };
 
+//----------------------------------------------------------------------
+//	ANNmink utilities for the heap
+//		The heap is stored in mk[0..n-1], with the children of node i
+//		at 2i+1 and 2i+2.  finish() sorts the items in increasing
+//		order; since an array in decreasing order is a max-heap,
+//		unsort() need only reverse it.
+//----------------------------------------------------------------------
+
+inline void ANNmink::sift_up(			// add a heap item
+	PQKkey kv,							// key value
+	PQKinfo inf)						// item info
+{
+	register int i = n++;
+	while (i > 0) {
+		register int p = (i - 1) >> 1;	// parent
+		if (!(mk[p].key < kv)) break;
+		mk[i] = mk[p];
+		i = p;
+		ANN_FLOP(1)						// increment floating ops
+	}
+	mk[i].key = kv;
+	mk[i].info = inf;
+}
+
+inline void ANNmink::sift_down(			// replace root of heap
+	PQKkey kv,							// key value
+	PQKinfo inf)						// item info
+{
+	register int i = 0;
+	register int c;						// larger child
+	while ((c = 2*i + 1) < n) {
+		if (c + 1 < n && mk[c].key < mk[c+1].key) c++;
+		if (!(kv < mk[c].key)) break;
+		mk[i] = mk[c];
+		i = c;
+		ANN_FLOP(2)						// increment floating ops
+	}
+	mk[i].key = kv;
+	mk[i].info = inf;
+}
+
+inline void ANNmink::finish()			// sort items for extraction
+{
+	std::sort(mk, mk + n);
+	sorted = ANNtrue;
+}
+
+inline void ANNmink::unsort()			// undo finish() (heap)
+{
+	std::reverse(mk, mk + n);
+	sorted = ANNfalse;
+}
+
+ANN_END_NAMESPACE
+
 #endif
@@ -0,0 +1,160 @@
+//----------------------------------------------------------------------
+// File:			search_space.cpp
+// Programmer:		NNP contributors
+// Description:		Per-thread search workspaces
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "search_space.h"				// search workspaces
+#include "thread_pool.h"				// ANN_THREAD_LOCAL
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>				// FlsAlloc
+#endif
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	The workspaces of all threads
+//		Each thread points to its own workspace, and all of them are
+//		also listed here, so that annClose() can free them.  Since
+//		annClose() cannot reach the pointers of other threads, it
+//		advances the generation instead; a thread whose workspace is
+//		of an older generation ignores it and makes a new one.
+//----------------------------------------------------------------------
+
+static std::mutex						ann_spaces_lock;
+static std::vector<ANNsearch_space*>	ann_spaces;
+static std::atomic<int>					ann_space_gen(1);
+
+static ANN_THREAD_LOCAL ANNsearch_space	*ann_my_space = NULL;
+static ANN_THREAD_LOCAL int				ann_my_space_gen = 0;
+
+//----------------------------------------------------------------------
+//	Freeing a workspace when its thread exits
+//		annWatchExit() arranges for annFreeSearchSpace() to be called
+//		when the calling thread exits, so that threads that come and
+//		go do not leave their workspaces behind.  It uses the
+//		destructor of a C++11 thread_local object, or, with MSVC 2012
+//		and 2013, which lack thread_local, a fiber-local storage
+//		callback, which Windows calls when the thread exits.
+//----------------------------------------------------------------------
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+
+static DWORD			ann_exit_fls = FLS_OUT_OF_INDEXES;
+static std::once_flag	ann_exit_once;
+
+static void WINAPI annSpaceExit(void *)	// called at thread exit
+{
+	annFreeSearchSpace();
+}
+
+static void annWatchExit()				// free workspace at thread exit
+{
+	std::call_once(ann_exit_once,
+		[]() { ann_exit_fls = FlsAlloc(annSpaceExit); });
+	if (ann_exit_fls != FLS_OUT_OF_INDEXES) {
+		FlsSetValue(ann_exit_fls, &ann_exit_fls);	// any non-null value
+	}
+}
+
+#else
+
+struct ANNspace_exit {					// frees workspace when destroyed
+	ANNbool				armed;			// thread has searched?
+	~ANNspace_exit()
+		{ if (armed) annFreeSearchSpace(); }
+};
+
+static thread_local ANNspace_exit		ann_space_exit = {ANNfalse};
+
+static void annWatchExit()				// free workspace at thread exit
+{
+	ann_space_exit.armed = ANNtrue;
+}
+
+#endif
+
+static ANNsearch_space *annMySpace()	// workspace of calling thread
+{
+	int gen = ann_space_gen.load();
+	if (ann_my_space == NULL || ann_my_space_gen != gen) {
+		annWatchExit();
+		ann_my_space = new ANNsearch_space;
+		ann_my_space_gen = gen;
+		std::lock_guard<std::mutex> lk(ann_spaces_lock);
+		ann_spaces.push_back(ann_my_space);
+	}
+	return ann_my_space;
+}
+
+//----------------------------------------------------------------------
+//	ANNsearch_lease - borrow and give back a workspace
+//----------------------------------------------------------------------
+
+ANNsearch_lease::ANNsearch_lease()
+{
+	sp = annMySpace();
+	own = sp->in_use;
+	if (own) {							// busy, so use a temporary one
+		sp = new ANNsearch_space;
+	}
+	sp->in_use = ANNtrue;
+}
+
+ANNsearch_lease::~ANNsearch_lease()
+{
+	if (own) delete sp;
+	else sp->in_use = ANNfalse;
+}
+
+//----------------------------------------------------------------------
+//	annFreeSearchSpace - free the workspace of the calling thread
+//	annCloseSearchSpaces - free all workspaces
+//----------------------------------------------------------------------
+
+void annFreeSearchSpace()
+{
+	if (ann_my_space == NULL) return;
+	if (ann_my_space_gen == ann_space_gen.load()) {
+		std::lock_guard<std::mutex> lk(ann_spaces_lock);
+		for (size_t i = 0; i < ann_spaces.size(); i++) {
+			if (ann_spaces[i] == ann_my_space) {
+				ann_spaces[i] = ann_spaces.back();
+				ann_spaces.pop_back();
+				delete ann_my_space;
+				break;
+			}
+		}
+	}
+	ann_my_space = NULL;
+}
+
+void annCloseSearchSpaces()
+{
+	std::lock_guard<std::mutex> lk(ann_spaces_lock);
+	for (size_t i = 0; i < ann_spaces.size(); i++) {
+		delete ann_spaces[i];
+	}
+	ann_spaces.clear();
+	ann_space_gen++;
+}
+
+ANN_END_NAMESPACE
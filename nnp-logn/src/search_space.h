@@ -0,0 +1,101 @@
+//----------------------------------------------------------------------
+// File:			search_space.h
+// Programmer:		NNP contributors
+// Description:		Per-thread search workspaces
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_search_space_H
+#define ANN_search_space_H
+
+#include <ANN/ANNx.h>					// all ANN includes
+#include "pr_queue.h"					// priority queue
+#include "pr_queue_k.h"					// k-element priority queue
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Search workspaces
+//		A search needs a set of the k closest points, a priority
+//		queue of boxes (priority search), and the cells of the query
+//		point (trees with quantized leaf codes).  Rather than
+//		allocating these for each query, the searches borrow them
+//		from a workspace that belongs to the calling thread.  The
+//		workspace keeps its arrays from one search to the next, and
+//		only enlarges them when a search needs more room, so once a
+//		thread has warmed up its searches do no heap allocation.
+//
+//		A search borrows the workspace by declaring an
+//		ANNsearch_lease.  The workspace of a thread is created on its
+//		first search.  If it is already lent out (which can only
+//		happen if a search is started from within another one, for
+//		example from a callback), the lease gets a temporary
+//		workspace of its own.
+//
+//		The workspace of a thread is freed when the thread exits, or
+//		earlier if it calls annFreeSearchSpace() (the workers of the
+//		thread pools do so when they stop).  annClose() frees the
+//		workspaces of all threads.
+//----------------------------------------------------------------------
+
+class ANNsearch_space {					// a search workspace
+	ANNmink				mk;				// k closest points
+	ANNpr_queue			pq;				// queue of boxes
+	int					*codes;			// cells of query point
+	int					n_codes;		// size of codes
+public:
+	ANNbool				in_use;			// lent out?
+
+	ANNsearch_space()					// constructor
+		{ codes = NULL; n_codes = 0; in_use = ANNfalse; }
+
+	~ANNsearch_space()					// destructor
+		{ if (codes != NULL) delete [] codes; }
+
+	ANNmink &mink(int k)				// empty set for k closest points
+		{ mk.reset(k); return mk; }
+
+	ANNpr_queue &box_queue()			// empty queue for boxes
+		{ pq.reset(); return pq; }
+
+	int *query_codes(int dim)			// room for cells of a query
+		{
+			if (dim > n_codes) {
+				if (codes != NULL) delete [] codes;
+				codes = new int[dim];
+				n_codes = dim;
+			}
+			return codes;
+		}
+};
+
+class ANNsearch_lease {					// borrows a workspace
+	ANNsearch_space		*sp;			// the workspace
+	ANNbool				own;			// temporary workspace?
+public:
+	ANNsearch_lease();					// constructor (borrow)
+	~ANNsearch_lease();					// destructor (give back)
+
+	ANNsearch_space *operator->()		// the workspace
+		{ return sp; }
+};
+
+void annCloseSearchSpaces();			// free all workspaces
+
+ANN_END_NAMESPACE
+
+#endif
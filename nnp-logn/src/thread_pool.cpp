@@ -0,0 +1,287 @@
+//----------------------------------------------------------------------
+// File:			thread_pool.cpp
+// Programmer:		NNP contributors
+// Description:		Work-stealing thread pool
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#include "thread_pool.h"				// thread pool declarations
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	Per-thread state
+//		Each worker records the pool it belongs to and the index of
+//		its queue.  Other threads have a NULL pool.
+//----------------------------------------------------------------------
+
+static ANN_THREAD_LOCAL ANNthread_pool	*ann_cur_pool = NULL;
+static ANN_THREAD_LOCAL int				ann_cur_queue = -1;
+
+ANNthread_pool *ANNthread_pool::current()
+{
+	return ann_cur_pool;
+}
+
+//----------------------------------------------------------------------
+//	my_queue - the queue into which the calling thread spawns
+//		Workers use their own queue; all other threads use the
+//		injection queue, which is the last one.
+//----------------------------------------------------------------------
+
+int ANNthread_pool::my_queue()
+{
+	if (ann_cur_pool == this) return ann_cur_queue;
+	return (int) queues.size() - 1;
+}
+
+//----------------------------------------------------------------------
+//	Constructor and destructor
+//----------------------------------------------------------------------
+
+ANNthread_pool::ANNthread_pool(int n)
+	: n_queued(0), n_idle(0), stopping(false)
+{
+	if (n < 1) n = 1;
+	n_threads = n;
+	for (int i = 0; i < n; i++) {		// n-1 worker queues + injection
+		queues.push_back(new task_queue);
+	}
+	for (int i = 0; i < n-1; i++) {		// start the workers
+		workers.push_back(std::thread(&ANNthread_pool::worker_main, this, i));
+	}
+}
+
+ANNthread_pool::~ANNthread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lk(idle_lock);
+		stopping = true;
+	}
+	idle_cv.notify_all();				// wake everyone up
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+	for (size_t i = 0; i < queues.size(); i++) {
+		delete queues[i];
+	}
+}
+
+//----------------------------------------------------------------------
+//	spawn - add a task to a group
+//		The task goes on the back of the caller's queue.  A sleeping
+//		worker is woken if there is one.  The idle count is read
+//		after the queued count is raised, and a worker raises the idle
+//		count before it reads the queued count, so either the worker
+//		sees the new task or we see the sleeping worker.
+//----------------------------------------------------------------------
+
+void ANNthread_pool::spawn(ANNtask_group &g, ANNtask *t)
+{
+	task_item it;
+	it.task = t;
+	it.group = &g;
+	g.pending++;
+
+	task_queue *tq = queues[my_queue()];
+	{
+		std::lock_guard<std::mutex> lk(tq->lock);
+		tq->items.push_back(it);
+	}
+	n_queued++;
+	if (n_idle.load() > 0) {
+		std::lock_guard<std::mutex> lk(idle_lock);
+		idle_cv.notify_one();
+	}
+}
+
+//----------------------------------------------------------------------
+//	pop - find a task for the thread owning queue id
+//		The thread first takes the newest task from its own queue.
+//		Failing that, it steals the oldest task from the other queues,
+//		starting with its neighbor so that thieves spread out.
+//----------------------------------------------------------------------
+
+bool ANNthread_pool::pop(int id, task_item &it)
+{
+	if (n_queued.load() == 0) return false;
+
+	int nq = (int) queues.size();
+	{
+		task_queue *tq = queues[id];
+		std::lock_guard<std::mutex> lk(tq->lock);
+		if (!tq->items.empty()) {
+			it = tq->items.back();
+			tq->items.pop_back();
+			n_queued--;
+			return true;
+		}
+	}
+	for (int j = 1; j < nq; j++) {		// try to steal
+		task_queue *tq = queues[(id + j) % nq];
+		std::lock_guard<std::mutex> lk(tq->lock);
+		if (!tq->items.empty()) {
+			it = tq->items.front();
+			tq->items.pop_front();
+			n_queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------
+//	execute - run a task, delete it and retire it from its group
+//----------------------------------------------------------------------
+
+void ANNthread_pool::execute(task_item &it)
+{
+	it.task->run();
+	delete it.task;
+	it.group->pending--;
+}
+
+//----------------------------------------------------------------------
+//	worker_main - body of a worker thread
+//----------------------------------------------------------------------
+
+void ANNthread_pool::worker_main(int id)
+{
+	ann_cur_pool = this;
+	ann_cur_queue = id;
+
+	for (;;) {
+		task_item it;
+		if (pop(id, it)) {				// work to do
+			execute(it);
+			continue;
+		}
+		std::unique_lock<std::mutex> lk(idle_lock);
+		if (stopping) break;
+		n_idle++;						// announce we may sleep
+		if (n_queued.load() == 0) {		// still nothing to do?
+			idle_cv.wait(lk);
+		}
+		n_idle--;
+	}
+	annFreeSearchSpace();				// searches made by our tasks
+}
+
+//----------------------------------------------------------------------
+//	wait - wait for a group to finish
+//		The caller runs queued tasks while it waits.  When there is
+//		nothing left to run, the remaining tasks of the group are
+//		being run by other threads, and we just yield until they are
+//		done.
+//----------------------------------------------------------------------
+
+void ANNthread_pool::wait(ANNtask_group &g)
+{
+	int id = my_queue();
+	while (!g.done()) {
+		task_item it;
+		if (pop(id, it)) {
+			execute(it);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+//	Process-wide pools
+//		Pools are created on demand, one for each thread count, and
+//		are kept until annClose() so that repeated calls do not pay
+//		for thread creation.
+//----------------------------------------------------------------------
+
+static std::mutex						ann_pools_lock;
+static std::vector<ANNthread_pool*>		ann_pools;
+
+int annHardwareThreads()
+{
+	int n = (int) std::thread::hardware_concurrency();
+	return (n < 1 ? 1 : n);
+}
+
+ANNthread_pool *annThreadPool(int n_threads)
+{
+	if (n_threads <= 0) n_threads = annHardwareThreads();
+
+	std::lock_guard<std::mutex> lk(ann_pools_lock);
+	for (size_t i = 0; i < ann_pools.size(); i++) {
+		if (ann_pools[i]->nThreads() == n_threads) return ann_pools[i];
+	}
+	ANNthread_pool *pool = new ANNthread_pool(n_threads);
+	ann_pools.push_back(pool);
+	return pool;
+}
+
+void annClosePools()
+{
+	std::lock_guard<std::mutex> lk(ann_pools_lock);
+	for (size_t i = 0; i < ann_pools.size(); i++) {
+		delete ann_pools[i];
+	}
+	ann_pools.clear();
+}
+
+//----------------------------------------------------------------------
+//	annParallelFor - apply a body over a range in parallel
+//----------------------------------------------------------------------
+
+class ANNrange_task : public ANNtask {
+	ANNthread_pool		*pool;			// the pool
+	int					lo, hi;			// the subrange
+	int					grain;			// max size of a leaf range
+	ANNrange_body		*body;			// the work
+public:
+	ANNrange_task(ANNthread_pool *p, int l, int h, int g, ANNrange_body *b)
+		{ pool = p; lo = l; hi = h; grain = g; body = b; }
+
+	void run()
+	{
+		ANNtask_group g;
+		while (hi - lo > grain) {		// split off the upper half
+			int mid = lo + (hi - lo)/2;
+			pool->spawn(g, new ANNrange_task(pool, mid, hi, grain, body));
+			hi = mid;
+		}
+		body->run(lo, hi);				// do the lower piece
+		pool->wait(g);
+	}
+};
+
+void annParallelFor(
+	ANNthread_pool		*pool,			// the pool (may be NULL)
+	int					begin,			// start of range
+	int					end,			// end of range
+	int					grain,			// max size of a subrange
+	ANNrange_body		&body)			// the work
+{
+	if (end <= begin) return;
+	if (grain < 1) grain = 1;
+	if (pool == NULL || pool->nThreads() == 1 || end - begin <= grain) {
+		body.run(begin, end);
+		return;
+	}
+	ANNrange_task root(pool, begin, end, grain, &body);
+	root.run();
+}
+
+ANN_END_NAMESPACE
@@ -0,0 +1,184 @@
+//----------------------------------------------------------------------
+// File:			thread_pool.h
+// Programmer:		NNP contributors
+// Description:		Work-stealing thread pool used for parallel
+//					searching and construction
+//----------------------------------------------------------------------
+// Copyright (c) 2026 NNP contributors.
+//
+// This software and related documentation is part of the Approximate
+// Nearest Neighbor Library (ANN).  This software is provided under
+// the provisions of the Lesser GNU Public License (LGPL).  See the
+// file ../ReadMe.txt for further information.
+//
+// The authors make no representations about the suitability or
+// fitness of this software for any purpose.  It is provided "as is"
+// without express or implied warranty.
+//----------------------------------------------------------------------
+// History:
+//	Revision 1.2
+//		Initial release
+//----------------------------------------------------------------------
+
+#ifndef ANN_thread_pool_H
+#define ANN_thread_pool_H
+
+#include <ANN/ANNx.h>					// all ANN includes
+
+#include <atomic>						// atomic counters
+#include <deque>						// task deques
+#include <mutex>						// locks
+#include <condition_variable>			// sleeping workers
+#include <thread>						// worker threads
+#include <vector>						// worker list
+
+//----------------------------------------------------------------------
+//	Thread-local storage
+//		MSVC 2012 does not support the C++11 thread_local keyword,
+//		so we use the compiler-specific forms.
+//----------------------------------------------------------------------
+#if defined(_MSC_VER)
+	#define ANN_THREAD_LOCAL	__declspec(thread)
+#else
+	#define ANN_THREAD_LOCAL	__thread
+#endif
+
+ANN_BEGIN_NAMESPACE
+
+//----------------------------------------------------------------------
+//	ANNtask
+//		A unit of work for the thread pool.  Tasks are allocated by
+//		the caller with new, and are deleted by the pool after they
+//		have been run.
+//
+//	ANNtask_group
+//		A set of tasks that can be waited upon.  The group counts the
+//		tasks that have been spawned into it but have not yet
+//		finished.  A group must not be destroyed until it has been
+//		waited on.
+//----------------------------------------------------------------------
+
+class ANNtask {
+public:
+	virtual ~ANNtask() {}				// virtual destructor
+	virtual void run() = 0;				// do the work
+};
+
+class ANNtask_group {
+	friend class ANNthread_pool;
+	std::atomic<int>	pending;		// number of unfinished tasks
+public:
+	ANNtask_group() : pending(0) {}		// constructor
+	bool done() const					// are all tasks finished?
+		{ return pending.load() == 0; }
+};
+
+//----------------------------------------------------------------------
+//	ANNthread_pool
+//		A pool of persistent worker threads.  Each worker has its own
+//		double-ended queue of tasks.  A worker pushes the tasks it
+//		spawns onto the back of its own queue and takes work from the
+//		back as well (so recently spawned, cache-warm work is done
+//		first).  A worker whose queue is empty steals from the front
+//		of another queue, which takes the oldest (and typically the
+//		largest) piece of work.  Tasks spawned by threads that do not
+//		belong to the pool go into a shared injection queue.
+//
+//		A pool of n threads has n-1 workers.  The thread that calls
+//		wait() is the n-th: rather than blocking, it runs queued tasks
+//		(its own or stolen ones) until its group is finished.  This is
+//		also what makes nested parallelism safe, since a task which
+//		spawns subtasks and waits on them keeps its worker busy rather
+//		than idle.
+//
+//		Idle workers sleep on a condition variable and are woken when
+//		work is spawned.
+//
+//		Process-wide pools are obtained with annThreadPool(n), which
+//		creates one pool for each distinct thread count and keeps it
+//		until annClose().
+//----------------------------------------------------------------------
+
+class ANNthread_pool {
+	struct task_item {					// queued task
+		ANNtask			*task;			// the task
+		ANNtask_group	*group;			// the group it belongs to
+	};
+	struct task_queue {					// a locked task deque
+		std::mutex				lock;	// protects the deque
+		std::deque<task_item>	items;	// queued tasks
+	};
+
+	int							n_threads;	// threads (workers + caller)
+	std::vector<task_queue*>	queues;		// worker queues + injection
+	std::vector<std::thread>	workers;	// worker threads
+	std::atomic<int>			n_queued;	// number of queued tasks
+	std::atomic<int>			n_idle;		// number of sleeping workers
+	std::atomic<bool>			stopping;	// shutting down?
+	std::mutex					idle_lock;	// lock for sleeping
+	std::condition_variable		idle_cv;	// wakes sleeping workers
+
+	void worker_main(int id);			// worker thread body
+	bool pop(int id, task_item &it);	// get work for queue id
+	void execute(task_item &it);		// run a task and retire it
+	int my_queue();						// queue of the calling thread
+
+	ANNthread_pool(const ANNthread_pool&);				// not copyable
+	ANNthread_pool& operator=(const ANNthread_pool&);
+public:
+	ANNthread_pool(int n);				// constructor (n threads)
+	~ANNthread_pool();					// destructor (joins workers)
+
+	int nThreads() const				// number of threads
+		{ return n_threads; }
+
+	void spawn(							// spawn a task into a group
+		ANNtask_group	&g,				// the group
+		ANNtask			*t);			// the task (deleted after run)
+
+	void wait(ANNtask_group &g);		// help until group is done
+
+	static ANNthread_pool *current();	// pool of calling worker (or NULL)
+};
+
+//----------------------------------------------------------------------
+//	annThreadPool
+//		Returns the process-wide pool with the given number of threads
+//		(0 means one per hardware thread).  annHardwareThreads() is the
+//		number of hardware threads (at least 1).  annClosePools() shuts
+//		the pools down; it is called by annClose().
+//----------------------------------------------------------------------
+
+int annHardwareThreads();
+
+ANNthread_pool *annThreadPool(int n_threads);
+
+void annClosePools();
+
+//----------------------------------------------------------------------
+//	annParallelFor
+//		Applies body.run(lo, hi) to disjoint subranges which cover
+//		[begin, end), using the given pool.  The range is split in
+//		half recursively, one half being spawned and the other run
+//		directly, until subranges have at most grain elements.  This
+//		lets idle threads steal large pieces of the range first.  If
+//		the pool is NULL or has a single thread, the whole range is
+//		run directly in the calling thread.
+//----------------------------------------------------------------------
+
+class ANNrange_body {
+public:
+	virtual ~ANNrange_body() {}			// virtual destructor
+	virtual void run(int lo, int hi) = 0;	// process [lo, hi)
+};
+
+void annParallelFor(
+	ANNthread_pool		*pool,			// the pool (may be NULL)
+	int					begin,			// start of range
+	int					end,			// end of range
+	int					grain,			// max size of a subrange
+	ANNrange_body		&body);			// the work
+
+ANN_END_NAMESPACE
+
+#endif
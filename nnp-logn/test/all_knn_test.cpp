@@ -0,0 +1,155 @@
+// A test of the dual-tree all nearest neighbors search (see kd_all_knn.cpp).
+// It runs annAllKnn with eps = 0 in kd- and bd-trees, for several k and
+// numbers of threads, and checks the results of every point against those
+// of ANNbruteForce.  The distances must agree with brute force (up to the
+// roundoff of the vector leaf scans), and each returned neighbor must be a
+// distinct point at the distance returned for it.  Among points at equal
+// distances the two may return different neighbors, so the indices are not
+// compared with those of brute force.
+//
+// The data are uniform points in 4 dimensions, and clustered points in 2.
+// With several threads the tree is cut into many small chunks, so every
+// thread count also exercises the way the results of the chunks are put
+// together.
+//
+// After compiling it can be run as follows.
+//
+// all_knn_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+
+using namespace std;
+
+int failures = 0;
+
+void fail(const char * what, const char * tree, int k, int threads, int i)
+{
+	if (++failures <= 20)
+		cerr << what << " (" << tree << " tree, k = " << k << ", "
+			 << threads << " threads, point " << i << ")\n";
+}
+
+bool close(ANNdist a, ANNdist b)
+{
+	return fabs(a - b) <= 1e-9 * (b > 1 ? b : 1);
+}
+
+// Checks the k results of every point against the first k of brute force
+void checkAll(ANNpointArray data, int n, int dim, int k, int kmax,
+	const vector<ANNdist> & exact, const vector<ANNidx> & idx,
+	const vector<ANNdist> & dists, const char * tree, int threads)
+{
+	for (int i = 0; i < n; i++)
+	{
+		const ANNidx * ni = &idx[(size_t)i * k];
+		const ANNdist * nd = &dists[(size_t)i * k];
+
+		for (int j = 0; j < k; j++)
+		{
+			if (!close(nd[j], exact[(size_t)i * kmax + j]))
+			{
+				fail("distance differs from brute force", tree, k, threads, i);
+				break;
+			}
+
+			if (ni[j] < 0 || ni[j] >= n || !close(nd[j], annDist(dim, data[i], data[ni[j]])))
+			{
+				fail("neighbor is not at its distance", tree, k, threads, i);
+				break;
+			}
+
+			for (int l = 0; l < j; l++)
+			{
+				if (ni[l] == ni[j])
+					fail("neighbor returned twice", tree, k, threads, i);
+			}
+		}
+	}
+}
+
+void run(ANNpointArray data, int n, int dim)
+{
+	static const int ks[] = {1, 5, 32, 33, 60};
+	static const int ts[] = {1, 2, 4, 8};
+	const int nk = sizeof(ks) / sizeof(ks[0]), nt = sizeof(ts) / sizeof(ts[0]);
+	const int kmax = ks[nk - 1];
+
+	ANNbruteForce brute(data, n, dim);
+	vector<ANNidx> idx((size_t)n * kmax);
+	vector<ANNdist> exact((size_t)n * kmax);
+
+	for (int i = 0; i < n; i++)
+		brute.annkSearch(data[i], kmax, &idx[i * (size_t)kmax], &exact[i * (size_t)kmax]);
+
+	ANNkd_tree * kd = new ANNkd_tree(data, n, dim);
+	ANNbd_tree * bd = new ANNbd_tree(data, n, dim);
+	ANNkd_tree * trees[] = {kd, bd};
+	const char * names[] = {"kd", "bd"};
+
+	for (int t = 0; t < 2; t++)
+	{
+		for (int j = 0; j < nk; j++)
+		{
+			for (int h = 0; h < nt; h++)
+			{
+				vector<ANNidx> nn_idx((size_t)n * ks[j], -1);
+				vector<ANNdist> dd((size_t)n * ks[j], -1);
+
+				annAllKnn(*trees[t], ks[j], &nn_idx[0], &dd[0], 0.0, ts[h]);
+				checkAll(data, n, dim, ks[j], kmax, exact, nn_idx, dd, names[t], ts[h]);
+			}
+		}
+	}
+
+	delete kd;								// before annClose()
+	delete bd;
+}
+
+int main()
+{
+	const int n = 5000;
+
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+	normal_distribution<double> normal(0, 0.01);
+
+	ANNpointArray data = annAllocPts(n, 4);
+
+	for (int i = 0; i < n; i++)				// uniform, 4 dimensions
+		for (int d = 0; d < 4; d++)
+			data[i][d] = uniform(random);
+
+	run(data, n, 4);
+	annDeallocPts(data);
+
+	data = annAllocPts(n, 2);
+	vector<double> centers(20 * 2);
+
+	for (size_t c = 0; c < centers.size(); c++)
+		centers[c] = uniform(random);
+
+	for (int i = 0; i < n; i++)				// 20 clusters, 2 dimensions
+		for (int d = 0; d < 2; d++)
+			data[i][d] = centers[(i % 20) * 2 + d] + normal(random);
+
+	run(data, n, 2);
+	annDeallocPts(data);
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "all_knn_test passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+// A test of the dual-tree k closest pairs search (see kd_close_pairs.cpp).
+// It runs annkClosestPairs with eps = 0 in kd- and bd-trees, for several
+// k up to the number of pairs, n*(n-1)/2, and several numbers of threads,
+// and checks the results against all the pairs, sorted by brute force.
+// The i-th distance must agree with the i-th smallest (up to the roundoff
+// of the vector leaf scans), the distances must be in increasing order,
+// and each pair must be two different points, idx1[i] < idx2[i], at the
+// distance returned for it, returned only once.  With k = n*(n-1)/2 this
+// means that every pair is returned.  Among pairs at equal distances the
+// two may return different ones, so the indices are not compared with
+// those of brute force.
+//
+// The data include points with duplicates (pairs at distance 0, and
+// points repeated several times), and a few very small sets.
+//
+// After compiling it can be run as follows.
+//
+// close_pairs_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <ANN/ANN.h>
+
+using namespace std;
+
+int failures = 0;
+
+void fail(const char * what, const char * data, const char * tree, int k, int threads, int i)
+{
+	if (++failures <= 20)
+		cerr << what << " (" << data << ", " << tree << " tree, k = " << k << ", "
+			 << threads << " threads, pair " << i << ")\n";
+}
+
+bool close(ANNdist a, ANNdist b)
+{
+	return fabs(a - b) <= 1e-9 * (b > 1 ? b : 1);
+}
+
+void run(const char * name, ANNpointArray data, int n, int dim)
+{
+	static const int ts[] = {1, 2, 4, 8};
+	const int nt = sizeof(ts) / sizeof(ts[0]);
+	const int pairs = n * (n - 1) / 2;
+
+	vector<ANNdist> exact;					// all the pairs, sorted
+
+	for (int i = 0; i < n; i++)
+		for (int j = i + 1; j < n; j++)
+			exact.push_back(annDist(dim, data[i], data[j]));
+
+	sort(exact.begin(), exact.end());
+
+	vector<int> ks;
+	static const int some[] = {1, 2, 10, 100, 1000};
+
+	for (size_t j = 0; j < sizeof(some) / sizeof(some[0]); j++)
+	{
+		if (some[j] < pairs)
+			ks.push_back(some[j]);
+	}
+
+	if (pairs > 5)
+		ks.push_back(pairs - 5);
+
+	ks.push_back(pairs);
+
+	ANNkd_tree * kd = new ANNkd_tree(data, n, dim);
+	ANNbd_tree * bd = new ANNbd_tree(data, n, dim);
+	ANNkd_tree * trees[] = {kd, bd};
+	const char * names[] = {"kd", "bd"};
+
+	for (int t = 0; t < 2; t++)
+	{
+		for (size_t j = 0; j < ks.size(); j++)
+		{
+			int k = ks[j];
+
+			for (int h = 0; h < nt; h++)
+			{
+				vector<ANNidx> idx1(k, -1), idx2(k, -1);
+				vector<ANNdist> dd(k, -1);
+				set<pair<ANNidx, ANNidx> > seen;
+
+				annkClosestPairs(*trees[t], k, &idx1[0], &idx2[0], &dd[0], 0.0, ts[h]);
+
+				for (int i = 0; i < k; i++)
+				{
+					if (!close(dd[i], exact[i]))
+						fail("distance differs from brute force", name, names[t], k, ts[h], i);
+
+					if (i > 0 && dd[i] < dd[i - 1])
+						fail("distances out of order", name, names[t], k, ts[h], i);
+
+					if (idx1[i] < 0 || idx1[i] >= idx2[i] || idx2[i] >= n)
+					{
+						fail("bad pair of indices", name, names[t], k, ts[h], i);
+						continue;
+					}
+
+					if (!close(dd[i], annDist(dim, data[idx1[i]], data[idx2[i]])))
+						fail("pair is not at its distance", name, names[t], k, ts[h], i);
+
+					if (!seen.insert(make_pair(idx1[i], idx2[i])).second)
+						fail("pair returned twice", name, names[t], k, ts[h], i);
+				}
+			}
+		}
+	}
+
+	delete kd;								// before annClose()
+	delete bd;
+}
+
+int main()
+{
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+
+	const int n = 300;						// 2 dimensions, with duplicates
+	ANNpointArray data = annAllocPts(n, 2);
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int d = 0; d < 2; d++)
+		{
+			if (i % 7 == 6)					// a copy of an earlier point
+				data[i][d] = data[i / 2][d];
+			else if (i >= 280)				// the same point, 20 times
+				data[i][d] = 0.5;
+			else
+				data[i][d] = uniform(random);
+		}
+	}
+
+	run("duplicates", data, n, 2);
+	annDeallocPts(data);
+
+	const int m = 400;						// 5 dimensions, uniform
+	data = annAllocPts(m, 5);
+
+	for (int i = 0; i < m; i++)
+		for (int d = 0; d < 5; d++)
+			data[i][d] = uniform(random);
+
+	run("uniform", data, m, 5);
+	annDeallocPts(data);
+
+	static const int small[] = {2, 3, 5};	// very small sets
+
+	for (int s = 0; s < 3; s++)
+	{
+		data = annAllocPts(small[s], 3);
+
+		for (int i = 0; i < small[s]; i++)
+			for (int d = 0; d < 3; d++)
+				data[i][d] = (i == 1 ? data[0][d] : uniform(random));
+
+		run("small", data, small[s], 3);
+		annDeallocPts(data);
+	}
+
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "close_pairs_test passed\n";
+	return EXIT_SUCCESS;
+}
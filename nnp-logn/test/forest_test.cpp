@@ -0,0 +1,255 @@
+// A test of the dynamic point sets (see kd_forest.cpp).  It applies a long
+// random sequence of insertions and removals to an ANNkd_forest, growing
+// the set, shrinking it (at one point to nothing) and growing it again,
+// and every few hundred operations builds a new ANNkd_tree over the points
+// then in the set and checks the forest's searches against it.  The exact
+// k nearest neighbor and fixed-radius searches must return the same
+// distances (up to the roundoff of the vector leaf scans) and the same
+// number of points within the radius, and each point returned must be in
+// the set, at the distance returned for it.  Among points at equal
+// distances the two may return different points, so the indices are not
+// compared.  remove() must return false exactly when the index is absent.
+//
+// Some of the points inserted are copies of points already in the set.
+// The sequence is run with two bucket sizes, starting from an empty forest
+// and from one built from points, and with leaf coordinate blocks and
+// leaf codes (which the forest's trees are then built with) turned on.
+//
+// After compiling it can be run as follows.
+//
+// forest_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+
+using namespace std;
+
+int failures = 0;
+
+void fail(const char * what, const char * run, int step)
+{
+	if (++failures <= 20)
+		cerr << what << " (" << run << ", step " << step << ")\n";
+}
+
+bool close(ANNdist a, ANNdist b)
+{
+	return fabs(a - b) <= 1e-9 * (b > 1 ? b : 1);
+}
+
+const int dim = 3;
+
+typedef map<ANNidx, vector<ANNcoord> > PointSet;	// the points in the set
+
+// Checks the forest's searches against those of a tree built over the set
+void checkSearches(ANNkd_forest & forest, const PointSet & set,
+	mt19937 & random, const char * run, int step)
+{
+	static const int ks[] = {1, 8, 40};
+	uniform_real_distribution<double> uniform(0, 1);
+	int n = (int)set.size();
+
+	if (forest.nPoints() != n)
+		fail("wrong number of points", run, step);
+
+	if (n == 0)
+		return;
+
+	ANNpointArray pa = annAllocPts(n, dim);
+	int i = 0;
+
+	for (PointSet::const_iterator p = set.begin(); p != set.end(); ++p, i++)
+		for (int d = 0; d < dim; d++)
+			pa[i][d] = p->second[d];
+
+	ANNkd_tree * tree = new ANNkd_tree(pa, n, dim);
+	ANNpoint q = annAllocPt(dim);
+
+	for (int t = 0; t < 10; t++)
+	{
+		for (int d = 0; d < dim; d++)
+			q[d] = uniform(random);
+
+		for (int j = 0; j < 3; j++)
+		{
+			int k = ks[j];
+
+			if (k > n)
+				break;
+
+			vector<ANNidx> ti(k), fi(k);
+			vector<ANNdist> td(k), fd(k);
+
+			tree->annkSearch(q, k, &ti[0], &td[0]);
+			forest.annkSearch(q, k, &fi[0], &fd[0]);
+
+			for (int l = 0; l < k; l++)
+			{
+				if (!close(fd[l], td[l]))
+				{
+					fail("kNN distance differs from tree", run, step);
+					break;
+				}
+
+				PointSet::const_iterator p = set.find(fi[l]);
+
+				if (p == set.end() || !close(fd[l], annDist(dim, q, (ANNpoint)&p->second[0])))
+				{
+					fail("kNN point is not in the set at its distance", run, step);
+					break;
+				}
+			}
+		}
+
+		ANNdist sqRad = 0.01;
+		vector<ANNidx> ti(8), fi(8);
+		vector<ANNdist> td(8), fd(8);
+
+		int tn = tree->annkFRSearch(q, sqRad, 8, &ti[0], &td[0]);
+		int fn = forest.annkFRSearch(q, sqRad, 8, &fi[0], &fd[0]);
+
+		if (fn != tn)
+			fail("fixed-radius count differs from tree", run, step);
+
+		for (int l = 0; l < 8 && l < tn; l++)
+		{
+			PointSet::const_iterator p = set.find(fi[l]);
+
+			if (!close(fd[l], td[l]) || p == set.end() ||
+				!close(fd[l], annDist(dim, q, (ANNpoint)&p->second[0])))
+			{
+				fail("fixed-radius result differs from tree", run, step);
+				break;
+			}
+		}
+	}
+
+	annDeallocPt(q);
+	delete tree;
+	annDeallocPts(pa);
+}
+
+// Runs the random sequence, starting with n0 points (from an array)
+void run(const char * name, int bs, int n0)
+{
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+
+	PointSet set;
+	vector<ANNidx> present;					// the indices, for choosing
+	ANNidx next = 0;
+
+	ANNpointArray pa = annAllocPts(n0 > 0 ? n0 : 1, dim);
+
+	for (int i = 0; i < n0; i++)
+	{
+		set[next].resize(dim);
+
+		for (int d = 0; d < dim; d++)
+			set[next][d] = pa[i][d] = uniform(random);
+
+		present.push_back(next++);
+	}
+
+	ANNkd_forest * forest = (n0 > 0 ? new ANNkd_forest(pa, n0, dim, bs) : new ANNkd_forest(dim, bs));
+	ANNpoint p = annAllocPt(dim);
+
+	const int steps = 12000;
+	checkSearches(*forest, set, random, name, 0);
+
+	for (int step = 1; step <= steps; step++)
+	{
+		double insertOdds;					// grow, drain, grow, shrink
+
+		if (step <= 4000)
+			insertOdds = 0.7;
+		else if (step <= 7000)
+			insertOdds = 0.05;
+		else if (step <= 10000)
+			insertOdds = 0.7;
+		else
+			insertOdds = 0.35;
+
+		if (uniform(random) < insertOdds || present.empty())
+		{
+			ANNidx idx = 7 + 3 * next++;	// arbitrary, distinct indices
+
+			if (!present.empty() && uniform(random) < 0.1)
+			{
+				const vector<ANNcoord> & copy = set[present[random() % present.size()]];
+
+				for (int d = 0; d < dim; d++)
+					p[d] = copy[d];
+			}
+			else
+			{
+				for (int d = 0; d < dim; d++)
+					p[d] = uniform(random);
+			}
+
+			forest->insert(p, idx);
+			set[idx] = vector<ANNcoord>(p, p + dim);
+			present.push_back(idx);
+		}
+		else
+		{
+			size_t j = random() % present.size();
+			ANNidx idx = present[j];
+
+			if (forest->remove(idx) != ANNtrue)
+				fail("remove() of a point in the set failed", name, step);
+
+			if (forest->remove(idx) != ANNfalse)
+				fail("remove() of a removed point succeeded", name, step);
+
+			set.erase(idx);
+			present[j] = present.back();
+			present.pop_back();
+		}
+
+		if (step % 400 == 0 || set.size() <= 2)
+			checkSearches(*forest, set, random, name, step);
+	}
+
+	if (forest->remove(-1) != ANNfalse)
+		fail("remove() of an unknown index succeeded", name, steps);
+
+	annDeallocPt(p);
+	annDeallocPts(pa);
+	delete forest;							// before annClose()
+}
+
+int main()
+{
+	run("bucket size 1", 1, 0);
+	run("bucket size 8, from points", 8, 500);
+
+	annLeafCoords(ANNtrue);
+	run("leaf coordinates", 1, 500);
+	annLeafCoords(ANNfalse);
+
+	annLeafCodes(ANN_CODES_INT8);
+	run("int8 leaf codes", 4, 0);
+	annLeafCodes(ANN_CODES_INT16);
+	run("int16 leaf codes", 4, 500);
+	annLeafCodes(ANN_CODES_NONE);
+
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "forest_test passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+// A test of the dual-tree kNN join (see kd_all_knn.cpp).  It joins a set
+// of query points with a set of reference points, with eps = 0, for every
+// combination of kd- and bd-trees, several k and numbers of threads, and
+// checks the results of every query point against those of ANNbruteForce.
+// The distances must agree with brute force (up to the roundoff of the
+// vector leaf scans), and each returned neighbor must be a distinct
+// reference point at the distance returned for it.  Among points at equal
+// distances the two may return different neighbors, so the indices are not
+// compared with those of brute force.
+//
+// The results are received through a sink, which checks that every query
+// point appears in exactly one chunk, and that results() is never called
+// by two threads at once.  The join into arrays and the join of an array
+// of query points are checked in the same way.  A final join of more query
+// points than fit in one chunk, with a single thread, checks that the
+// chunks together cover the query points exactly once.
+//
+// After compiling it can be run as follows.
+//
+// knn_join_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+
+using namespace std;
+
+int failures = 0;
+
+void fail(const char * what, const char * join, int k, int threads, int q)
+{
+	if (++failures <= 20)
+		cerr << what << " (" << join << ", k = " << k << ", "
+			 << threads << " threads, query " << q << ")\n";
+}
+
+bool close(ANNdist a, ANNdist b)
+{
+	return fabs(a - b) <= 1e-9 * (b > 1 ? b : 1);
+}
+
+// Collects the chunks of a join, checking that each query comes once
+class CheckSink : public ANNjoinSink
+{
+	int k;
+	atomic<int> busy;
+
+public:
+	vector<int> seen;						// times each query was seen
+	vector<ANNidx> idx;						// results, as the arrays hold them
+	vector<ANNdist> dists;
+	int calls;
+
+	CheckSink(int m, int k) : k(k), seen(m, 0),
+		idx((size_t)m * k, -1), dists((size_t)m * k, -1), calls(0)
+	{
+		busy = 0;
+	}
+
+	void results(int m, ANNidxArray q_idx, ANNidxArray nn_idx, ANNdistArray dd)
+	{
+		if (busy++ != 0)
+			fail("results() called concurrently", "sink", k, 0, -1);
+
+		calls++;
+
+		for (int i = 0; i < m; i++)
+		{
+			int q = q_idx[i];
+
+			if (q < 0 || q >= (int)seen.size())
+			{
+				fail("query index out of range", "sink", k, 0, q);
+				continue;
+			}
+
+			seen[q]++;
+
+			for (int j = 0; j < k; j++)
+			{
+				idx[(size_t)q * k + j] = nn_idx[(size_t)i * k + j];
+				dists[(size_t)q * k + j] = dd[(size_t)i * k + j];
+			}
+		}
+
+		busy--;
+	}
+
+	void checkOnce(const char * join, int threads)
+	{
+		for (size_t q = 0; q < seen.size(); q++)
+		{
+			if (seen[q] != 1)
+				fail("query not delivered exactly once", join, k, threads, (int)q);
+		}
+	}
+};
+
+// Checks the k results of every query against the first k of brute force
+void checkAll(ANNpointArray queries, int m, ANNpointArray data, int n, int dim,
+	int k, int kmax, const vector<ANNdist> & exact, const vector<ANNidx> & idx,
+	const vector<ANNdist> & dists, const char * join, int threads)
+{
+	for (int q = 0; q < m; q++)
+	{
+		const ANNidx * ni = &idx[(size_t)q * k];
+		const ANNdist * nd = &dists[(size_t)q * k];
+
+		for (int j = 0; j < k; j++)
+		{
+			if (!close(nd[j], exact[(size_t)q * kmax + j]))
+			{
+				fail("distance differs from brute force", join, k, threads, q);
+				break;
+			}
+
+			if (ni[j] < 0 || ni[j] >= n || !close(nd[j], annDist(dim, queries[q], data[ni[j]])))
+			{
+				fail("neighbor is not at its distance", join, k, threads, q);
+				break;
+			}
+
+			for (int l = 0; l < j; l++)
+			{
+				if (ni[l] == ni[j])
+					fail("neighbor returned twice", join, k, threads, q);
+			}
+		}
+	}
+}
+
+// Finds the kmax nearest neighbors of every query by brute force
+vector<ANNdist> bruteForce(ANNpointArray queries, int m, ANNpointArray data, int n, int dim, int kmax)
+{
+	ANNbruteForce brute(data, n, dim);
+	vector<ANNidx> idx(kmax);
+	vector<ANNdist> exact((size_t)m * kmax);
+
+	for (int q = 0; q < m; q++)
+		brute.annkSearch(queries[q], kmax, &idx[0], &exact[q * (size_t)kmax]);
+
+	return exact;
+}
+
+int main()
+{
+	const int dim = 3, n = 6000, m = 3000;
+	static const int ks[] = {1, 7, 32, 33, 50};
+	static const int ts[] = {1, 2, 4, 8};
+	const int nk = sizeof(ks) / sizeof(ks[0]), nt = sizeof(ts) / sizeof(ts[0]);
+	const int kmax = ks[nk - 1];
+
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+
+	ANNpointArray data = annAllocPts(n, dim);
+	ANNpointArray queries = annAllocPts(m, dim);
+
+	for (int i = 0; i < n; i++)
+		for (int d = 0; d < dim; d++)
+			data[i][d] = uniform(random);
+
+	for (int q = 0; q < m; q++)				// overlapping the data in part
+		for (int d = 0; d < dim; d++)
+			queries[q][d] = uniform(random) + 0.25;
+
+	vector<ANNdist> exact = bruteForce(queries, m, data, n, dim, kmax);
+
+	ANNkd_tree * qkd = new ANNkd_tree(queries, m, dim);
+	ANNbd_tree * qbd = new ANNbd_tree(queries, m, dim);
+	ANNkd_tree * rkd = new ANNkd_tree(data, n, dim);
+	ANNbd_tree * rbd = new ANNbd_tree(data, n, dim);
+	ANNkd_tree * qtrees[] = {qkd, qbd};
+	ANNkd_tree * rtrees[] = {rkd, rbd};
+	const char * names[2][2] = {{"kd with kd", "kd with bd"}, {"bd with kd", "bd with bd"}};
+
+	for (int j = 0; j < nk; j++)
+	{
+		int k = ks[j];
+
+		for (int h = 0; h < nt; h++)
+		{
+			for (int a = 0; a < 2; a++)
+			{
+				for (int b = 0; b < 2; b++)
+				{
+					CheckSink sink(m, k);
+
+					annKnnJoin(*qtrees[a], *rtrees[b], k, sink, 0.0, ts[h]);
+					sink.checkOnce(names[a][b], ts[h]);
+					checkAll(queries, m, data, n, dim, k, kmax, exact,
+						sink.idx, sink.dists, names[a][b], ts[h]);
+
+					vector<ANNidx> nn_idx((size_t)m * k, -1);
+					vector<ANNdist> dd((size_t)m * k, -1);
+
+					annKnnJoin(*qtrees[a], *rtrees[b], k, &nn_idx[0], &dd[0], 0.0, ts[h]);
+					checkAll(queries, m, data, n, dim, k, kmax, exact,
+						nn_idx, dd, names[a][b], ts[h]);
+				}
+
+				CheckSink sink(m, k);				// queries as an array
+
+				annKnnJoin(queries, m, *rtrees[a], k, sink, 0.0, ts[h]);
+				sink.checkOnce("array", ts[h]);
+				checkAll(queries, m, data, n, dim, k, kmax, exact,
+					sink.idx, sink.dists, "array", ts[h]);
+			}
+		}
+	}
+
+	delete qkd;								// before annClose()
+	delete qbd;
+
+	const int big = 70000, kbig = 4;		// more than one chunk (2^16)
+	ANNpointArray many = annAllocPts(big, dim);
+
+	for (int q = 0; q < big; q++)
+		for (int d = 0; d < dim; d++)
+			many[q][d] = uniform(random);
+
+	exact = bruteForce(many, big, data, n, dim, kbig);
+
+	for (int b = 0; b < 2; b++)
+	{
+		CheckSink sink(big, kbig);
+
+		annKnnJoin(many, big, *rtrees[b], kbig, sink, 0.0, 1);
+		sink.checkOnce("many queries", 1);
+		checkAll(many, big, data, n, dim, kbig, kbig, exact,
+			sink.idx, sink.dists, "many queries", 1);
+
+		if (sink.calls < 2)
+			fail("many queries were not split into chunks", "many queries", kbig, 1, -1);
+	}
+
+	delete rkd;
+	delete rbd;
+	annDeallocPts(many);
+	annDeallocPts(data);
+	annDeallocPts(queries);
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "knn_join_test passed\n";
+	return EXIT_SUCCESS;
+}
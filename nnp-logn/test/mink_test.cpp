@@ -0,0 +1,197 @@
+// A test of the k smallest list used by the searches (see pr_queue_k.h).
+// It feeds the same stream of keys to ANNmink and to a plain sorted list,
+// which is how ANNmink kept its items for every k before the heap was
+// added, and checks that maxkey() agrees after every insertion.  The
+// searches only look at the list through maxkey(), both to decide which
+// points to insert and to prune boxes (scaled by eps), and stop after
+// annMaxPtsVisit() points, so if maxkey() agrees at every step a search
+// limited by eps or by the number of points visited returns the same
+// points with either list.  The keys are the distances from query points
+// to random data points, in random order, with some repeated keys.
+//
+// It then runs searches with k above the sorted list limit in kd- and
+// bd-trees, with eps > 0 and a limit on the points visited, and checks
+// that they are repeatable and that the limit only ever makes the results
+// worse, and runs exact searches and checks them against brute force.
+//
+// After compiling it can be run as follows.
+//
+// mink_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+#include "pr_queue_k.h"
+
+using namespace std;
+
+// The list as ANNmink kept it before the heap: sorted, by insertion sort
+class SortedList
+{
+	int k;
+	vector<PQKkey> keys;
+
+public:
+	SortedList(int k) : k(k) {}
+
+	PQKkey maxkey() const
+	{
+		return ((int)keys.size() == k ? keys[k - 1] : PQ_NULL_KEY);
+	}
+
+	void insert(PQKkey key)
+	{
+		keys.insert(upper_bound(keys.begin(), keys.end(), key), key);
+
+		if ((int)keys.size() > k)
+			keys.pop_back();
+	}
+
+	PQKkey ith(int i) const
+	{
+		return (i < (int)keys.size() ? keys[i] : PQ_NULL_KEY);
+	}
+};
+
+int failures = 0;
+
+void fail(const char * what, int k, int step)
+{
+	if (++failures <= 20)
+		cerr << what << " (k = " << k << ", step " << step << ")\n";
+}
+
+// Feeds the keys to both lists as a search would, with the given eps
+void checkList(ANNmink & mink, const vector<PQKkey> & keys, int k, double eps)
+{
+	SortedList ref(k);
+	double scale = (1 + eps) * (1 + eps);
+
+	mink.reset(k);
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (mink.maxkey() != ref.maxkey())
+			fail("maxkey() differs", k, (int)i);
+
+		if (keys[i] * scale >= ref.maxkey())	// pruned, as a box would be
+			continue;
+
+		mink.insert(keys[i], (int)i);
+		ref.insert(keys[i]);
+
+		if (i % 97 == 0)						// extract part way through
+		{
+			if (mink.ith_smallestkey(0) != ref.ith(0))
+				fail("ith_smallestkey() differs", k, (int)i);
+		}
+	}
+
+	for (int i = 0; i < k; i++)
+	{
+		if (mink.ith_smallestkey(i) != ref.ith(i))
+			fail("final keys differ", k, i);
+	}
+}
+
+int main()
+{
+	const int dim = 8, n = 20000, m = 20;
+	static const int ks[] = {1, 10, 32, 33, 100, 128, 129, 200, 500, 1000};
+	const int nk = sizeof(ks) / sizeof(ks[0]);
+
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+
+	ANNpointArray data = annAllocPts(n, dim);
+	ANNpointArray queries = annAllocPts(m, dim);
+
+	for (int i = 0; i < n; i++)
+		for (int d = 0; d < dim; d++)
+			data[i][d] = uniform(random);
+
+	for (int q = 0; q < m; q++)
+		for (int d = 0; d < dim; d++)
+			queries[q][d] = uniform(random);
+
+	ANNmink mink;							// reused, as in the searches
+
+	for (int q = 0; q < m; q++)
+	{
+		vector<PQKkey> keys(n);
+
+		for (int i = 0; i < n; i++)				// every tenth key repeated
+			keys[i] = annDist(dim, queries[q], data[i % 10 == 0 && i > 0 ? i - 1 : i]);
+
+		shuffle(keys.begin(), keys.end(), random);
+
+		for (int j = 0; j < nk; j++)
+		{
+			checkList(mink, keys, ks[j], 0.0);
+			checkList(mink, keys, ks[j], 0.5);
+		}
+	}
+
+	ANNkd_tree * kd = new ANNkd_tree(data, n, dim);
+	ANNbd_tree * bd = new ANNbd_tree(data, n, dim);
+	ANNbruteForce brute(data, n, dim);
+	ANNpointSet * trees[] = {kd, bd};
+
+	for (int j = 0; j < nk; j++)
+	{
+		int k = ks[j];
+		vector<ANNidx> idx(k);
+		vector<ANNdist> exact(k), limited(k), again(k);
+
+		for (int q = 0; q < m; q++)
+		{
+			brute.annkSearch(queries[q], k, &idx[0], &exact[0]);
+
+			for (int t = 0; t < 2; t++)
+			{
+				vector<ANNdist> dists(k);
+
+				annMaxPtsVisit(0);
+				trees[t]->annkSearch(queries[q], k, &idx[0], &dists[0]);
+
+				if (dists != exact)
+					fail("exact search differs from brute force", k, q);
+
+				annMaxPtsVisit(300);
+				trees[t]->annkSearch(queries[q], k, &idx[0], &limited[0], 0.5);
+				trees[t]->annkSearch(queries[q], k, &idx[0], &again[0], 0.5);
+
+				if (limited != again)
+					fail("limited search is not repeatable", k, q);
+
+				for (int i = 0; i < k; i++)
+				{
+					if (limited[i] < exact[i])
+						fail("limited search beats exact search", k, q);
+				}
+			}
+		}
+	}
+
+	annMaxPtsVisit(0);
+	delete kd;								// before annClose()
+	delete bd;
+	annDeallocPts(data);
+	annDeallocPts(queries);
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "mink_test passed\n";
+	return EXIT_SUCCESS;
+}
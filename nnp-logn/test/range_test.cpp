@@ -0,0 +1,221 @@
+// A test of the orthogonal range queries (see kd_range_search.cpp).  It
+// runs annRangeCount and annRangeSearch in kd- and bd-trees over many boxes
+// and checks them against a brute force scan of the points.  The count must
+// be the number of points p with lo[d] <= p[d] <= hi[d] in every dimension
+// d, and the search must return the same count and min(k, count) distinct
+// indices, all of points in the box (with k at least the count, exactly
+// the points in the box).
+//
+// Most of the points lie on a coarse grid, with many repeated, and most of
+// the boxes have their faces on the coordinates of data points, so that
+// points lie on the faces, edges and corners of the boxes (the box is
+// closed, so they are in it).  The boxes also include single points (lo =
+// hi), the bounding box of the points, boxes beyond the points, boxes with
+// lo > hi in some dimension (which hold no points) and random boxes.
+//
+// After compiling it can be run as follows.
+//
+// range_test
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ANN/ANN.h>
+#include <ANN/ANNx.h>
+
+using namespace std;
+
+int failures = 0;
+
+void fail(const char * what, const char * tree, int box, int k)
+{
+	if (++failures <= 20)
+		cerr << what << " (" << tree << " tree, box " << box << ", k = " << k << ")\n";
+}
+
+// The points in the box, by brute force
+vector<ANNidx> inBox(ANNpointArray data, int n, int dim, ANNpoint lo, ANNpoint hi)
+{
+	vector<ANNidx> in;
+
+	for (int i = 0; i < n; i++)
+	{
+		int d = 0;
+
+		while (d < dim && lo[d] <= data[i][d] && data[i][d] <= hi[d])
+			d++;
+
+		if (d == dim)
+			in.push_back(i);
+	}
+
+	return in;
+}
+
+// Checks the tree's count and searches for a box against brute force
+void checkBox(ANNkd_tree & tree, const char * name, ANNpointArray data, int n,
+	int dim, ANNorthRect & box, int b)
+{
+	vector<ANNidx> exact = inBox(data, n, dim, box.lo, box.hi);
+	int count = (int)exact.size();
+
+	if (tree.annRangeCount(box.lo, box.hi) != count)
+		fail("count differs from brute force", name, b, 0);
+
+	if (tree.annRangeCount(box) != count)
+		fail("count (ANNorthRect) differs from brute force", name, b, 0);
+
+	if (tree.annRangeSearch(box.lo, box.hi) != count)
+		fail("search count differs from brute force", name, b, 0);
+
+	int ks[] = {1, 5, count, count + 3};
+
+	for (int j = 0; j < 4; j++)
+	{
+		int k = ks[j];
+
+		if (k == 0)
+			continue;
+
+		vector<ANNidx> idx(k, -1);
+		int m = (j % 2 == 0 ? tree.annRangeSearch(box.lo, box.hi, k, &idx[0])
+							: tree.annRangeSearch(box, k, &idx[0]));
+
+		if (m != count)
+			fail("search count differs from brute force", name, b, k);
+
+		int stored = min(k, count);
+		vector<ANNidx> got(idx.begin(), idx.begin() + stored);
+
+		sort(got.begin(), got.end());
+
+		if (adjacent_find(got.begin(), got.end()) != got.end())
+			fail("search returned a point twice", name, b, k);
+
+		for (int i = 0; i < stored; i++)
+		{
+			if (!binary_search(exact.begin(), exact.end(), got[i]))
+			{
+				fail("search returned a point outside the box", name, b, k);
+				break;
+			}
+		}
+
+		if (k >= count && got != exact)
+			fail("search did not return every point in the box", name, b, k);
+	}
+}
+
+int main()
+{
+	const int dim = 3, grid = 4000, n = 5000;
+
+	mt19937 random(12345);
+	uniform_real_distribution<double> uniform(0, 1);
+	uniform_int_distribution<int> cell(0, 10);
+
+	ANNpointArray data = annAllocPts(n, dim);
+
+	for (int i = 0; i < n; i++)				// on a grid of spacing 0.1,
+		for (int d = 0; d < dim; d++)		// ...then anywhere
+			data[i][d] = (i < grid ? cell(random) * 0.1 : uniform(random));
+
+	vector<ANNorthRect *> boxes;
+
+	for (int b = 0; b < 300; b++)			// faces through data points
+	{
+		ANNpoint p = data[random() % n], q = data[random() % n];
+		ANNorthRect * box = new ANNorthRect(dim);
+
+		for (int d = 0; d < dim; d++)
+		{
+			box->lo[d] = min(p[d], q[d]);
+			box->hi[d] = max(p[d], q[d]);
+		}
+
+		boxes.push_back(box);
+	}
+
+	for (int b = 0; b < 50; b++)			// single data points
+	{
+		ANNpoint p = data[random() % n];
+		boxes.push_back(new ANNorthRect(dim, p, p));
+	}
+
+	ANNorthRect * all = new ANNorthRect(dim);	// the bounding box
+
+	for (int d = 0; d < dim; d++)
+	{
+		all->lo[d] = all->hi[d] = data[0][d];
+
+		for (int i = 1; i < n; i++)
+		{
+			all->lo[d] = min(all->lo[d], data[i][d]);
+			all->hi[d] = max(all->hi[d], data[i][d]);
+		}
+	}
+
+	boxes.push_back(all);
+	boxes.push_back(new ANNorthRect(dim, 1.5, 2));	// beyond the points
+	boxes.push_back(new ANNorthRect(dim, -1, 0));	// touching the grid's corner
+
+	for (int b = 0; b < 20; b++)			// lo > hi in one dimension
+	{
+		ANNorthRect * box = new ANNorthRect(dim, 0, 1);
+		int d = random() % dim;
+
+		box->lo[d] = 0.6;
+		box->hi[d] = 0.4;
+		boxes.push_back(box);
+	}
+
+	for (int b = 0; b < 100; b++)			// random
+	{
+		ANNorthRect * box = new ANNorthRect(dim);
+
+		for (int d = 0; d < dim; d++)
+		{
+			double a = uniform(random) * 1.2 - 0.1, c = uniform(random) * 1.2 - 0.1;
+
+			box->lo[d] = min(a, c);
+			box->hi[d] = max(a, c);
+		}
+
+		boxes.push_back(box);
+	}
+
+	ANNkd_tree * kd = new ANNkd_tree(data, n, dim);
+	ANNkd_tree * kd5 = new ANNkd_tree(data, n, dim, 5);
+	ANNbd_tree * bd = new ANNbd_tree(data, n, dim);
+	ANNbd_tree * bdc = new ANNbd_tree(data, n, dim, 1, ANN_KD_SUGGEST, ANN_BD_CENTROID);
+	ANNkd_tree * trees[] = {kd, kd5, bd, bdc};
+	const char * names[] = {"kd", "kd (bucket size 5)", "bd", "bd (centroid shrink)"};
+
+	for (int t = 0; t < 4; t++)
+		for (size_t b = 0; b < boxes.size(); b++)
+			checkBox(*trees[t], names[t], data, n, dim, *boxes[b], (int)b);
+
+	for (size_t b = 0; b < boxes.size(); b++)
+		delete boxes[b];
+
+	delete kd;								// before annClose()
+	delete kd5;
+	delete bd;
+	delete bdc;
+	annDeallocPts(data);
+	annClose();
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "range_test passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,996 @@
+// Two engines to find the closest pair of points in a given set of n points
+// in d dimensions: a divide and conquer one that takes O(nlogn) time, and a
+// grid one that takes O(n) expected time.
+//
+// The points are passed as one array of n * dim coordinates, point after
+// point, of any arithmetic type (int, float, double, ...).  The result gives
+// the indices of the two closest points along with their distance.
+//
+//		std::vector<float> pts(2 * n);		// x0, y0, x1, y1, ...
+//		ClosestPairResult r = closestPair(&pts[0], n, 2);
+//		// r.first, r.second, r.distance
+//
+// The divide and conquer engine
+//
+// The points are sorted by x once.  The recursion then returns each half
+// sorted by y, so that a level only has to merge its two halves instead of
+// sorting again.  All levels share one scratch buffer of n records, which
+// also holds the strip, so the engine needs two arrays of n records in all
+// (a record is the x and y coordinates of a point and its index) and does
+// no allocation during the recursion.
+//
+// The strip is searched by y only, so in 3 or more dimensions the O(nlogn)
+// bound holds for well spread points but not in every case: points that are
+// close in x and y but far apart in the other coordinates all end up in the
+// strip, and it then takes O(n^2) time.  The result is exact in any
+// dimension.  CLOSEST_PAIR_AUTO guards against this (see below).
+//
+// The search runs on several threads (all the cores by default).  The two
+// halves of a large enough set are searched as two tasks, each with its own
+// share of the threads, and the sort, the merges and the strip filters of
+// large sets are split among the threads of their level.  If several pairs
+// are equally close, which of them is found may depend on the threads.
+//
+// The grid engine
+//
+// This is Rabin's randomized algorithm.  The closest pair of a random sample
+// of about 2 sqrt(n) points is found first, and its distance, delta, is an
+// upper bound on the closest distance of all the points.  The space is then
+// cut into a grid of cubes of side delta, so that the closest pair is either
+// in one cube or in two neighboring ones, and the expected number of pairs
+// this leaves to check is O(n) whatever the points.  Rather than in a hash
+// table, the points are put in order of their cube by a radix sort, which
+// takes linear time.  Each cube then finds its neighbors that come before it
+// with one pointer per direction, and since the cubes are taken in order,
+// each pointer only moves forward, so the search reads the points in order
+// and needs no more memory than the other engine.
+//
+// The grid engine looks at 3^d cubes around each point and needs a grid that
+// fits in 63-bit cube numbers, so it gives way to the divide and conquer
+// engine in high dimensions and when the sample is much closer than the
+// points are spread.  By default (CLOSEST_PAIR_AUTO) the engine is chosen from
+// n and the dimension; see ClosestPairOfPoints_Benchmark.cpp for the timings
+// behind the choice.  Where the divide and conquer engine is chosen in 3 or
+// more dimensions, it is given a budget of 3^d n strip comparisons, about
+// what the grid engine spends on its neighboring cubes.  If the strips use
+// it up, the search is handed over to the grid engine, so that no input
+// takes O(n^2) time up to the grid's highest dimension.
+
+#ifndef CLOSEST_PAIR_H
+#define CLOSEST_PAIR_H
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Maps a coordinate to an unsigned integer key in the same order, for the
+// radix sort by x.  Signed integers have their sign bit flipped, and floating
+// point numbers are taken bit for bit, with all the bits of negative numbers
+// flipped (so that they count down) and the sign bit of the others set.
+template <typename T>
+inline unsigned long long radixKey(T x)
+{
+	if (std::numeric_limits<T>::is_integer)
+	{
+		unsigned long long k = (unsigned long long) x;
+
+		if (std::numeric_limits<T>::is_signed)
+			k ^= 1ULL << 63;
+
+		return k;
+	}
+
+	if (sizeof(T) == sizeof(float))
+	{
+		float f = (float) x;
+		unsigned int b;
+
+		memcpy(&b, &f, sizeof(b));
+		return (b >> 31) ? (unsigned int) ~b : (b | 0x80000000u);
+	}
+
+	double d = (double) x;
+	unsigned long long b;
+
+	memcpy(&b, &d, sizeof(b));
+	return (b >> 63) ? ~b : (b | (1ULL << 63));
+}
+
+// Runs f(t) for t = 0 .. threads - 1, each on a thread of its own
+// (t = 0 on the calling thread), and waits for all of them
+template <typename F>
+void runThreads(int threads, F f)
+{
+	std::vector<std::thread> pool;
+
+	for (int t = 1; t < threads; ++t)
+		pool.push_back(std::thread(f, t));
+
+	f(0);
+
+	for (size_t t = 0; t < pool.size(); ++t)
+		pool[t].join();
+}
+
+// The engines
+enum ClosestPairMethod
+{
+	CLOSEST_PAIR_AUTO,		// chosen from n and the dimension
+	CLOSEST_PAIR_DIVIDE,	// divide and conquer
+	CLOSEST_PAIR_GRID		// grid, falling back to divide and conquer
+};
+
+// The result of a search: the indices of the closest two points
+// (first < second) and the distance between them.  If there are fewer
+// than 2 points, the indices are npos and the distance is infinite.
+struct ClosestPairResult
+{
+	static const size_t npos = (size_t) -1;
+
+	size_t first, second;	// indices of the two points
+	double distance;		// Euclidean distance between them
+
+	ClosestPairResult()
+		: first(npos), second(npos), distance(std::numeric_limits<double>::infinity())
+	{
+	}
+
+	bool found() const
+	{
+		return first != npos;
+	}
+};
+
+// The engine.  T is the coordinate type and Index the type used to store
+// point indices in the records (unsigned int halves the memory needed for
+// the indices, as long as n fits in it).  An engine keeps its buffers from
+// one search to the next; release() frees them.
+template <typename T, typename Index = size_t>
+class ClosestPair
+{
+public:
+	ClosestPairResult find(const T * coords, size_t n, int dim = 2, int threads = 0,
+		ClosestPairMethod method = CLOSEST_PAIR_AUTO);
+
+	void release()
+	{
+		std::vector<Record>().swap(work);
+		std::vector<Record>().swap(scratch);
+	}
+
+private:
+	struct Record
+	{
+		T x, y;				// first two coordinates (y = x if dim is 1)
+		Index id;			// index of the point
+	};
+
+	// Orders records by y coordinate
+	struct CompareY
+	{
+		bool operator()(const Record & a, const Record & b) const
+		{
+			return a.y < b.y;
+		}
+	};
+
+	// Orders records by x coordinate
+	struct CompareX
+	{
+		bool operator()(const Record & a, const Record & b) const
+		{
+			return a.x < b.x;
+		}
+	};
+
+	// The closest pair found so far
+	struct Best
+	{
+		double sq;			// squared distance
+		Index i, j;			// points
+	};
+
+	// Sets of at most this many points are not split any further
+	static const size_t leafSize = 64;
+
+	// Sets of fewer points than this are searched on one thread
+	static const size_t parallelSize = 1 << 15;
+
+	// Radix sort key of the x coordinate
+	struct XKey
+	{
+		unsigned long long operator()(const Record & r) const
+		{
+			return radixKey(r.x);
+		}
+	};
+
+	// Number of the cube of the grid that holds a point.  The cube
+	// numbers along each dimension are offset by 1, so that the
+	// neighbors of every cube also have numbers in the grid.
+	struct CellKey
+	{
+		const T * points;		// coordinates of the points
+		int dim;				// dimension of space
+		const double * lo;		// low corner of the grid
+		double scale;			// cubes per unit length
+		const long long * stride;	// step in cube number along each dimension
+
+		long long cell(const Record & r) const
+		{
+			long long c = ((long long) std::floor(((double) r.x - lo[0]) * scale) + 1) * stride[0];
+
+			if (dim > 1)
+				c += ((long long) std::floor(((double) r.y - lo[1]) * scale) + 1) * stride[1];
+
+			if (dim > 2)
+			{
+				const T * p = points + (size_t) r.id * dim;
+
+				for (int k = 2; k < dim; ++k)
+					c += ((long long) std::floor(((double) p[k] - lo[k]) * scale) + 1) * stride[k];
+			}
+
+			return c;
+		}
+
+		unsigned long long operator()(const Record & r) const
+		{
+			return (unsigned long long) cell(r);
+		}
+	};
+
+	// The grid engine is not used in more dimensions than this
+	static const int gridMaxDim = 6;
+
+	// CLOSEST_PAIR_AUTO picks the grid engine for at least this many points
+	// in at most this many dimensions (in 3 and more, the grid engine loses
+	// to the other one on uniform and on clustered points alike, so there
+	// the other one runs with a budget of strip comparisons instead)
+	static const size_t gridAutoSize = 1000;
+	static const int gridAutoDim = 2;
+
+	// The strip comparisons are taken from the budget this many at a time
+	static const long long stripChunk = 4096;
+
+	std::vector<Record> work;		// the points, sorted by x
+	std::vector<Record> scratch;	// merge and strip buffer
+
+	const T * points;				// coordinates of the points
+	int dim;						// dimension of space
+
+	std::atomic<long long> stripBudget;	// strip comparisons left (< 0: gave up)
+
+	void fillWork(size_t n, int threads);
+	double distSq(const Record & a, const Record & b, double bound) const;
+	void consider(const Record & a, const Record & b, Best & best) const;
+	template <typename Key>
+	void sortBy(size_t n, int threads, const Key & key);
+	void sortByX(size_t n, int threads);
+	bool gridSearch(size_t n, int threads, Best & best);
+	static void mergeY(const Record * a, size_t na, const Record * b, size_t nb, Record * out);
+	static void mergeY(const Record * a, size_t na, const Record * b, size_t nb, Record * out, int threads);
+	static size_t filterStrip(const Record * a, size_t n, double midX, double bestSq, Record * strip, int threads);
+	void stripClosest(const Record * strip, size_t n, Best & best);
+	void closestUtil(Record * a, Record * s, size_t n, bool toA, Best & best, int threads);
+};
+
+// Squared distance between two points.  Differences are taken in double
+// so that integer coordinates cannot overflow.  Once the distance exceeds
+// bound, the rest of the coordinates may be skipped.
+template <typename T, typename Index>
+inline double ClosestPair<T, Index>::distSq(const Record & a, const Record & b, double bound) const
+{
+	double dx = (double) a.x - (double) b.x;
+
+	if (dim == 1)
+		return dx * dx;
+
+	double dy = (double) a.y - (double) b.y;
+	double d = dx * dx + dy * dy;
+
+	if (dim > 2)
+	{
+		const T * p = points + (size_t) a.id * dim;
+		const T * q = points + (size_t) b.id * dim;
+
+		// Stop as soon as the pair cannot be the closest one
+		for (int k = 2; k < dim && d < bound; ++k)
+		{
+			double t = (double) p[k] - (double) q[k];
+			d += t * t;
+		}
+	}
+
+	return d;
+}
+
+// Records the pair (a, b) if it is the closest one so far
+template <typename T, typename Index>
+inline void ClosestPair<T, Index>::consider(const Record & a, const Record & b, Best & best) const
+{
+	double d = distSq(a, b, best.sq);
+
+	if (d < best.sq)
+	{
+		best.sq = d;
+		best.i = a.id;
+		best.j = b.id;
+	}
+}
+
+// Sorts work[] by key(), which maps a record to an unsigned 64-bit key, with
+// scratch[] as the second buffer.  This is a radix sort, a byte at a time
+// from the lowest, on the keys less the smallest key, so it takes as many
+// passes as the range of the keys has bytes; a byte that is the same in all
+// keys is skipped.  Each thread counts and then moves the records of its
+// own slice of the array, the slices of all threads going to each bucket
+// one after the other, so the sort stays stable.
+template <typename T, typename Index>
+template <typename Key>
+void ClosestPair<T, Index>::sortBy(size_t n, int threads, const Key & key)
+{
+	if (n < parallelSize)
+		threads = 1;
+
+	Record * from = &work[0];
+	Record * to = &scratch[0];
+
+	std::vector<unsigned long long> los(threads), his(threads);
+
+	runThreads(threads, [&](int t)
+	{
+		size_t i0 = n * t / threads, i1 = n * (t + 1) / threads;
+		unsigned long long lo = ~0ULL, hi = 0;
+
+		for (size_t i = i0; i < i1; ++i)
+		{
+			unsigned long long k = key(from[i]);
+
+			lo = std::min(lo, k);
+			hi = std::max(hi, k);
+		}
+
+		los[t] = lo;
+		his[t] = hi;
+	});
+
+	unsigned long long lo = *std::min_element(los.begin(), los.end());
+	unsigned long long hi = *std::max_element(his.begin(), his.end());
+
+	// count[t * 256 + b] is the number of records in slice t with byte b
+	std::vector<size_t> count(threads * 256);
+
+	for (int shift = 0; shift < 64 && ((hi - lo) >> shift) != 0; shift += 8)
+	{
+		std::fill(count.begin(), count.end(), 0);
+
+		runThreads(threads, [&](int t)
+		{
+			size_t * c = &count[t * 256];
+
+			for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+				++c[((key(from[i]) - lo) >> shift) & 255];
+		});
+
+		// Turn the counts into starting positions (and skip the pass if
+		// all the records have the same byte)
+		size_t start = 0;
+		bool same = false;
+
+		for (int b = 0; b < 256; ++b)
+		{
+			size_t total = 0;
+
+			for (int t = 0; t < threads; ++t)
+			{
+				size_t c = count[t * 256 + b];
+				count[t * 256 + b] = start + total;
+				total += c;
+			}
+
+			same = same || total == n;
+			start += total;
+		}
+
+		if (same)
+			continue;
+
+		runThreads(threads, [&](int t)
+		{
+			size_t * c = &count[t * 256];
+
+			for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+				to[c[((key(from[i]) - lo) >> shift) & 255]++] = from[i];
+		});
+
+		std::swap(from, to);
+	}
+
+	if (from != &work[0])
+		work.swap(scratch);
+}
+
+// Sorts work[] by x.  Wider types than 64 bits fall back to std::sort.
+template <typename T, typename Index>
+void ClosestPair<T, Index>::sortByX(size_t n, int threads)
+{
+	if (sizeof(T) > sizeof(unsigned long long))
+		std::sort(work.begin(), work.end(), CompareX());
+	else
+		sortBy(n, threads, XKey());
+}
+
+// Merges a[0..na) and b[0..nb), both sorted by y, into out[].  The loop
+// picks each record without a branch on the comparison, which the processor
+// could not predict.
+template <typename T, typename Index>
+void ClosestPair<T, Index>::mergeY(const Record * a, size_t na, const Record * b, size_t nb, Record * out)
+{
+	const Record * ae = a + na;
+	const Record * be = b + nb;
+
+	while (a < ae && b < be)
+	{
+		bool takeB = b->y < a->y;
+
+		*out++ = takeB ? *b : *a;
+		b += takeB;
+		a += !takeB;
+	}
+
+	while (a < ae)
+		*out++ = *a++;
+
+	while (b < be)
+		*out++ = *b++;
+}
+
+// Merges a[0..na) and b[0..nb), both sorted by y, into out[] on the given
+// number of threads.  Each thread makes its own share of out[]: a binary
+// search finds where the share starts in a[] and in b[], and the thread then
+// merges from there.
+template <typename T, typename Index>
+void ClosestPair<T, Index>::mergeY(const Record * a, size_t na, const Record * b, size_t nb, Record * out, int threads)
+{
+	size_t n = na + nb;
+
+	if (threads <= 1 || n < parallelSize)
+	{
+		mergeY(a, na, b, nb, out);
+		return;
+	}
+
+	// The number of records of a[] among the first o of the merge
+	struct Split
+	{
+		static size_t find(const Record * a, size_t na, const Record * b, size_t nb, size_t o)
+		{
+			size_t lo = (o > nb) ? o - nb : 0;
+			size_t hi = std::min(o, na);
+
+			// A record of a[] goes before an equal one of b[]
+			while (lo < hi)
+			{
+				size_t i = lo + (hi - lo) / 2;
+
+				if (a[i].y <= b[o - i - 1].y)
+					lo = i + 1;
+				else
+					hi = i;
+			}
+
+			return lo;
+		}
+	};
+
+	runThreads(threads, [&](int t)
+	{
+		size_t o0 = n * t / threads, o1 = n * (t + 1) / threads;
+		size_t i0 = Split::find(a, na, b, nb, o0);
+		size_t i1 = Split::find(a, na, b, nb, o1);
+
+		mergeY(a + i0, i1 - i0, b + (o0 - i0), (o1 - i1) - (o0 - i0), out + o0);
+	});
+}
+
+// Copies the points of a[0..n) that are closer than the best distance to the
+// vertical line at midX into strip[], in order, and returns their number.
+// On several threads, each one counts the points of its slice of a[] first,
+// to learn where to put them.
+template <typename T, typename Index>
+size_t ClosestPair<T, Index>::filterStrip(const Record * a, size_t n, double midX, double bestSq, Record * strip, int threads)
+{
+	if (threads <= 1 || n < parallelSize)
+	{
+		size_t m = 0;
+
+		// strip[m] (m <= i) is free, so it can always be written
+		for (size_t i = 0; i < n; ++i)
+		{
+			double dx = (double) a[i].x - midX;
+
+			strip[m] = a[i];
+			m += (dx * dx < bestSq);
+		}
+
+		return m;
+	}
+
+	std::vector<size_t> starts(threads + 1, 0);
+
+	runThreads(threads, [&](int t)
+	{
+		size_t m = 0;
+
+		for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+		{
+			double dx = (double) a[i].x - midX;
+			m += (dx * dx < bestSq);
+		}
+
+		starts[t + 1] = m;
+	});
+
+	for (int t = 0; t < threads; ++t)
+		starts[t + 1] += starts[t];
+
+	runThreads(threads, [&](int t)
+	{
+		size_t m = starts[t];
+
+		for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+		{
+			double dx = (double) a[i].x - midX;
+
+			if (dx * dx < bestSq)
+				strip[m++] = a[i];
+		}
+	});
+
+	return starts[threads];
+}
+
+// Finds the closest points among the n points of strip[], which are sorted
+// by y.  Each point is compared with the ones after it until they differ by
+// the best distance so far in y alone, which in the plane takes a few
+// steps at most.  The comparisons are taken from stripBudget, and the
+// search stops once it runs out.
+template <typename T, typename Index>
+void ClosestPair<T, Index>::stripClosest(const Record * strip, size_t n, Best & best)
+{
+	long long steps = 0;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		for (size_t j = i + 1; j < n; ++j)
+		{
+			double dy = (double) strip[j].y - (double) strip[i].y;
+
+			if (dy * dy >= best.sq)
+				break;
+
+			consider(strip[i], strip[j], best);
+
+			if (++steps == stripChunk)
+			{
+				if ((stripBudget -= steps) < 0)
+					return;
+
+				steps = 0;
+			}
+		}
+	}
+
+	stripBudget -= steps;
+}
+
+// A recursive function to find the closest pair among the n points of a[],
+// which are sorted by x, and to update best with it.  The points are
+// returned sorted by y, in a[] if toA is set and in s[] otherwise.  s[] is
+// scratch space for n records.  The two buffers take turns from one level
+// to the next, so that a level merges the halves straight from one into the
+// other and never copies.  threads is the number of threads this call may
+// keep busy.
+template <typename T, typename Index>
+void ClosestPair<T, Index>::closestUtil(Record * a, Record * s, size_t n, bool toA, Best & best, int threads)
+{
+	// Two equal points cannot be beaten, so there is nothing left to do
+	// (and the order of the points no longer matters).  Nor is there once
+	// the strip budget has run out.
+	if (best.sq == 0 || stripBudget < 0)
+		return;
+
+	// If there are only a few points, then sort them by y and compare each
+	// with the next ones until the difference in y alone is too large
+	if (n <= leafSize)
+	{
+		Record * out = toA ? a : s;
+
+		// Insertion sort by y (into out[])
+		for (size_t i = 0; i < n; ++i)
+		{
+			Record r = a[i];
+			size_t j = i;
+
+			for (; j > 0 && r.y < out[j - 1].y; --j)
+				out[j] = out[j - 1];
+
+			out[j] = r;
+		}
+
+		stripClosest(out, n, best);
+		return;
+	}
+
+	// Split around the vertical line through the middle point
+	size_t mid = n / 2;
+	double midX = (double) a[mid].x;
+
+	// The halves come back sorted by y in the buffer this level does not
+	// return in, so merge them from there.  A large enough set has its left
+	// half searched on a new thread, with its own closest pair so far.
+	if (threads > 1 && n >= parallelSize)
+	{
+		int leftThreads = threads / 2;
+		Best left = best;
+
+		std::thread task([&]
+		{
+			closestUtil(a, s, mid, !toA, left, leftThreads);
+		});
+
+		closestUtil(a + mid, s + mid, n - mid, !toA, best, threads - leftThreads);
+		task.join();
+
+		if (left.sq < best.sq)
+			best = left;
+	}
+	else
+	{
+		closestUtil(a, s, mid, !toA, best, 1);
+		closestUtil(a + mid, s + mid, n - mid, !toA, best, 1);
+	}
+
+	if (best.sq == 0 || stripBudget < 0)
+		return;
+
+	Record * from = toA ? s : a;
+	Record * to = toA ? a : s;
+
+	mergeY(from, mid, from + mid, n - mid, to, threads);
+
+	// The halves are no longer needed, so the strip of points closer than
+	// the best distance to the line goes in their place (sorted by y)
+	Record * strip = from;
+	size_t m = filterStrip(to, n, midX, best.sq, strip, threads);
+
+	// Find the closest points in the strip
+	stripClosest(strip, m, best);
+}
+
+// The grid engine: finds the closest pair among the n points of work[],
+// which are in the order of their indices, and stores it in best.  Returns
+// false (and leaves the search to the other engine) if the grid would be
+// too fine or the dimension is too high.
+template <typename T, typename Index>
+bool ClosestPair<T, Index>::gridSearch(size_t n, int threads, Best & best)
+{
+	if (dim > gridMaxDim)
+		return false;
+
+	// Take one point at random from each of m equal slices of the points,
+	// and find the closest pair of this sample.  The seed is fixed, so
+	// that a search gives the same result every time.
+	size_t m = std::min(n, std::max((size_t) 2, (size_t) (2 * std::sqrt((double) n))));
+	std::vector<T> sample(m * dim);
+	std::vector<size_t> sampleIds(m);
+	std::mt19937_64 random(12345);
+
+	for (size_t k = 0; k < m; ++k)
+	{
+		size_t i0 = n * k / m, i1 = n * (k + 1) / m;
+		size_t i = i0 + (size_t) (random() % (i1 - i0));
+
+		sampleIds[k] = i;
+		std::copy(points + i * dim, points + (i + 1) * dim, &sample[k * dim]);
+	}
+
+	ClosestPair<T, Index> sampleEngine;
+	ClosestPairResult r = sampleEngine.find(&sample[0], m, dim, 1, CLOSEST_PAIR_DIVIDE);
+
+	best.i = (Index) sampleIds[r.first];
+	best.j = (Index) sampleIds[r.second];
+	best.sq = distSq(work[best.i], work[best.j], std::numeric_limits<double>::infinity());
+
+	if (best.sq == 0)
+		return true;
+
+	// The bounding box of the points
+	if (n < parallelSize)
+		threads = 1;
+
+	std::vector<double> los(threads * dim), his(threads * dim);
+
+	runThreads(threads, [&](int t)
+	{
+		double * lo = &los[t * dim];
+		double * hi = &his[t * dim];
+
+		std::fill(lo, lo + dim, std::numeric_limits<double>::infinity());
+		std::fill(hi, hi + dim, -std::numeric_limits<double>::infinity());
+
+		for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+		{
+			const T * p = points + i * dim;
+
+			for (int k = 0; k < dim; ++k)
+			{
+				lo[k] = std::min(lo[k], (double) p[k]);
+				hi[k] = std::max(hi[k], (double) p[k]);
+			}
+		}
+	});
+
+	for (int t = 1; t < threads; ++t)
+	{
+		for (int k = 0; k < dim; ++k)
+		{
+			los[k] = std::min(los[k], los[t * dim + k]);
+			his[k] = std::max(his[k], his[t * dim + k]);
+		}
+	}
+
+	// The cubes are made a little wider than delta, so that two points
+	// closer than delta are in neighboring cubes even after the roundoff
+	// in their cube numbers.  That roundoff is below 2^-10 of a cube as long
+	// as there are fewer than 2^40 cubes along each dimension.
+	CellKey key;
+	std::vector<long long> stride(dim);
+
+	key.points = points;
+	key.dim = dim;
+	key.lo = &los[0];
+	key.scale = (1 - 1.0 / 256) / std::sqrt(best.sq);
+	key.stride = &stride[0];
+
+	double size = 1;
+
+	for (int k = dim - 1; k >= 0; --k)
+	{
+		double side = std::floor((his[k] - los[k]) * key.scale) + 1;
+
+		if (!(side < 1e12))
+			return false;
+
+		stride[k] = (long long) size;
+		size *= side + 2;
+
+		if (!(size < 4e18))
+			return false;
+	}
+
+	sortBy(n, threads, key);
+
+	// Number the cubes of the points once, in their new order.  The sort
+	// was the last use of scratch[], so it gives way to the numbers (and is
+	// made again by the next search).
+	std::vector<Record>().swap(scratch);
+
+	const Record * a = &work[0];
+	std::vector<long long> cubes(n);
+	long long * c = &cubes[0];
+
+	runThreads(threads, [&](int t)
+	{
+		for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+			c[i] = key.cell(a[i]);
+	});
+
+	// The directions to the neighbors that come before a cube
+	std::vector<long long> offsets;
+
+	for (int o = 0, all = (int) std::pow(3.0, dim); o < all; ++o)
+	{
+		long long offset = 0;
+
+		for (int k = 0, v = o; k < dim; ++k, v /= 3)
+			offset += (v % 3 - 1) * stride[k];
+
+		if (offset < 0)
+			offsets.push_back(offset);
+	}
+
+	// Split the points among the threads, without splitting a cube
+	std::vector<size_t> starts(threads + 1, n);
+
+	starts[0] = 0;
+
+	for (int t = 1; t < threads; ++t)
+	{
+		size_t i = std::max(starts[t - 1], n * t / threads);
+
+		while (i > 0 && i < n && c[i] == c[i - 1])
+			++i;
+
+		starts[t] = i;
+	}
+
+	std::vector<Best> bests(threads, best);
+
+	runThreads(threads, [&](int t)
+	{
+		Best & local = bests[t];
+		size_t i = starts[t], end = starts[t + 1];
+
+		if (i >= end)
+			return;
+
+		// Start each pointer at the first point at or past its neighbor
+		// of the first cube
+		std::vector<size_t> ptrs(offsets.size());
+
+		for (size_t o = 0; o < offsets.size(); ++o)
+			ptrs[o] = std::lower_bound(c, c + i, c[i] + offsets[o]) - c;
+
+		while (i < end)
+		{
+			// The points of the cube are a[i..e)
+			size_t e = i + 1;
+
+			while (e < end && c[e] == c[i])
+				++e;
+
+			for (size_t p = i; p < e; ++p)
+				for (size_t q = p + 1; q < e; ++q)
+					consider(a[p], a[q], local);
+
+			for (size_t o = 0; o < offsets.size(); ++o)
+			{
+				long long target = c[i] + offsets[o];
+				size_t & p = ptrs[o];
+
+				while (p < i && c[p] < target)
+					++p;
+
+				for (size_t q = p; q < i && c[q] == target; ++q)
+					for (size_t r = i; r < e; ++r)
+						consider(a[q], a[r], local);
+			}
+
+			i = e;
+		}
+	});
+
+	for (int t = 0; t < threads; ++t)
+		if (bests[t].sq < best.sq)
+			best = bests[t];
+
+	return true;
+}
+
+// Fills work[] with the records of the n points, in the order of their
+// indices
+template <typename T, typename Index>
+void ClosestPair<T, Index>::fillWork(size_t n, int threads)
+{
+	Record * w = &work[0];
+	int fillThreads = (n < parallelSize) ? 1 : threads;
+
+	runThreads(fillThreads, [&](int t)
+	{
+		for (size_t i = n * t / fillThreads; i < n * (t + 1) / fillThreads; ++i)
+		{
+			const T * p = points + i * dim;
+
+			w[i].x = p[0];
+			w[i].y = (dim > 1) ? p[1] : p[0];
+			w[i].id = (Index) i;
+		}
+	});
+}
+
+// Finds the closest pair among the n points of coords[] (n * dim coordinates)
+// on the given number of threads (0 for one per core), with the given engine
+template <typename T, typename Index>
+ClosestPairResult ClosestPair<T, Index>::find(const T * coords, size_t n, int dim, int threads,
+	ClosestPairMethod method)
+{
+	if (dim < 1)
+		throw std::invalid_argument("ClosestPair: dimension must be at least 1");
+
+	if (n > 0 && n - 1 > (size_t) std::numeric_limits<Index>::max())
+		throw std::length_error("ClosestPair: too many points for the index type");
+
+	ClosestPairResult result;
+
+	if (n < 2)
+		return result;
+
+	if (threads <= 0)
+		threads = std::max(1, (int) std::thread::hardware_concurrency());
+
+	this->points = coords;
+	this->dim = dim;
+
+	work.resize(n);
+	scratch.resize(n);
+	fillWork(n, threads);
+
+	// In 3 to gridMaxDim dimensions, the automatic choice bounds the strip
+	// comparisons of divide and conquer, and hands over to the grid engine
+	// if they run out
+	bool bounded = false;
+
+	if (method == CLOSEST_PAIR_AUTO)
+	{
+		bounded = (dim > gridAutoDim && dim <= gridMaxDim && n >= gridAutoSize);
+		method = (dim <= gridAutoDim && n >= gridAutoSize) ? CLOSEST_PAIR_GRID : CLOSEST_PAIR_DIVIDE;
+	}
+
+	Best best;
+
+	if (method != CLOSEST_PAIR_GRID || !gridSearch(n, threads, best))
+	{
+		stripBudget = bounded ? (long long) n * (long long) std::pow(3.0, dim)
+			: std::numeric_limits<long long>::max();
+
+		sortByX(n, threads);
+
+		best.sq = std::numeric_limits<double>::infinity();
+		best.i = best.j = 0;
+
+		closestUtil(&work[0], &scratch[0], n, true, best, threads);
+
+		// Out of budget: the grid engine takes over, and should it
+		// refuse, divide and conquer runs again without a budget
+		if (stripBudget < 0)
+		{
+			fillWork(n, threads);
+
+			if (!gridSearch(n, threads, best))
+			{
+				stripBudget = std::numeric_limits<long long>::max();
+				sortByX(n, threads);
+
+				best.sq = std::numeric_limits<double>::infinity();
+				best.i = best.j = 0;
+
+				closestUtil(&work[0], &scratch[0], n, true, best, threads);
+			}
+		}
+	}
+
+	result.first = std::min((size_t) best.i, (size_t) best.j);
+	result.second = std::max((size_t) best.i, (size_t) best.j);
+	result.distance = std::sqrt(best.sq);
+
+	return result;
+}
+
+// Finds the closest pair among the n points of coords[] (n * dim coordinates)
+// on the given number of threads (0 for one per core), with the given engine.
+// The indices are stored in 32 bits whenever n allows it.
+template <typename T>
+ClosestPairResult closestPair(const T * coords, size_t n, int dim = 2, int threads = 0,
+	ClosestPairMethod method = CLOSEST_PAIR_AUTO)
+{
+	if (n <= (size_t) UINT_MAX)
+	{
+		ClosestPair<T, unsigned int> engine;
+		return engine.find(coords, n, dim, threads, method);
+	}
+
+	ClosestPair<T, size_t> engine;
+	return engine.find(coords, n, dim, threads, method);
+}
+
+#endif
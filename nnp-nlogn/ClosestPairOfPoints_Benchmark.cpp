@@ -0,0 +1,99 @@
+// A benchmark of the two closest pair engines of ClosestPair.h.
+// For each dimension and number of points, it times the divide and conquer
+// engine and the grid engine on the same random points and prints which one
+// wins, for points spread uniformly over a cube and for points gathered in
+// a few tight clusters.
+//
+// Usage: benchmark [max points [threads]]	(defaults 10000000 and 1)
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "ClosestPair.h"
+
+using namespace std;
+
+// Fills pts with n points in dim dimensions, either uniform in the unit
+// cube or around 10 centres with a spread of 1% of the cube
+void generatePoints(vector<double> & pts, size_t n, int dim, bool clustered)
+{
+	mt19937_64 random(n * 10 + dim);
+	uniform_real_distribution<double> uniform(0, 1);
+	normal_distribution<double> spread(0, 0.01);
+
+	vector<double> centres(10 * dim);
+
+	for (size_t k = 0; k < centres.size(); k++)
+		centres[k] = uniform(random);
+
+	pts.resize(n * dim);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		const double * c = &centres[(random() % 10) * dim];
+
+		for (int k = 0; k < dim; k++)
+			pts[i * dim + k] = clustered ? c[k] + spread(random) : uniform(random);
+	}
+}
+
+// Seconds per search with the given engine, over enough runs to take
+// at least a tenth of a second
+double timeSearch(const vector<double> & pts, size_t n, int dim, int threads,
+	ClosestPairMethod method, double & distance)
+{
+	ClosestPair<double, unsigned int> engine;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double elapsed = 0;
+	int runs = 0;
+
+	do
+	{
+		distance = engine.find(&pts[0], n, dim, threads, method).distance;
+		runs++;
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	} while (elapsed < 0.1);
+
+	return elapsed / runs;
+}
+
+int main(int argc, char * argv[])
+{
+	size_t maxPoints = (argc > 1) ? (size_t) atof(argv[1]) : 10000000;
+	int threads = (argc > 2) ? atoi(argv[2]) : 1;
+	vector<double> pts;
+
+	cout << "points       dim  data        divide (s)  grid (s)    winner" << endl;
+
+	for (int clustered = 0; clustered < 2; clustered++)
+	{
+		for (int dim = 1; dim <= 4; dim++)
+		{
+			for (size_t n = 1000; n <= maxPoints; n *= 10)
+			{
+				double dDivide, dGrid;
+
+				generatePoints(pts, n, dim, clustered != 0);
+
+				double tDivide = timeSearch(pts, n, dim, threads, CLOSEST_PAIR_DIVIDE, dDivide);
+				double tGrid = timeSearch(pts, n, dim, threads, CLOSEST_PAIR_GRID, dGrid);
+
+				cout << left << setw(13) << n << setw(5) << dim
+					<< setw(12) << (clustered ? "clustered" : "uniform")
+					<< setw(12) << tDivide << setw(12) << tGrid
+					<< (tGrid < tDivide ? "grid" : "divide");
+
+				if (dDivide != dGrid)
+					cout << "  (distances differ!)";
+
+				cout << endl;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+// A check of the closest pair engines of ClosestPair.h against brute force.
+// For each kind of input it runs every engine, on one thread and on four,
+// and checks that they find the same distance as comparing every pair.
+// The inputs are points spread uniformly over a cube, points gathered in a
+// few tight clusters, points on a small integer grid (so with many equally
+// close pairs and some equal points), and points that are close in x and y
+// but far apart in z, which send every point into the strip of the divide
+// and conquer engine.
+//
+// Usage: check
+//
+// It prints the failures, if any, and returns EXIT_FAILURE if there are any.
+// It then times the automatic choice on a large input of the last kind,
+// which takes O(n^2) time if the divide and conquer strips are not bounded.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "ClosestPair.h"
+
+using namespace std;
+
+enum Kind { UNIFORM, CLUSTERED, LATTICE, STACKED };
+
+const char * kindNames[] = { "uniform", "clustered", "lattice", "stacked" };
+
+// Fills pts with n points of the given kind in dim dimensions
+void generatePoints(vector<double> & pts, size_t n, int dim, Kind kind, mt19937_64 & random)
+{
+	uniform_real_distribution<double> uniform(0, 1);
+	normal_distribution<double> spread(0, 0.01);
+	vector<double> centres(10 * dim);
+
+	for (size_t k = 0; k < centres.size(); k++)
+		centres[k] = uniform(random);
+
+	pts.resize(n * dim);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		const double * c = &centres[(random() % 10) * dim];
+
+		for (int k = 0; k < dim; k++)
+		{
+			double & x = pts[i * dim + k];
+
+			if (kind == CLUSTERED)
+				x = c[k] + spread(random);
+			else if (kind == LATTICE)
+				x = (double) (random() % 20);
+			else if (kind == STACKED && k >= 2)
+				x = (double) i * 1000 + k;
+			else
+				x = uniform(random);
+		}
+	}
+}
+
+// The closest distance among the n points, by comparing every pair, with
+// the squares summed in the same order as by the engines
+double bruteForce(const vector<double> & pts, size_t n, int dim)
+{
+	double best = numeric_limits<double>::infinity();
+
+	for (size_t i = 0; i < n; i++)
+	{
+		for (size_t j = i + 1; j < n; j++)
+		{
+			double d = 0;
+
+			for (int k = 0; k < dim; k++)
+			{
+				double t = pts[i * dim + k] - pts[j * dim + k];
+				d += t * t;
+			}
+
+			best = min(best, d);
+		}
+	}
+
+	return sqrt(best);
+}
+
+int main()
+{
+	static const ClosestPairMethod methods[] = { CLOSEST_PAIR_AUTO, CLOSEST_PAIR_DIVIDE, CLOSEST_PAIR_GRID };
+	static const char * methodNames[] = { "auto", "divide", "grid" };
+	static const size_t sizes[] = { 2, 3, 100, 1500, 4000 };
+
+	mt19937_64 random(12345);
+	vector<double> pts;
+	int failures = 0;
+
+	for (int kind = UNIFORM; kind <= STACKED; kind++)
+	{
+		for (int dim = 1; dim <= 7; dim++)
+		{
+			if (kind == STACKED && dim < 3)
+				continue;
+
+			for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+			{
+				size_t n = sizes[s];
+
+				generatePoints(pts, n, dim, (Kind) kind, random);
+
+				double expected = bruteForce(pts, n, dim);
+
+				for (int m = 0; m < 3; m++)
+				{
+					for (int threads = 1; threads <= 4; threads += 3)
+					{
+						ClosestPairResult r = closestPair(&pts[0], n, dim, threads, methods[m]);
+						double d = 0;
+
+						for (int k = 0; k < dim; k++)
+						{
+							double t = pts[r.first * dim + k] - pts[r.second * dim + k];
+							d += t * t;
+						}
+
+						if (r.distance != expected || sqrt(d) != expected || r.first >= r.second)
+						{
+							if (++failures <= 20)
+								cerr << kindNames[kind] << ", dim " << dim << ", n " << n << ", "
+									<< methodNames[m] << ", " << threads << " threads: found "
+									<< r.distance << ", expected " << expected << "\n";
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (failures > 0)
+	{
+		cerr << failures << " failures\n";
+		return EXIT_FAILURE;
+	}
+
+	cout << "All engines agree with brute force\n";
+
+	// The automatic choice on many stacked points
+	size_t n = 200000;
+
+	generatePoints(pts, n, 3, STACKED, random);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	ClosestPairResult r = closestPair(&pts[0], n, 3, 1);
+
+	cout << n << " stacked points in 3 dimensions: distance " << r.distance << " in "
+		<< chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s\n";
+
+	return EXIT_SUCCESS;
+}
@@ -1,23 +1,30 @@
 // Divide and conquer program to find the shortest distance 
 // between two points in a given set of points in O(nlogn) time.
+// The points are sorted by x once, each half comes back from the recursion
+// sorted by y and the halves are merged, so only the points of the strip
+// around the dividing line have to be compared across the halves.
 
+#include<algorithm>
+#include<cfloat>
 #include<cmath>
 #include<vector>
 #include<iostream>
 
 using namespace std;
 
-// Global variable
-vector< pair<double, double> > coordinates;
+typedef pair<double, double> Point;
+typedef pair<Point, Point> PointPair;
 
 // Function prototypes
-double ComputeEuclidianDistance(pair<int, int>, pair<int, int>);
-pair< pair<double, double>, pair<double, double> > Find(int, int);
+double ComputeEuclidianDistance(Point, Point);
+PointPair FindClosestPair(vector<Point>);
+PointPair Find(vector<Point> &, vector<Point> &, int, int, double &);
 
 int main()
 {
 	int n, x, y;
-	pair< pair<double, double>, pair<double, double> > result;
+	vector<Point> coordinates;
+	PointPair result;
 
 	do 
 	{
@@ -27,7 +34,7 @@ int main()
 		if (n < 2 || n > 10)
 			cout << "Invalid entry. Please try again ..." << endl;
 
-	} while ( (n < 1 || n > 10) );
+	} while ( (n < 2 || n > 10) );
 
 
 	cout << "Populate 2D plane with " << n << " points (valid range [1, 100])\n" << endl;
@@ -66,7 +73,7 @@ int main()
 		coordinates.push_back(make_pair(x, y));
 	}
 	
-	result = Find(0, n - 1);
+	result = FindClosestPair(coordinates);
 	
 	cout << "The points with the following coordinates are nearest to each other." << endl;
 
@@ -81,65 +88,101 @@ int main()
   return 0;
 }
 
-pair< pair<double, double>, pair<double, double> >Find(int L, int R)
+// Returns the two closest points of the set.  The points are taken by value,
+// since they are reordered, so the caller's vector is left as it is and
+// several sets can be searched at the same time.
+PointPair FindClosestPair(vector<Point> points)
 {
+	vector<Point> buffer(points.size());
 	double Min = DBL_MAX;
-	pair< pair<double, double>, pair<double, double> >result;
-	
-	if (R - L <= 4)
+
+	sort(points.begin(), points.end());
+
+	return Find(points, buffer, 0, (int) points.size() - 1, Min);
+}
+
+bool CompareY(const Point & A, const Point & B)
+{
+	return A.second < B.second;
+}
+
+// Finds the closest pair of points[L..R], which are sorted by x, and returns
+// its distance in Min.  On return points[L..R] are sorted by y instead.
+// buffer is scratch space of the same size as points.
+PointPair Find(vector<Point> & points, vector<Point> & buffer, int L, int R, double & Min)
+{
+	PointPair result;
+	Min = DBL_MAX;
+
+	if (R - L <= 3)
 	{
-		for (int i = L + 1; i <= R;i++)
+		for (int i = L + 1; i <= R; i++)
 		{
-			for (int j = L; j < i;j++)
+			for (int j = L; j < i; j++)
 			{
-				if (ComputeEuclidianDistance(coordinates[i], coordinates[j]) < Min)
-				{
-					Min = ComputeEuclidianDistance(coordinates[i], coordinates[j]);
+				double d = ComputeEuclidianDistance(points[i], points[j]);
 
-					result = make_pair(coordinates[i], coordinates[j]);
+				if (d < Min)
+				{
+					Min = d;
+					result = make_pair(points[j], points[i]);
 				}
 			}
 		}
-		
+
+		sort(points.begin() + L, points.begin() + R + 1, CompareY);
+
 		return result;
 	}
-	else
+
+	int mid = (L + R) / 2;
+	double midX = points[mid].first;
+	double LM, RM;
+	PointPair Ch, Ra;
+
+	Ch = Find(points, buffer, L, mid, LM);
+	Ra = Find(points, buffer, mid + 1, R, RM);
+
+	result = (RM < LM) ? Ra : Ch;
+	Min = (RM < LM) ? RM : LM;
+
+	// Merge the halves by y
+	merge(points.begin() + L, points.begin() + mid + 1,
+		points.begin() + mid + 1, points.begin() + R + 1,
+		buffer.begin() + L, CompareY);
+	copy(buffer.begin() + L, buffer.begin() + R + 1, points.begin() + L);
+
+	// Points within Min of the dividing line, still sorted by y
+	int strip = L;
+
+	for (int i = L; i <= R; i++)
+	{
+		if (fabs(points[i].first - midX) < Min)
+			buffer[strip++] = points[i];
+	}
+
+	// Each point only needs to be compared with the points above it that
+	// are less than Min higher, of which there are at most a few
+	for (int i = L; i < strip; i++)
 	{
-		double LM, RM;
-		int mid = (int) floor((R + L) / 2);
-		pair< pair<double, double>, pair<double, double> > Ch, Ra;
-		
-		Ch = Find(L, mid);
-		Ra = Find(mid + 1, R);
-		
-		LM = ComputeEuclidianDistance(Ch.first, Ch.second);
-		RM = ComputeEuclidianDistance(Ra.first, Ra.second);
-		
-		for (int i = L; i <= mid; i++)
+		for (int j = i + 1; j < strip && buffer[j].second - buffer[i].second < Min; j++)
 		{
-			for (int j = mid + 1; j <= R; j++)
+			double d = ComputeEuclidianDistance(buffer[i], buffer[j]);
+
+			if (d < Min)
 			{
-				if (ComputeEuclidianDistance(coordinates[i], coordinates[j]) < Min)
-				{
-					Min = ComputeEuclidianDistance(coordinates[i], coordinates[j]);
-					result = make_pair(coordinates[i], coordinates[j]);
-				}
+				Min = d;
+				result = make_pair(buffer[i], buffer[j]);
 			}
 		}
-		
-		if (LM < Min || RM < Min)
-		{
-			if (RM < LM)
-				return Ra;
-			
-			return Ch;
-		}
-		
-		return result;
 	}
+
+	return result;
 }
 
-double ComputeEuclidianDistance(pair<int, int> X, pair<int, int> Y)
+double ComputeEuclidianDistance(Point X, Point Y)
 {
-	return sqrt( pow(X.first - Y.first, 2) + pow(X.second - Y.second, 2));
-}
\ No newline at end of file
+	double dx = X.first - Y.first, dy = X.second - Y.second;
+
+	return sqrt(dx * dx + dy * dy);
+}